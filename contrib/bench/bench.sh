@@ -0,0 +1,100 @@
+#!/bin/sh
+#
+# Run the iPXE benchmark suite against local servers
+#
+# This builds the Linux userspace iPXE binary with the "bench" and
+# "profstat" commands linked in as extra target elements (so that no
+# configuration files are modified), attaches it to a dedicated tap
+# device, starts local HTTP, TFTP and (if tgtd is available) iSCSI
+# servers on the host side of the tap device, and runs the
+# microbenchmarks followed by a download benchmark against each
+# server.
+#
+# Must be run as root (to create the tap device) from anywhere within
+# the source tree:
+#
+#     contrib/bench/bench.sh [<size in MB>]
+#
+
+set -e
+
+SIZE=${1:-64}
+TAP=ipxe-bench
+HOST_IP=10.253.0.1
+IPXE_IP=10.253.0.2
+NETMASK=255.255.255.0
+HTTP_PORT=8080
+IQN=iqn.2011-01.org.ipxe:bench
+ARCH=${ARCH:-x86_64}
+
+TOPDIR=$(cd "$(dirname "$0")/../.." && pwd)
+SRCDIR=${TOPDIR}/src
+WORKDIR=$(mktemp -d)
+PIDS=
+
+cleanup() {
+	for pid in ${PIDS} ; do
+		kill ${pid} 2>/dev/null || true
+	done
+	if [ -n "${ISCSI}" ] ; then
+		tgtadm --lld iscsi --op delete --mode target --tid 1 \
+			--force 2>/dev/null || true
+	fi
+	ip link del ${TAP} 2>/dev/null || true
+	rm -rf ${WORKDIR}
+}
+trap cleanup EXIT
+
+# Build iPXE with the benchmark and statistics commands included
+TARGET=bin-${ARCH}-linux/tap--bench_cmd--profstat_cmd.linux
+cat > ${WORKDIR}/bench.ipxe <<EOS
+#!ipxe
+set net0/ip ${IPXE_IP}
+set net0/netmask ${NETMASK}
+ifopen net0
+bench
+bench http://${HOST_IP}:${HTTP_PORT}/bench.bin
+bench tftp://${HOST_IP}/bench.bin
+EOS
+if command -v tgtadm >/dev/null && tgtadm --op show --mode sys \
+	>/dev/null 2>&1 ; then
+	ISCSI=1
+	echo "bench --block --size ${SIZE} iscsi:${HOST_IP}:::1:${IQN}" \
+		>> ${WORKDIR}/bench.ipxe
+fi
+echo "netstat" >> ${WORKDIR}/bench.ipxe
+echo "profstat" >> ${WORKDIR}/bench.ipxe
+make -C ${SRCDIR} ${TARGET} EMBED=${WORKDIR}/bench.ipxe
+
+# Create test file
+dd if=/dev/urandom of=${WORKDIR}/bench.bin bs=1M count=${SIZE} 2>/dev/null
+
+# Create tap device
+ip tuntap add dev ${TAP} mode tap
+ip addr add ${HOST_IP}/24 dev ${TAP}
+ip link set ${TAP} up
+
+# Start HTTP server
+( cd ${WORKDIR} && exec python3 -m http.server --bind ${HOST_IP} \
+	${HTTP_PORT} >/dev/null 2>&1 ) &
+PIDS="${PIDS} $!"
+
+# Start TFTP server, if available
+if command -v in.tftpd >/dev/null ; then
+	in.tftpd -L -s -a ${HOST_IP}:69 ${WORKDIR} &
+	PIDS="${PIDS} $!"
+else
+	echo "in.tftpd not found; TFTP benchmark will fail" >&2
+fi
+
+# Export test file via iSCSI, if tgtd is running
+if [ -n "${ISCSI}" ] ; then
+	tgtadm --lld iscsi --op new --mode target --tid 1 -T ${IQN}
+	tgtadm --lld iscsi --op new --mode logicalunit --tid 1 --lun 1 \
+		-b ${WORKDIR}/bench.bin
+	tgtadm --lld iscsi --op bind --mode target --tid 1 -I ALL
+fi
+
+# Give servers time to start, then run benchmarks
+sleep 1
+${SRCDIR}/${TARGET} --net tap,if=${TAP}
@@ -0,0 +1,14 @@
+#ifndef _BITS_AES_H
+#define _BITS_AES_H
+
+/** @file
+ *
+ * i386-specific AES implementations
+ *
+ * No hardware-accelerated implementations are used, since SSE
+ * registers may not be enabled.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#endif /* _BITS_AES_H */
@@ -0,0 +1,14 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * i386-specific CRC32 implementations
+ *
+ * No hardware-accelerated implementations are used; see
+ * <bits/aes.h>.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#endif /* _BITS_CRC32_H */
@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <assert.h>
 #include <ipxe/list.h>
 #include <ipxe/blockdev.h>
+#include <ipxe/blkcache.h>
 #include <ipxe/io.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
@@ -33,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/xfer.h>
 #include <ipxe/retry.h>
 #include <ipxe/timer.h>
+#include <ipxe/umalloc.h>
 #include <ipxe/acpi.h>
 #include <ipxe/sanboot.h>
 #include <ipxe/device.h>
@@ -63,6 +65,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define INT13_COMMAND_TIMEOUT ( 15 * TICKS_PER_SEC )
 
+/** Maximum number of concurrent INT 13 block commands
+ *
+ * A single INT 13 read or write may be split into many fragments
+ * (e.g. AoE can transfer only two sectors per command).  Up to this
+ * many fragments are issued concurrently, subject to the underlying
+ * block device's flow-control window.
+ */
+#define INT13_MAX_COMMANDS 8
+
+/** Length of INT 13 readahead
+ *
+ * Boot loaders typically read the boot image via many small
+ * sequential reads.  When a sequential read smaller than this length
+ * is detected, a read of this length is issued and the data is added
+ * to the block cache, from which subsequent reads are satisfied.
+ */
+#define INT13_READAHEAD_LEN ( 64 * 1024 )
+
 /** An INT 13 emulated drive */
 struct int13_drive {
 	/** Reference count */
@@ -133,6 +153,17 @@ struct int13_drive {
 	int block_rc;
 	/** Status of last operation */
 	int last_status;
+
+	/** Starting logical block address of most recent readahead
+	 *
+	 * Readahead addresses and counts are in units of underlying
+	 * blocks.
+	 */
+	uint64_t ra_lba;
+	/** Number of blocks in most recent readahead */
+	unsigned int ra_count;
+	/** Logical block address following the most recent read */
+	uint64_t ra_next;
 };
 
 /** Vector for chaining to other INT 13 handlers */
@@ -245,6 +276,15 @@ static struct interface_operation int13_command_op[] = {
 static struct interface_descriptor int13_command_desc =
 	INTF_DESC ( struct int13_command, block, int13_command_op );
 
+/**
+ * Invalidate INT 13 readahead
+ *
+ * @v int13		Emulated drive
+ */
+static void int13_ra_invalidate ( struct int13_drive *int13 ) {
+	int13->ra_count = 0;
+}
+
 /**
  * Open (or reopen) INT 13 emulated drive underlying block device
  *
@@ -255,7 +295,9 @@ static int int13_reopen_block ( struct int13_drive *int13 ) {
 	int rc;
 
 	/* Close any existing block device */
+	blkcache_flush ( &int13->block );
 	intf_restart ( &int13->block, -ECONNRESET );
+	int13_ra_invalidate ( int13 );
 
 	/* Open block device */
 	if ( ( rc = xfer_open_uri ( &int13->block, int13->uri ) ) != 0 ) {
@@ -314,8 +356,12 @@ static int int13_command_start ( struct int13_command *command,
  */
 static int int13_command_wait ( struct int13_command *command ) {
 
-	/* Sanity check */
-	assert ( timer_running ( &command->timer ) );
+	/* Sanity check.  When several commands are outstanding, this
+	 * command may already have completed while we were waiting
+	 * for an earlier command.
+	 */
+	assert ( timer_running ( &command->timer ) ||
+		 ( command->rc != -EINPROGRESS ) );
 
 	/* Wait for command to complete */
 	while ( command->rc == -EINPROGRESS )
@@ -335,12 +381,169 @@ static void int13_command_stop ( struct int13_command *command ) {
 	command->int13 = NULL;
 }
 
-/** The single active INT 13 command */
-static struct int13_command int13_command = {
-	.block = INTF_INIT ( int13_command_desc ),
-	.timer = TIMER_INIT ( int13_command_expired ),
+/** The INT 13 commands */
+static struct int13_command int13_commands[INT13_MAX_COMMANDS] = {
+	[ 0 ... ( INT13_MAX_COMMANDS - 1 ) ] = {
+		.block = INTF_INIT ( int13_command_desc ),
+		.timer = TIMER_INIT ( int13_command_expired ),
+	},
 };
 
+/** Block read/write method */
+typedef int ( * int13_block_rw_t ) ( struct interface *control,
+				     struct interface *data,
+				     uint64_t lba, unsigned int count,
+				     userptr_t buffer, size_t len );
+
+/**
+ * Read from or write to underlying block device
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address (in underlying blocks)
+ * @v count		Number of blocks (in underlying blocks)
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ *
+ * The transfer is split into fragments of at most the underlying
+ * device's maximum transfer length.  Up to INT13_MAX_COMMANDS
+ * fragments are issued concurrently, as permitted by the block
+ * device's flow-control window.
+ */
+static int int13_rw_blocks ( struct int13_drive *int13, uint64_t lba,
+			     unsigned int count, userptr_t buffer,
+			     int13_block_rw_t block_rw ) {
+	struct int13_command *command;
+	unsigned int frag_count;
+	unsigned int issued;
+	unsigned int i;
+	size_t frag_len;
+	int rc = 0;
+
+	while ( count ) {
+
+		/* Issue as many fragments as the block device will
+		 * accept.  The first command of each batch waits for
+		 * the window to open; subsequent commands are issued
+		 * only if the window is already open.
+		 */
+		for ( issued = 0 ; ( issued < INT13_MAX_COMMANDS ) && count ;
+		      issued++ ) {
+			command = &int13_commands[issued];
+
+			/* Stop if block device cannot accept more */
+			if ( issued && ( xfer_window ( &int13->block ) == 0 ) )
+				break;
+
+			/* Determine fragment length */
+			frag_count = count;
+			if ( frag_count > int13->capacity.max_count )
+				frag_count = int13->capacity.max_count;
+			frag_len = ( int13->capacity.blksize * frag_count );
+
+			/* Issue command */
+			if ( ( ( rc = int13_command_start ( command,
+							    int13 ) ) != 0 ) ||
+			     ( ( rc = block_rw ( &int13->block,
+						 &command->block, lba,
+						 frag_count, buffer,
+						 frag_len ) ) != 0 ) ) {
+				int13_command_stop ( command );
+				break;
+			}
+
+			/* Move to next fragment */
+			lba += frag_count;
+			count -= frag_count;
+			buffer = userptr_add ( buffer, frag_len );
+		}
+
+		/* Wait for all issued commands to complete, aborting
+		 * any outstanding commands on the first failure.
+		 */
+		for ( i = 0 ; i < issued ; i++ ) {
+			command = &int13_commands[i];
+			if ( rc == 0 ) {
+				rc = int13_command_wait ( command );
+			} else if ( command->rc == -EINPROGRESS ) {
+				int13_command_close ( command, rc );
+			}
+			int13_command_stop ( command );
+		}
+		if ( rc != 0 )
+			return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Read from INT 13 drive with readahead
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address (in underlying blocks)
+ * @v count		Number of blocks (in underlying blocks)
+ * @v buffer		Data buffer
+ * @ret rc		Return status code
+ *
+ * A small read that follows on sequentially from the previous read,
+ * and that is not covered by the most recent readahead, is extended
+ * to INT13_READAHEAD_LEN bytes.  The block cache retains the data
+ * read, and satisfies the following reads.  No copy of the data is
+ * retained here.
+ */
+static int int13_read_blocks ( struct int13_drive *int13, uint64_t lba,
+			       unsigned int count, userptr_t buffer ) {
+	size_t blksize = int13->capacity.blksize;
+	unsigned int ra_max = ( INT13_READAHEAD_LEN / blksize );
+	int sequential = ( lba == int13->ra_next );
+	uint64_t remaining;
+	unsigned int ra_count;
+	userptr_t ra_buffer;
+	int rc;
+
+	/* Record address for sequential access detection */
+	int13->ra_next = ( lba + count );
+
+	/* Read directly unless this is a small sequential read
+	 * extending beyond the most recent readahead, and unless the
+	 * block cache is unable to retain the readahead data.
+	 */
+	remaining = ( ( lba < int13->capacity.blocks ) ?
+		      ( int13->capacity.blocks - lba ) : 0 );
+	ra_count = ( ( remaining < ra_max ) ? remaining : ra_max );
+	if ( ( ! sequential ) || ( count >= ra_count ) ||
+	     ( ( lba >= int13->ra_lba ) &&
+	       ( ( lba + count ) <= ( int13->ra_lba + int13->ra_count ) ) ) ||
+	     ( ! blkcache_cacheable ( ra_count, ( ra_count * blksize ) ) ) ) {
+		return int13_rw_blocks ( int13, lba, count, buffer,
+					 block_read );
+	}
+
+	/* Allocate temporary readahead buffer */
+	ra_buffer = umalloc ( ra_count * blksize );
+	if ( ! ra_buffer ) {
+		return int13_rw_blocks ( int13, lba, count, buffer,
+					 block_read );
+	}
+
+	/* Read ahead (populating the block cache) and return the
+	 * requested portion
+	 */
+	DBGC2 ( int13, "INT13 drive %02x readahead %08llx+%x\n",
+		int13->drive, ( unsigned long long ) lba, ra_count );
+	if ( ( rc = int13_rw_blocks ( int13, lba, ra_count, ra_buffer,
+				      block_read ) ) != 0 )
+		goto err_read;
+	memcpy_user ( buffer, 0, ra_buffer, 0, ( count * blksize ) );
+	int13->ra_lba = lba;
+	int13->ra_count = ra_count;
+
+ err_read:
+	ufree ( ra_buffer );
+	return rc;
+}
+
 /**
  * Read from or write to INT 13 drive
  *
@@ -353,45 +556,19 @@ static struct int13_command int13_command = {
  */
 static int int13_rw ( struct int13_drive *int13, uint64_t lba,
 		      unsigned int count, userptr_t buffer,
-		      int ( * block_rw ) ( struct interface *control,
-					   struct interface *data,
-					   uint64_t lba, unsigned int count,
-					   userptr_t buffer, size_t len ) ) {
-	struct int13_command *command = &int13_command;
-	unsigned int frag_count;
-	size_t frag_len;
-	int rc;
+		      int13_block_rw_t block_rw ) {
 
 	/* Translate to underlying blocksize */
 	lba <<= int13->blksize_shift;
 	count <<= int13->blksize_shift;
 
-	while ( count ) {
+	/* Use readahead for reads */
+	if ( block_rw == block_read )
+		return int13_read_blocks ( int13, lba, count, buffer );
 
-		/* Determine fragment length */
-		frag_count = count;
-		if ( frag_count > int13->capacity.max_count )
-			frag_count = int13->capacity.max_count;
-		frag_len = ( int13->capacity.blksize * frag_count );
-
-		/* Issue command */
-		if ( ( ( rc = int13_command_start ( command, int13 ) ) != 0 ) ||
-		     ( ( rc = block_rw ( &int13->block, &command->block, lba,
-					 frag_count, buffer,
-					 frag_len ) ) != 0 ) ||
-		     ( ( rc = int13_command_wait ( command ) ) != 0 ) ) {
-			int13_command_stop ( command );
-			return rc;
-		}
-		int13_command_stop ( command );
-
-		/* Move to next fragment */
-		lba += frag_count;
-		count -= frag_count;
-		buffer = userptr_add ( buffer, frag_len );
-	}
-
-	return 0;
+	/* Any write invalidates the readahead */
+	int13_ra_invalidate ( int13 );
+	return int13_rw_blocks ( int13, lba, count, buffer, block_rw );
 }
 
 /**
@@ -401,7 +578,7 @@ static int int13_rw ( struct int13_drive *int13, uint64_t lba,
  * @ret rc		Return status code
  */
 static int int13_read_capacity ( struct int13_drive *int13 ) {
-	struct int13_command *command = &int13_command;
+	struct int13_command *command = &int13_commands[0];
 	int rc;
 
 	/* Issue command */
@@ -1366,6 +1543,7 @@ static void int13_block_close ( struct int13_drive *int13, int rc ) {
 	int13->block_rc = rc;
 
 	/* Shut down interfaces */
+	blkcache_flush ( &int13->block );
 	intf_restart ( &int13->block, rc );
 }
 
@@ -1479,6 +1657,7 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
  err_alloc_scratch:
  err_read_capacity:
  err_reopen_block:
+	blkcache_flush ( &int13->block );
 	intf_shutdown ( &int13->block, rc );
 	ref_put ( &int13->refcnt );
  err_zalloc:
@@ -1522,6 +1701,7 @@ static void int13_unhook ( unsigned int drive ) {
 	}
 
 	/* Shut down interfaces */
+	blkcache_flush ( &int13->block );
 	intf_shutdown ( &int13->block, 0 );
 
 	/* Remove from list of emulated drives */
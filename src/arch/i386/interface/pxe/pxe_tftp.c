@@ -123,8 +123,30 @@ static int pxe_tftp_xfer_deliver ( struct pxe_tftp_connection *pxe_tftp,
 	return rc;
 }
 
+/**
+ * Check flow control window
+ *
+ * @v pxe_tftp		PXE TFTP connection
+ * @ret len		Length of window
+ *
+ * The window is the space remaining in the caller's buffer.  In
+ * particular, pxenv_tftp_read() provides space for only a single
+ * block, and so the TFTP layer must not request a window of several
+ * blocks on our behalf.
+ */
+static size_t pxe_tftp_xfer_window ( struct pxe_tftp_connection *pxe_tftp ) {
+
+	if ( ! pxe_tftp->buffer )
+		return 0;
+	if ( pxe_tftp->offset > ( pxe_tftp->start + pxe_tftp->size ) )
+		return 0;
+	return ( pxe_tftp->start + pxe_tftp->size - pxe_tftp->offset );
+}
+
 /** PXE TFTP connection interface operations */
 static struct interface_operation pxe_tftp_xfer_ops[] = {
+	INTF_OP ( xfer_window, struct pxe_tftp_connection *,
+		  pxe_tftp_xfer_window ),
 	INTF_OP ( xfer_deliver, struct pxe_tftp_connection *,
 		  pxe_tftp_xfer_deliver ),
 	INTF_OP ( intf_close, struct pxe_tftp_connection *, pxe_tftp_close ),
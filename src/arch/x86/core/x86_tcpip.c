@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/** @file
+ *
+ * Optimised TCP/IP checksum calculation
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/tcpip.h>
+
+/** Number of native words summed per iteration of the main loop */
+#define X86_TCPIP_UNROLL 4
+
+/**
+ * Calculate continued TCP/IP checkum
+ *
+ * @v partial		Checksum of already-summed data, in network byte order
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @ret cksum		Updated checksum, in network byte order
+ *
+ * The bulk of the data is summed a native machine word (32-bit or
+ * 64-bit) at a time using an add-with-carry chain, which allows the
+ * carry from each addition to be folded into the next with no
+ * additional instructions.  Short buffers, buffers starting on an odd
+ * address, and the unaligned head and tail of longer buffers are
+ * handled by the generic implementation.
+ *
+ * There is deliberately no SSE2 variant.  On i386, SSE may not be
+ * enabled in the BIOS environment.  On x86_64 it would be usable,
+ * but for packet-sized buffers the add-with-carry chain already runs
+ * as fast as an SSE2 summation loop.
+ */
+uint16_t x86_tcpip_continue_chksum ( uint16_t partial,
+				     const void *data, size_t len ) {
+	const size_t block_len = ( X86_TCPIP_UNROLL * sizeof ( long ) );
+	unsigned long sum;
+	unsigned long count;
+	size_t head_len;
+	uint16_t folded;
+
+	/* Use generic code for short or oddly-aligned buffers */
+	if ( ( len < ( 2 * block_len ) ) || ( ( ( intptr_t ) data ) & 1 ) )
+		return generic_tcpip_continue_chksum ( partial, data, len );
+
+	/* Sum any head portion required to reach word alignment.
+	 * This is always an even number of bytes, so the main loop
+	 * will still start on an even offset.
+	 */
+	head_len = ( ( -( ( intptr_t ) data ) ) & ( sizeof ( long ) - 1 ) );
+	if ( head_len ) {
+		partial = generic_tcpip_continue_chksum ( partial, data,
+							  head_len );
+		data += head_len;
+		len -= head_len;
+	}
+
+	/* Sum whole blocks using an add-with-carry chain.  The end
+	 * of the loop uses only instructions ("lea" and "dec") which
+	 * preserve the carry flag.  The final carries are added back
+	 * in twice, since the first addition may itself carry.
+	 */
+	sum = ( ( ~partial ) & 0xffff );
+	count = ( len / block_len );
+	len -= ( count * block_len );
+	__asm__ ( "clc\n\t"
+		  "\n1:\n\t"
+		  "adc 0*%c[step](%[data]), %[sum]\n\t"
+		  "adc 1*%c[step](%[data]), %[sum]\n\t"
+		  "adc 2*%c[step](%[data]), %[sum]\n\t"
+		  "adc 3*%c[step](%[data]), %[sum]\n\t"
+		  "lea 4*%c[step](%[data]), %[data]\n\t"
+		  "dec %[count]\n\t"
+		  "jnz 1b\n\t"
+		  "adc $0, %[sum]\n\t"
+		  "adc $0, %[sum]\n\t"
+		  : [sum] "+r" ( sum ), [data] "+r" ( data ),
+		    [count] "+r" ( count )
+		  : [step] "i" ( sizeof ( long ) )
+		  : "cc", "memory" );
+
+	/* Fold carries back into a 16-bit sum */
+	if ( sizeof ( sum ) > sizeof ( uint32_t ) ) {
+		sum = ( ( sum & 0xffffffffUL ) +
+			( ( ( uint64_t ) sum ) >> 32 ) );
+		sum = ( ( sum & 0xffffffffUL ) +
+			( ( ( uint64_t ) sum ) >> 32 ) );
+	}
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	folded = ~sum;
+
+	/* Sum any remaining tail portion */
+	return generic_tcpip_continue_chksum ( folded, data, len );
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * AES-NI and PCLMULQDQ accelerated AES and GHASH
+ *
+ * Functions using the AES-NI or PCLMULQDQ instructions are compiled
+ * for those instruction sets individually, and are called only if
+ * CPUID reports support.
+ *
+ * Using XMM registers needs no explicit state saving on x86_64, since
+ * we only ever run as a UEFI application or as a Linux userspace
+ * program.  Both environments guarantee that SSE is enabled.  The
+ * UEFI calling convention treats XMM0-XMM5 as volatile, and the
+ * compiler saves XMM6-XMM15 in the prologue of any EFIAPI function
+ * through which firmware calls into us.  We install no interrupt
+ * handlers that could observe a partially-updated register.  None of
+ * this holds for i386, where the BIOS environment may not have
+ * enabled SSE, and so the i386 build uses no accelerators.
+ */
+
+#include <stdint.h>
+#include <byteswap.h>
+#include <ipxe/aes.h>
+#include <ipxe/gcm.h>
+
+/** Compile function with AES-NI and PCLMULQDQ support */
+#define __aesni __attribute__ (( target ( "aes,pclmul" ) ))
+
+/** CPUID level 1 ECX flag for PCLMULQDQ instruction */
+#define CPUID_ECX_PCLMULQDQ 0x00000002UL
+
+/** CPUID level 1 ECX flag for AES-NI instructions */
+#define CPUID_ECX_AES 0x02000000UL
+
+/** Number of blocks to process in parallel */
+#define AESNI_PARALLEL 4
+
+/** A 128-bit SSE value */
+typedef long long aesni_v2di __attribute__ (( vector_size ( 16 ) ));
+
+/** A 128-bit SSE value treated as dwords */
+typedef int aesni_v4si __attribute__ (( vector_size ( 16 ) ));
+
+/** A possibly unaligned 128-bit SSE value in memory */
+typedef long long aesni_u128 __attribute__ (( vector_size ( 16 ),
+					      aligned ( 1 ), may_alias ));
+
+/**
+ * Read CPUID level 1 feature flags
+ *
+ * @ret ecx		ECX feature flags
+ */
+static uint32_t aesni_cpuid_ecx ( void ) {
+	uint32_t eax = 1;
+	uint32_t ebx;
+	uint32_t ecx = 0;
+	uint32_t edx;
+
+	__asm__ ( "cpuid"
+		  : "+a" ( eax ), "=b" ( ebx ), "+c" ( ecx ), "=d" ( edx ) );
+	return ecx;
+}
+
+/******************************************************************************
+ *
+ * AES
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Check for AES-NI support
+ *
+ * @ret supported	AES-NI instructions are supported
+ */
+static int aesni_supported ( void ) {
+	return ( ( aesni_cpuid_ecx() & CPUID_ECX_AES ) != 0 );
+}
+
+/**
+ * Construct decryption round keys
+ *
+ * @v keys		Round keys
+ */
+static void __aesni aesni_setkey ( struct aes_round_keys *keys ) {
+	const aesni_u128 *ek = ( ( const void * ) keys->encrypt );
+	aesni_u128 *dk = ( ( void * ) keys->decrypt );
+	unsigned int rounds = keys->rounds;
+	unsigned int i;
+
+	/* Use the equivalent inverse cipher key schedule */
+	dk[0] = ek[rounds];
+	for ( i = 1 ; i < rounds ; i++ )
+		dk[i] = __builtin_ia32_aesimc128 ( ek[ rounds - i ] );
+	dk[rounds] = ek[0];
+}
+
+/**
+ * Encrypt data
+ *
+ * @v keys		Round keys
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @v len		Length of data
+ */
+static void __aesni aesni_encrypt ( const struct aes_round_keys *keys,
+				    const void *src, void *dst, size_t len ) {
+	const aesni_u128 *rk = ( ( const void * ) keys->encrypt );
+	const aesni_u128 *in = src;
+	aesni_u128 *out = dst;
+	unsigned int rounds = keys->rounds;
+	aesni_v2di k[ AES_MAXROUNDS + 1 ];
+	aesni_v2di b[AESNI_PARALLEL];
+	unsigned int count;
+	unsigned int i;
+	unsigned int r;
+
+	/* Load round keys */
+	for ( r = 0 ; r <= rounds ; r++ )
+		k[r] = rk[r];
+
+	/* Process several blocks at a time, to keep the pipeline full */
+	while ( len ) {
+		count = ( len / AES_BLOCKSIZE );
+		if ( count > AESNI_PARALLEL )
+			count = AESNI_PARALLEL;
+		for ( i = 0 ; i < count ; i++ )
+			b[i] = ( in[i] ^ k[0] );
+		for ( r = 1 ; r < rounds ; r++ ) {
+			for ( i = 0 ; i < count ; i++ )
+				b[i] = __builtin_ia32_aesenc128 ( b[i], k[r] );
+		}
+		for ( i = 0 ; i < count ; i++ ) {
+			out[i] = __builtin_ia32_aesenclast128 ( b[i],
+								k[rounds] );
+		}
+		in += count;
+		out += count;
+		len -= ( count * AES_BLOCKSIZE );
+	}
+}
+
+/**
+ * Decrypt data
+ *
+ * @v keys		Round keys
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @v len		Length of data
+ */
+static void __aesni aesni_decrypt ( const struct aes_round_keys *keys,
+				    const void *src, void *dst, size_t len ) {
+	const aesni_u128 *rk = ( ( const void * ) keys->decrypt );
+	const aesni_u128 *in = src;
+	aesni_u128 *out = dst;
+	unsigned int rounds = keys->rounds;
+	aesni_v2di k[ AES_MAXROUNDS + 1 ];
+	aesni_v2di b[AESNI_PARALLEL];
+	unsigned int count;
+	unsigned int i;
+	unsigned int r;
+
+	/* Load round keys */
+	for ( r = 0 ; r <= rounds ; r++ )
+		k[r] = rk[r];
+
+	/* Process several blocks at a time, to keep the pipeline full */
+	while ( len ) {
+		count = ( len / AES_BLOCKSIZE );
+		if ( count > AESNI_PARALLEL )
+			count = AESNI_PARALLEL;
+		for ( i = 0 ; i < count ; i++ )
+			b[i] = ( in[i] ^ k[0] );
+		for ( r = 1 ; r < rounds ; r++ ) {
+			for ( i = 0 ; i < count ; i++ )
+				b[i] = __builtin_ia32_aesdec128 ( b[i], k[r] );
+		}
+		for ( i = 0 ; i < count ; i++ ) {
+			out[i] = __builtin_ia32_aesdeclast128 ( b[i],
+								k[rounds] );
+		}
+		in += count;
+		out += count;
+		len -= ( count * AES_BLOCKSIZE );
+	}
+}
+
+/** AES-NI accelerator */
+struct aes_accelerator aesni_accelerator __aes_accelerator = {
+	.name = "aesni",
+	.supported = aesni_supported,
+	.setkey = aesni_setkey,
+	.encrypt = aesni_encrypt,
+	.decrypt = aesni_decrypt,
+};
+
+/******************************************************************************
+ *
+ * GHASH
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Check for PCLMULQDQ support
+ *
+ * @ret supported	PCLMULQDQ instruction is supported
+ */
+static int pclmul_supported ( void ) {
+	return ( ( aesni_cpuid_ecx() & CPUID_ECX_PCLMULQDQ ) != 0 );
+}
+
+/**
+ * Load GCM block as a byte-reflected value
+ *
+ * @v block		GCM block
+ * @ret value		Byte-reflected value
+ */
+static inline __aesni aesni_v2di pclmul_load ( const union gcm_block *block ){
+	return ( ( aesni_v2di ) { bswap_64 ( block->qword[1] ),
+				  bswap_64 ( block->qword[0] ) } );
+}
+
+/**
+ * Store byte-reflected value as GCM block
+ *
+ * @v value		Byte-reflected value
+ * @v block		GCM block to fill in
+ */
+static inline __aesni void pclmul_store ( aesni_v2di value,
+					  union gcm_block *block ) {
+	block->qword[0] = bswap_64 ( value[1] );
+	block->qword[1] = bswap_64 ( value[0] );
+}
+
+/** Shift 128-bit value left by bytes */
+#define pclmul_slli_bytes( value, bytes ) \
+	__builtin_ia32_pslldqi128 ( (value), ( (bytes) * 8 ) )
+
+/** Shift 128-bit value right by bytes */
+#define pclmul_srli_bytes( value, bytes ) \
+	__builtin_ia32_psrldqi128 ( (value), ( (bytes) * 8 ) )
+
+/** Shift each dword left by bits */
+#define pclmul_slli_dwords( value, bits ) ( ( aesni_v2di )		\
+	__builtin_ia32_pslldi128 ( ( aesni_v4si ) (value), (bits) ) )
+
+/** Shift each dword right by bits */
+#define pclmul_srli_dwords( value, bits ) ( ( aesni_v2di )		\
+	__builtin_ia32_psrldi128 ( ( aesni_v4si ) (value), (bits) ) )
+
+/**
+ * Multiply accumulated hash by hash key
+ *
+ * @v hash		Accumulated hash
+ * @v key		Hash key
+ *
+ * This is the carry-less multiplication and reduction algorithm
+ * described in the Intel white paper "Intel Carry-Less
+ * Multiplication Instruction and its Usage for Computing the GCM
+ * Mode".
+ */
+static void __aesni pclmul_multiply ( union gcm_block *hash,
+				      const union gcm_block *key ) {
+	aesni_v2di a = pclmul_load ( hash );
+	aesni_v2di b = pclmul_load ( key );
+	aesni_v2di lo, mid, hi, t1, t2, t3;
+
+	/* Carry-less multiplication to form a 256-bit product */
+	lo = __builtin_ia32_pclmulqdq128 ( a, b, 0x00 );
+	mid = ( __builtin_ia32_pclmulqdq128 ( a, b, 0x10 ) ^
+		__builtin_ia32_pclmulqdq128 ( a, b, 0x01 ) );
+	hi = __builtin_ia32_pclmulqdq128 ( a, b, 0x11 );
+	lo ^= pclmul_slli_bytes ( mid, 8 );
+	hi ^= pclmul_srli_bytes ( mid, 8 );
+
+	/* Shift product left by one bit, to account for reflection */
+	t1 = pclmul_srli_dwords ( lo, 31 );
+	t2 = pclmul_srli_dwords ( hi, 31 );
+	lo = pclmul_slli_dwords ( lo, 1 );
+	hi = pclmul_slli_dwords ( hi, 1 );
+	t3 = pclmul_srli_bytes ( t1, 12 );
+	t2 = pclmul_slli_bytes ( t2, 4 );
+	t1 = pclmul_slli_bytes ( t1, 4 );
+	lo |= t1;
+	hi |= ( t2 | t3 );
+
+	/* Reduce modulo x^128 + x^7 + x^2 + x + 1 */
+	t1 = ( pclmul_slli_dwords ( lo, 31 ) ^ pclmul_slli_dwords ( lo, 30 ) ^
+	       pclmul_slli_dwords ( lo, 25 ) );
+	t2 = pclmul_srli_bytes ( t1, 4 );
+	t1 = pclmul_slli_bytes ( t1, 12 );
+	lo ^= t1;
+	t3 = ( pclmul_srli_dwords ( lo, 1 ) ^ pclmul_srli_dwords ( lo, 2 ) ^
+	       pclmul_srli_dwords ( lo, 7 ) ^ t2 );
+	lo ^= t3;
+	hi ^= lo;
+
+	pclmul_store ( hi, hash );
+}
+
+/** PCLMULQDQ accelerator */
+struct gcm_accelerator pclmul_accelerator __gcm_accelerator = {
+	.name = "pclmul",
+	.supported = pclmul_supported,
+	.multiply = pclmul_multiply,
+};
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * PCLMULQDQ accelerated CRC32
+ *
+ * This is the folding algorithm described in the Intel white paper
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction", using the constants for the bit-reflected IEEE 802.3
+ * polynomial.  See aesni.c for why XMM registers may be used here.
+ */
+
+#include <stdint.h>
+#include <ipxe/crc32.h>
+
+/** Compile function with PCLMULQDQ support */
+#define __pclmul __attribute__ (( target ( "pclmul" ) ))
+
+/** CPUID level 1 ECX flag for PCLMULQDQ instruction */
+#define CPUID_ECX_PCLMULQDQ 0x00000002UL
+
+/** A 128-bit SSE value */
+typedef long long pclmul_v2di __attribute__ (( vector_size ( 16 ) ));
+
+/** A 128-bit SSE value treated as dwords */
+typedef int pclmul_v4si __attribute__ (( vector_size ( 16 ) ));
+
+/** A possibly unaligned 128-bit SSE value in memory */
+typedef long long pclmul_u128 __attribute__ (( vector_size ( 16 ),
+					       aligned ( 1 ), may_alias ));
+
+/** Carry-less multiply selected qwords */
+#define pclmul( a, b, imm ) __builtin_ia32_pclmulqdq128 ( (a), (b), (imm) )
+
+/** Shift 128-bit value right by bytes */
+#define pclmul_srli_bytes( value, bytes ) \
+	__builtin_ia32_psrldqi128 ( (value), ( (bytes) * 8 ) )
+
+/**
+ * Check for PCLMULQDQ support
+ *
+ * @ret supported	PCLMULQDQ instruction is supported
+ */
+static int pclmul_crc32_supported ( void ) {
+	uint32_t eax = 1;
+	uint32_t ebx;
+	uint32_t ecx = 0;
+	uint32_t edx;
+
+	__asm__ ( "cpuid"
+		  : "+a" ( eax ), "=b" ( ebx ), "+c" ( ecx ), "=d" ( edx ) );
+	return ( ( ecx & CPUID_ECX_PCLMULQDQ ) != 0 );
+}
+
+/**
+ * Fold 128-bit value forward and add in next block
+ *
+ * @v value		Current value
+ * @v constants		Folding constants
+ * @v next		Next block
+ * @ret value		Folded value
+ */
+static inline __pclmul pclmul_v2di
+pclmul_crc32_fold ( pclmul_v2di value, pclmul_v2di constants,
+		    pclmul_v2di next ) {
+	return ( pclmul ( value, constants, 0x00 ) ^
+		 pclmul ( value, constants, 0x11 ) ^ next );
+}
+
+/**
+ * Calculate 32-bit little-endian CRC checksum
+ *
+ * @v seed		Initial value
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret crc		Updated CRC value
+ */
+static u32 __pclmul pclmul_crc32_le ( u32 seed, const void *data,
+				      size_t len ) {
+	const pclmul_v2di k1k2 = { 0x154442bd4LL, 0x1c6e41596LL };
+	const pclmul_v2di k3k4 = { 0x1751997d0LL, 0x0ccaa009eLL };
+	const pclmul_v2di k5 = { 0x163cd6124LL, 0 };
+	const pclmul_v2di poly = { 0x1db710641LL, 0x1f7011641LL };
+	const pclmul_v2di mask32 = { 0xffffffffLL, 0 };
+	const pclmul_u128 *in = data;
+	pclmul_v2di x0, x1, x2, x3;
+	pclmul_v2di tmp;
+
+	/* Load first four blocks, and fold in the initial value */
+	x0 = ( in[0] ^ ( pclmul_v2di ) { seed, 0 } );
+	x1 = in[1];
+	x2 = in[2];
+	x3 = in[3];
+	in += 4;
+	len -= CRC32_ACCEL_MIN_LEN;
+
+	/* Fold four blocks at a time, to keep the pipeline full */
+	while ( len >= CRC32_ACCEL_MIN_LEN ) {
+		x0 = pclmul_crc32_fold ( x0, k1k2, in[0] );
+		x1 = pclmul_crc32_fold ( x1, k1k2, in[1] );
+		x2 = pclmul_crc32_fold ( x2, k1k2, in[2] );
+		x3 = pclmul_crc32_fold ( x3, k1k2, in[3] );
+		in += 4;
+		len -= CRC32_ACCEL_MIN_LEN;
+	}
+
+	/* Fold into a single block, then fold in any remaining blocks */
+	x0 = pclmul_crc32_fold ( x0, k3k4, x1 );
+	x0 = pclmul_crc32_fold ( x0, k3k4, x2 );
+	x0 = pclmul_crc32_fold ( x0, k3k4, x3 );
+	while ( len ) {
+		x0 = pclmul_crc32_fold ( x0, k3k4, *(in++) );
+		len -= CRC32_ACCEL_BLOCKSIZE;
+	}
+
+	/* Fold 128 bits down to 64 bits */
+	x0 = ( pclmul ( k3k4, x0, 0x01 ) ^ pclmul_srli_bytes ( x0, 8 ) );
+	tmp = pclmul_srli_bytes ( x0, 4 );
+	x0 = ( pclmul ( ( x0 & mask32 ), k5, 0x00 ) ^ tmp );
+
+	/* Barrett reduction from 64 bits to 32 bits */
+	tmp = x0;
+	x0 = pclmul ( ( x0 & mask32 ), poly, 0x10 );
+	x0 = pclmul ( ( x0 & mask32 ), poly, 0x00 );
+	x0 ^= tmp;
+
+	return ( ( pclmul_v4si ) x0 )[1];
+}
+
+/** PCLMULQDQ CRC32 accelerator */
+struct crc32_accelerator pclmul_crc32_accelerator __crc32_accelerator = {
+	.name = "pclmul",
+	.supported = pclmul_crc32_supported,
+	.crc32_le = pclmul_crc32_le,
+};
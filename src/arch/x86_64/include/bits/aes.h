@@ -0,0 +1,15 @@
+#ifndef _BITS_AES_H
+#define _BITS_AES_H
+
+/** @file
+ *
+ * x86_64-specific AES implementations
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/* Use AES-NI and PCLMULQDQ instructions when available */
+REQUIRE_OBJECT ( aesni );
+
+#endif /* _BITS_AES_H */
@@ -0,0 +1,15 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * x86_64-specific CRC32 implementations
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/* Use PCLMULQDQ instruction when available */
+REQUIRE_OBJECT ( pclmul_crc32 );
+
+#endif /* _BITS_CRC32_H */
@@ -241,6 +241,12 @@ REQUIRE_OBJECT ( vlan_cmd );
 #ifdef REBOOT_CMD
 REQUIRE_OBJECT ( reboot_cmd );
 #endif
+#ifdef PROFSTAT_CMD
+REQUIRE_OBJECT ( profstat_cmd );
+#endif
+#ifdef BENCH_CMD
+REQUIRE_OBJECT ( bench_cmd );
+#endif
 
 /*
  * Drag in miscellaneous objects
@@ -126,6 +126,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #undef	VLAN_CMD		/* VLAN commands */
 #undef	PXE_CMD			/* PXE commands */
 #undef	REBOOT_CMD		/* Reboot command */
+#undef	PROFSTAT_CMD		/* Profiling statistics command */
+#undef	BENCH_CMD		/* Benchmark command */
 
 /*
  * ROM-specific options
@@ -147,6 +149,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 #define	NETDEV_DISCARD_RATE 0	/* Drop every N packets (0=>no drop) */
+#define	NETDEV_RX_BUDGET 16	/* Max RX packets processed per poll */
+#define	BLOCK_CACHE_SIZE ( 1024 * 1024 ) /* SAN block cache size (0=>none) */
+#define	TCP_WINDOW_SIZE ( 64 * 1024 ) /* Maximum TCP receive window
+					 * (further limited to 3/4 of
+					 * the free heap memory) */
+#define	HTTP_PARALLEL 4		/* Connections per large HTTP download */
 #undef	BUILD_SERIAL		/* Include an automatic build serial
 				 * number.  Add "bs" to the list of
 				 * make targets.  For example:
@@ -0,0 +1,557 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <ipxe/list.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/process.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/blockdev.h>
+#include <ipxe/blkcache.h>
+#include <config/general.h>
+
+/** @file
+ *
+ * Block device cache
+ *
+ * Boot loaders tend to read the same sectors (partition tables,
+ * filesystem metadata, etc) repeatedly.  This write-through cache
+ * sits in the block_read() path and satisfies such reads without
+ * going back to the underlying (typically SAN) block device.
+ *
+ * Cached data is held in aligned lines of BLKCACHE_LINE_LEN bytes,
+ * stored in external (umalloc()ed) memory.  A read is satisfied from
+ * the cache only if every line that it touches is present; otherwise
+ * the whole read is passed to the underlying device, and any lines
+ * fully covered by the read are added to the cache when it completes
+ * successfully.  Writes invalidate any overlapping lines.
+ *
+ * Cache lines hold no reference to the block device, so that a
+ * closed device can be freed.  Each line instead records the
+ * interface through which the device was opened, and the opener
+ * must call blkcache_flush() when it closes the device.
+ */
+
+/** Number of block cache lines */
+#define BLKCACHE_NUM_LINES ( BLOCK_CACHE_SIZE / BLKCACHE_LINE_LEN )
+
+/** Number of block cache hash buckets (must be a power of two) */
+#define BLKCACHE_HASH_SIZE 64
+
+/** A block cache line */
+struct block_cache_line {
+	/** List of lines, in least-recently-used order */
+	struct list_head list;
+	/** Hash chain */
+	struct list_head hash;
+	/** Block device object, or NULL if unused
+	 *
+	 * This is used only as a key, and holds no reference.
+	 */
+	void *device;
+	/** Block device control interface used to open the device */
+	struct interface *control;
+	/** Line number (i.e. byte offset divided by line length) */
+	uint64_t index;
+};
+
+/** A block cache read request */
+struct block_cache_request {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Parent data interface */
+	struct interface data;
+	/** Underlying block device data interface */
+	struct interface block;
+	/** Completion process (for reads satisfied from the cache) */
+	struct process process;
+	/** Block device object */
+	void *device;
+	/** Reference counter for block device object */
+	struct refcnt *device_refcnt;
+	/** Block device control interface */
+	struct interface *control;
+	/** Cache generation at which the read was issued */
+	unsigned long generation;
+	/** Starting byte offset */
+	uint64_t start;
+	/** Data buffer */
+	userptr_t buffer;
+	/** Length of data buffer */
+	size_t len;
+};
+
+/** Block cache statistics */
+struct block_cache_stats blkcache_stats;
+
+/** Block cache lines */
+static struct block_cache_line *blkcache_lines;
+
+/** Block cache data */
+static userptr_t blkcache_data;
+
+/** Block cache lines, most recently used first */
+static LIST_HEAD ( blkcache_lru );
+
+/** Block cache hash buckets */
+static struct list_head blkcache_hash[BLKCACHE_HASH_SIZE];
+
+/** Block cache generation
+ *
+ * This is incremented whenever cached data is invalidated.  A read
+ * that was in progress at the time may have returned either the old
+ * or the new data, and so is not added to the cache.
+ */
+static unsigned long blkcache_generation;
+
+/**
+ * Initialise block cache
+ *
+ * @ret rc		Return status code
+ *
+ * The cache memory is allocated only when first required, since most
+ * boots never use a block device.
+ */
+static int blkcache_init ( void ) {
+	static int blkcache_initialised;
+	static int blkcache_rc;
+	struct block_cache_line *line;
+	unsigned int i;
+
+	/* Do nothing if already initialised (or failed) */
+	if ( blkcache_initialised )
+		return blkcache_rc;
+	blkcache_initialised = 1;
+
+	/* Allocate cache */
+	if ( ! BLKCACHE_NUM_LINES ) {
+		blkcache_rc = -ENOTSUP;
+		return blkcache_rc;
+	}
+	blkcache_lines = zalloc ( BLKCACHE_NUM_LINES *
+				  sizeof ( blkcache_lines[0] ) );
+	blkcache_data = umalloc ( BLKCACHE_NUM_LINES * BLKCACHE_LINE_LEN );
+	if ( ! ( blkcache_lines && blkcache_data ) ) {
+		DBG ( "BLKCACHE could not allocate %d lines\n",
+		      BLKCACHE_NUM_LINES );
+		free ( blkcache_lines );
+		blkcache_lines = NULL;
+		ufree ( blkcache_data );
+		blkcache_data = UNULL;
+		blkcache_rc = -ENOMEM;
+		return blkcache_rc;
+	}
+
+	/* Initialise lists */
+	for ( i = 0 ; i < BLKCACHE_HASH_SIZE ; i++ )
+		INIT_LIST_HEAD ( &blkcache_hash[i] );
+	for ( i = 0 ; i < BLKCACHE_NUM_LINES ; i++ ) {
+		line = &blkcache_lines[i];
+		INIT_LIST_HEAD ( &line->hash );
+		list_add_tail ( &line->list, &blkcache_lru );
+	}
+
+	DBG ( "BLKCACHE using %d lines of %d bytes\n",
+	      BLKCACHE_NUM_LINES, BLKCACHE_LINE_LEN );
+	blkcache_rc = 0;
+	return blkcache_rc;
+}
+
+/**
+ * Calculate block cache hash bucket
+ *
+ * @v device		Block device object
+ * @v index		Line number
+ * @ret bucket		Hash bucket
+ */
+static inline struct list_head * blkcache_bucket ( void *device,
+						   uint64_t index ) {
+	unsigned int hash = ( ( ( intptr_t ) device ) ^ index );
+
+	return &blkcache_hash[ hash & ( BLKCACHE_HASH_SIZE - 1 ) ];
+}
+
+/**
+ * Calculate offset of block cache line data
+ *
+ * @v line		Block cache line
+ * @ret offset		Offset within block cache data
+ */
+static inline off_t blkcache_offset ( struct block_cache_line *line ) {
+	return ( ( line - blkcache_lines ) * BLKCACHE_LINE_LEN );
+}
+
+/**
+ * Find block cache line
+ *
+ * @v device		Block device object
+ * @v index		Line number
+ * @ret line		Block cache line, or NULL if not present
+ */
+static struct block_cache_line * blkcache_find ( void *device,
+						 uint64_t index ) {
+	struct block_cache_line *line;
+
+	list_for_each_entry ( line, blkcache_bucket ( device, index ), hash ) {
+		if ( ( line->device == device ) && ( line->index == index ) )
+			return line;
+	}
+	return NULL;
+}
+
+/**
+ * Discard block cache line
+ *
+ * @v line		Block cache line
+ */
+static void blkcache_discard ( struct block_cache_line *line ) {
+
+	/* Remove from hash chain and move to tail of LRU list */
+	list_del ( &line->hash );
+	INIT_LIST_HEAD ( &line->hash );
+	list_del ( &line->list );
+	list_add_tail ( &line->list, &blkcache_lru );
+	line->device = NULL;
+	line->control = NULL;
+}
+
+/**
+ * Add data to block cache
+ *
+ * @v device		Block device object
+ * @v control		Block device control interface
+ * @v index		Line number
+ * @v buffer		Data buffer
+ * @v offset		Offset of line data within data buffer
+ */
+static void blkcache_add ( void *device, struct interface *control,
+			   uint64_t index, userptr_t buffer, off_t offset ) {
+	struct block_cache_line *line;
+
+	/* Reuse existing line, or evict least recently used line */
+	line = blkcache_find ( device, index );
+	if ( ! line ) {
+		line = list_entry ( blkcache_lru.prev, struct block_cache_line,
+				    list );
+		if ( line->device ) {
+			blkcache_stats.evictions++;
+			blkcache_discard ( line );
+		}
+		line->device = device;
+		line->control = control;
+		line->index = index;
+		list_add ( &line->hash, blkcache_bucket ( device, index ) );
+	}
+
+	/* Copy in data and mark as most recently used */
+	memcpy_user ( blkcache_data, blkcache_offset ( line ), buffer, offset,
+		      BLKCACHE_LINE_LEN );
+	list_del ( &line->list );
+	list_add ( &line->list, &blkcache_lru );
+}
+
+/**
+ * Add all fully-covered lines to block cache
+ *
+ * @v device		Block device object
+ * @v control		Block device control interface
+ * @v start		Starting byte offset
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ */
+static void blkcache_add_range ( void *device, struct interface *control,
+				 uint64_t start, userptr_t buffer,
+				 size_t len ) {
+	uint64_t end = ( start + len );
+	uint64_t index;
+	off_t offset;
+
+	index = ( ( start + BLKCACHE_LINE_LEN - 1 ) / BLKCACHE_LINE_LEN );
+	for ( ; ( ( index + 1 ) * BLKCACHE_LINE_LEN ) <= end ; index++ ) {
+		offset = ( ( index * BLKCACHE_LINE_LEN ) - start );
+		blkcache_add ( device, control, index, buffer, offset );
+	}
+}
+
+/**
+ * Check if block device access is cacheable
+ *
+ * @v count		Number of logical blocks
+ * @v len		Length of data buffer
+ * @ret cacheable	Access is cacheable
+ */
+int blkcache_cacheable ( unsigned int count, size_t len ) {
+	size_t blksize;
+
+	if ( ( count == 0 ) || ( ( len % count ) != 0 ) )
+		return 0;
+	blksize = ( len / count );
+	if ( ( blksize == 0 ) || ( ( BLKCACHE_LINE_LEN % blksize ) != 0 ) )
+		return 0;
+	return ( blkcache_init() == 0 );
+}
+
+/**
+ * Free block cache request
+ *
+ * @v refcnt		Reference counter
+ */
+static void blkcache_request_free ( struct refcnt *refcnt ) {
+	struct block_cache_request *req =
+		container_of ( refcnt, struct block_cache_request, refcnt );
+
+	ref_put ( req->device_refcnt );
+	free ( req );
+}
+
+/**
+ * Close block cache request
+ *
+ * @v req		Block cache request
+ * @v rc		Reason for close
+ */
+static void blkcache_request_close ( struct block_cache_request *req,
+				     int rc ) {
+
+	/* Add all fully-covered lines to the cache, if successful and
+	 * if nothing has been invalidated since the read was issued
+	 */
+	if ( ( rc == 0 ) && ( req->generation == blkcache_generation ) ) {
+		blkcache_add_range ( req->device, req->control, req->start,
+				     req->buffer, req->len );
+	}
+
+	/* Shut down interfaces */
+	process_del ( &req->process );
+	intf_shutdown ( &req->block, rc );
+	intf_shutdown ( &req->data, rc );
+}
+
+/**
+ * Complete block cache request satisfied from the cache
+ *
+ * @v req		Block cache request
+ */
+static void blkcache_request_step ( struct block_cache_request *req ) {
+
+	/* Data has already been copied; just report success */
+	intf_shutdown ( &req->data, 0 );
+}
+
+/** Block cache request data interface operations */
+static struct interface_operation blkcache_data_op[] = {
+	INTF_OP ( intf_close, struct block_cache_request *,
+		  blkcache_request_close ),
+};
+
+/** Block cache request data interface descriptor */
+static struct interface_descriptor blkcache_data_desc =
+	INTF_DESC ( struct block_cache_request, data, blkcache_data_op );
+
+/** Block cache request block interface operations */
+static struct interface_operation blkcache_block_op[] = {
+	INTF_OP ( intf_close, struct block_cache_request *,
+		  blkcache_request_close ),
+};
+
+/** Block cache request block interface descriptor */
+static struct interface_descriptor blkcache_block_desc =
+	INTF_DESC ( struct block_cache_request, block, blkcache_block_op );
+
+/** Block cache request completion process descriptor */
+static struct process_descriptor blkcache_process_desc =
+	PROC_DESC_ONCE ( struct block_cache_request, process,
+			 blkcache_request_step );
+
+/**
+ * Read from block device via block cache
+ *
+ * @v control		Block device control interface
+ * @v dest		Block device control interface destination
+ * @v op		Underlying block read method
+ * @v data		Data interface
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ * @ret rc		Return status code
+ *
+ * If the read can be satisfied entirely from the cache, the data is
+ * copied immediately and the data interface is closed (with success)
+ * from a process, so that the caller always sees an asynchronous
+ * completion.
+ */
+int blkcache_read ( struct interface *control, struct interface *dest,
+		    block_read_TYPE ( void * ) *op, struct interface *data,
+		    uint64_t lba, unsigned int count, userptr_t buffer,
+		    size_t len ) {
+	void *device = intf_object ( dest );
+	struct block_cache_request *req;
+	struct block_cache_line *line;
+	uint64_t start;
+	uint64_t end;
+	uint64_t index;
+	uint64_t line_start;
+	off_t line_offset;
+	size_t frag_len;
+	int hit = 1;
+	int rc;
+
+	/* Bypass cache if access is not cacheable */
+	if ( ! blkcache_cacheable ( count, len ) )
+		return op ( device, data, lba, count, buffer, len );
+	start = ( lba * ( len / count ) );
+	end = ( start + len );
+
+	/* Check whether all required lines are present */
+	for ( index = ( start / BLKCACHE_LINE_LEN ) ;
+	      ( index * BLKCACHE_LINE_LEN ) < end ; index++ ) {
+		if ( ! blkcache_find ( device, index ) ) {
+			hit = 0;
+			break;
+		}
+	}
+
+	/* Allocate and initialise request */
+	req = zalloc ( sizeof ( *req ) );
+	if ( ! req )
+		return op ( device, data, lba, count, buffer, len );
+	ref_init ( &req->refcnt, blkcache_request_free );
+	intf_init ( &req->data, &blkcache_data_desc, &req->refcnt );
+	intf_init ( &req->block, &blkcache_block_desc, &req->refcnt );
+	process_init_stopped ( &req->process, &blkcache_process_desc,
+			       &req->refcnt );
+	req->device = device;
+	req->device_refcnt = ref_get ( dest->refcnt );
+	req->control = control;
+	req->generation = blkcache_generation;
+	req->start = start;
+	req->buffer = buffer;
+	req->len = len;
+
+	if ( hit ) {
+
+		/* Satisfy read from cache */
+		for ( index = ( start / BLKCACHE_LINE_LEN ) ;
+		      ( index * BLKCACHE_LINE_LEN ) < end ; index++ ) {
+			line = blkcache_find ( device, index );
+			line_start = ( index * BLKCACHE_LINE_LEN );
+			line_offset = 0;
+			if ( line_start < start )
+				line_offset = ( start - line_start );
+			frag_len = ( BLKCACHE_LINE_LEN - line_offset );
+			if ( ( line_start + line_offset + frag_len ) > end )
+				frag_len = ( end - line_start - line_offset );
+			memcpy_user ( buffer,
+				      ( line_start + line_offset - start ),
+				      blkcache_data,
+				      ( blkcache_offset ( line ) +
+					line_offset ), frag_len );
+			list_del ( &line->list );
+			list_add ( &line->list, &blkcache_lru );
+		}
+		blkcache_stats.hits++;
+
+		/* Complete request from a process */
+		process_add ( &req->process );
+
+	} else {
+
+		/* Issue read to underlying device */
+		blkcache_stats.misses++;
+		if ( ( rc = op ( device, &req->block, lba, count, buffer,
+				 len ) ) != 0 ) {
+			intf_shutdown ( &req->block, rc );
+			ref_put ( &req->refcnt );
+			return rc;
+		}
+	}
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &req->data, data );
+	ref_put ( &req->refcnt );
+	return 0;
+}
+
+/**
+ * Invalidate block cache for a block device write
+ *
+ * @v dest		Block device control interface destination
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v len		Length of data buffer
+ */
+void blkcache_invalidate ( struct interface *dest, uint64_t lba,
+			   unsigned int count, size_t len ) {
+	void *device = intf_object ( dest );
+	struct block_cache_line *line;
+	uint64_t start;
+	uint64_t end;
+	uint64_t index;
+
+	/* Do nothing if access is not cacheable */
+	if ( ! blkcache_cacheable ( count, len ) )
+		return;
+	start = ( lba * ( len / count ) );
+	end = ( start + len );
+
+	/* Prevent any reads in progress from being cached */
+	blkcache_generation++;
+
+	/* Discard any overlapping lines */
+	for ( index = ( start / BLKCACHE_LINE_LEN ) ;
+	      ( index * BLKCACHE_LINE_LEN ) < end ; index++ ) {
+		if ( ( line = blkcache_find ( device, index ) ) ) {
+			blkcache_stats.invalidations++;
+			blkcache_discard ( line );
+		}
+	}
+}
+
+/**
+ * Discard cached data for a block device that is being closed
+ *
+ * @v control		Block device control interface
+ *
+ * This must be called by the opener of a block device before closing
+ * its control interface, since the cache holds no reference to the
+ * device and the device may subsequently be freed.
+ */
+void blkcache_flush ( struct interface *control ) {
+	struct block_cache_line *line;
+	unsigned int i;
+
+	/* Do nothing if cache is not in use */
+	if ( ! blkcache_lines )
+		return;
+
+	/* Prevent any reads in progress from being cached */
+	blkcache_generation++;
+
+	/* Discard all lines belonging to this device */
+	for ( i = 0 ; i < BLKCACHE_NUM_LINES ; i++ ) {
+		line = &blkcache_lines[i];
+		if ( line->device && ( line->control == control ) )
+			blkcache_discard ( line );
+	}
+}
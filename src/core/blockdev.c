@@ -21,6 +21,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <ipxe/interface.h>
 #include <ipxe/blockdev.h>
+#include <ipxe/blkcache.h>
 
 /** @file
  *
@@ -38,6 +39,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * @v buffer		Data buffer
  * @v len		Length of data buffer
  * @ret rc		Return status code
+ *
+ * Reads are satisfied from the block cache where possible.
  */
 int block_read ( struct interface *control, struct interface *data,
 		 uint64_t lba, unsigned int count,
@@ -45,11 +48,11 @@ int block_read ( struct interface *control, struct interface *data,
 	struct interface *dest;
 	block_read_TYPE ( void * ) *op =
 		intf_get_dest_op ( control, block_read, &dest );
-	void *object = intf_object ( dest );
 	int rc;
 
 	if ( op ) {
-		rc = op ( object, data, lba, count, buffer, len );
+		rc = blkcache_read ( control, dest, op, data, lba, count,
+				     buffer, len );
 	} else {
 		/* Default is to fail to issue the command */
 		rc = -EOPNOTSUPP;
@@ -80,6 +83,7 @@ int block_write ( struct interface *control, struct interface *data,
 	int rc;
 
 	if ( op ) {
+		blkcache_invalidate ( dest, lba, count, len );
 		rc = op ( object, data, lba, count, buffer, len );
 	} else {
 		/* Default is to fail to issue the command */
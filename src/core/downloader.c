@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/umalloc.h>
 #include <ipxe/image.h>
 #include <ipxe/downloader.h>
+#include <ipxe/profile.h>
 
 /** @file
  *
@@ -36,6 +37,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Data delivery profiler */
+static struct profiler downloader_rx_profiler __profiler =
+	{ .name = "downloader.rx" };
+
 /** A downloader */
 struct downloader {
 	/** Reference count for this object */
@@ -50,6 +55,13 @@ struct downloader {
 	struct image *image;
 	/** Current position within image buffer */
 	size_t pos;
+	/** Allocated size of image buffer
+	 *
+	 * This may exceed the length of the image, since the buffer
+	 * is extended geometrically.  Any excess is trimmed when the
+	 * download completes.
+	 */
+	size_t capacity;
 };
 
 /**
@@ -65,6 +77,32 @@ static void downloader_free ( struct refcnt *refcnt ) {
 	free ( downloader );
 }
 
+/**
+ * Trim download buffer to the length of the downloaded image
+ *
+ * @v downloader	Downloader
+ */
+static void downloader_trim ( struct downloader *downloader ) {
+	userptr_t new_buffer;
+
+	/* Do nothing if there is no excess buffer space */
+	if ( downloader->capacity <= downloader->image->len )
+		return;
+
+	DBGC ( downloader, "Downloader %p trimming from %zd to %zd bytes\n",
+	       downloader, downloader->capacity, downloader->image->len );
+
+	/* Shrink buffer.  Failure is harmless; we just keep the
+	 * excess space.
+	 */
+	new_buffer = urealloc ( downloader->image->data,
+				downloader->image->len );
+	if ( ! new_buffer )
+		return;
+	downloader->image->data = new_buffer;
+	downloader->capacity = downloader->image->len;
+}
+
 /**
  * Terminate download
  *
@@ -73,42 +111,102 @@ static void downloader_free ( struct refcnt *refcnt ) {
  */
 static void downloader_finished ( struct downloader *downloader, int rc ) {
 
+	/* Release any excess buffer space on successful completion */
+	if ( rc == 0 )
+		downloader_trim ( downloader );
+
 	/* Shut down interfaces */
 	intf_shutdown ( &downloader->xfer, rc );
 	intf_shutdown ( &downloader->job, rc );
 }
 
 /**
- * Ensure that download buffer is large enough for the specified size
+ * Ensure that download buffer has at least the specified capacity
  *
  * @v downloader	Downloader
- * @v len		Required minimum size
+ * @v len		Required minimum capacity
  * @ret rc		Return status code
+ *
+ * The first extension of the buffer (typically triggered by an
+ * xfer_seek() from a protocol that knows the file size in advance)
+ * allocates exactly the required size.  Subsequent extensions at
+ * least double the size of the buffer, to avoid repeatedly
+ * reallocating (and hence copying) a large image when the final size
+ * is not known in advance.
  */
-static int downloader_ensure_size ( struct downloader *downloader,
-				    size_t len ) {
+static int downloader_ensure_capacity ( struct downloader *downloader,
+					size_t len ) {
 	userptr_t new_buffer;
+	size_t capacity;
 
-	/* If buffer is already large enough, do nothing */
-	if ( len <= downloader->image->len )
+	/* Do nothing if buffer is already large enough */
+	if ( len <= downloader->capacity )
 		return 0;
 
-	DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
-	       downloader, len );
+	/* Calculate new buffer size */
+	capacity = ( downloader->capacity * 2 );
+	if ( capacity < len )
+		capacity = len;
+
+	DBGC ( downloader, "Downloader %p extending to %zd bytes (%zd "
+	       "allocated)\n", downloader, len, capacity );
 
-	/* Extend buffer */
-	new_buffer = urealloc ( downloader->image->data, len );
+	/* Extend buffer, falling back to the exact size required if
+	 * we cannot allocate the geometrically-extended size.
+	 */
+	new_buffer = urealloc ( downloader->image->data, capacity );
+	if ( ( ! new_buffer ) && ( capacity > len ) ) {
+		capacity = len;
+		new_buffer = urealloc ( downloader->image->data, capacity );
+	}
 	if ( ! new_buffer ) {
 		DBGC ( downloader, "Downloader %p could not extend buffer to "
 		       "%zd bytes\n", downloader, len );
 		return -ENOBUFS;
 	}
 	downloader->image->data = new_buffer;
-	downloader->image->len = len;
+	downloader->capacity = capacity;
+
+	return 0;
+}
+
+/**
+ * Ensure that download buffer is large enough for the specified size
+ *
+ * @v downloader	Downloader
+ * @v len		Required minimum size
+ * @ret rc		Return status code
+ */
+static int downloader_ensure_size ( struct downloader *downloader,
+				    size_t len ) {
+	int rc;
+
+	/* Ensure that buffer is large enough */
+	if ( ( rc = downloader_ensure_capacity ( downloader, len ) ) != 0 )
+		return rc;
+
+	/* Record the new length */
+	if ( len > downloader->image->len )
+		downloader->image->len = len;
 
 	return 0;
 }
 
+/**
+ * Calculate buffer position for received data
+ *
+ * @v downloader	Downloader
+ * @v meta		Data transfer metadata
+ * @ret pos		Position within image buffer
+ */
+static size_t downloader_position ( struct downloader *downloader,
+				    struct xfer_metadata *meta ) {
+	size_t pos;
+
+	pos = ( ( meta->flags & XFER_FL_ABS_OFFSET ) ? 0 : downloader->pos );
+	return ( pos + meta->offset );
+}
+
 /****************************************************************************
  *
  * Job control interface
@@ -153,10 +251,10 @@ static int downloader_xfer_deliver ( struct downloader *downloader,
 	size_t max;
 	int rc;
 
+	profile_start ( &downloader_rx_profiler );
+
 	/* Calculate new buffer position */
-	if ( meta->flags & XFER_FL_ABS_OFFSET )
-		downloader->pos = 0;
-	downloader->pos += meta->offset;
+	downloader->pos = downloader_position ( downloader, meta );
 
 	/* Ensure that we have enough buffer space for this data */
 	len = iob_len ( iobuf );
@@ -173,12 +271,65 @@ static int downloader_xfer_deliver ( struct downloader *downloader,
 
  done:
 	free_iob ( iobuf );
+	profile_stop ( &downloader_rx_profiler );
 	return rc;
 }
 
+/**
+ * Get buffer for direct data placement
+ *
+ * @v downloader	Downloader
+ * @v len		Length of data to be placed
+ * @v meta		Data transfer metadata
+ * @ret data		Buffer, or NULL
+ *
+ * The image buffer is extended as needed, but the image length is
+ * not updated until the data is delivered.
+ */
+static void * downloader_xfer_buffer ( struct downloader *downloader,
+				       size_t len,
+				       struct xfer_metadata *meta ) {
+	size_t pos;
+
+	/* Ensure that we have enough buffer space for this data */
+	pos = downloader_position ( downloader, meta );
+	if ( downloader_ensure_capacity ( downloader, ( pos + len ) ) != 0 )
+		return NULL;
+
+	return user_to_virt ( downloader->image->data, pos );
+}
+
+/**
+ * Handle directly placed data
+ *
+ * @v downloader	Downloader
+ * @v len		Length of data placed
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int downloader_xfer_deliver_into ( struct downloader *downloader,
+					 size_t len,
+					 struct xfer_metadata *meta ) {
+	size_t pos;
+	int rc;
+
+	/* Record the new image length */
+	pos = downloader_position ( downloader, meta );
+	if ( ( rc = downloader_ensure_size ( downloader, ( pos + len ) ) ) != 0)
+		return rc;
+
+	/* Update current buffer position */
+	downloader->pos = ( pos + len );
+
+	return 0;
+}
+
 /** Downloader data transfer interface operations */
 static struct interface_operation downloader_xfer_operations[] = {
 	INTF_OP ( xfer_deliver, struct downloader *, downloader_xfer_deliver ),
+	INTF_OP ( xfer_buffer, struct downloader *, downloader_xfer_buffer ),
+	INTF_OP ( xfer_deliver_into, struct downloader *,
+		  downloader_xfer_deliver_into ),
 	INTF_OP ( intf_close, struct downloader *, downloader_finished ),
 };
 
@@ -236,6 +387,7 @@ int create_downloader ( struct interface *job, struct image *image,
 	intf_init ( &downloader->xfer, &downloader_xfer_desc,
 		    &downloader->refcnt );
 	downloader->image = image_get ( image );
+	downloader->capacity = image->len;
 	va_start ( args, type );
 
 	/* Instantiate child objects and attach to our interfaces */
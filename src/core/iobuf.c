@@ -29,6 +29,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Pool of recycled I/O buffers */
+static LIST_HEAD ( iob_pool );
+
+/** I/O buffer pool statistics */
+struct io_buffer_pool_stats iob_pool_stats;
+
+/**
+ * Check if I/O buffer length is eligible for recycling
+ *
+ * @v len	Length of buffer (excluding descriptor)
+ * @ret pooled	I/O buffer is allocated from the I/O buffer pool
+ */
+static inline int iob_pooled ( size_t len ) {
+	return ( ( len > ( IOB_POOL_BLOCK_SIZE / 2 ) ) &&
+		 ( ( len + sizeof ( struct io_buffer ) ) <=
+		   IOB_POOL_BLOCK_SIZE ) );
+}
+
 /**
  * Allocate I/O buffer
  *
@@ -37,9 +55,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  * The I/O buffer will be physically aligned to a multiple of
  * @c IOBUF_SIZE.
+ *
+ * Buffers of a size eligible for recycling are taken from the I/O
+ * buffer pool if possible, and are otherwise allocated as a full
+ * pool block so that they can be recycled when freed.
  */
 struct io_buffer * alloc_iob ( size_t len ) {
 	struct io_buffer *iobuf = NULL;
+	size_t alloc_len;
 	void *data;
 
 	/* Pad to minimum length */
@@ -49,15 +72,35 @@ struct io_buffer * alloc_iob ( size_t len ) {
 	/* Align buffer length */
 	len = ( len + __alignof__( *iobuf ) - 1 ) &
 		~( __alignof__( *iobuf ) - 1 );
-	
+
+	/* Use a recycled buffer, if available */
+	if ( iob_pooled ( len ) ) {
+		iobuf = list_first_entry ( &iob_pool, struct io_buffer, list );
+		if ( iobuf ) {
+			list_del ( &iobuf->list );
+			iob_pool_stats.count--;
+			iob_pool_stats.hits++;
+			data = iobuf->head;
+			goto populate;
+		}
+		iob_pool_stats.misses++;
+		alloc_len = IOB_POOL_BLOCK_SIZE;
+	} else {
+		alloc_len = ( len + sizeof ( *iobuf ) );
+	}
+
 	/* Allocate memory for buffer plus descriptor */
-	data = malloc_dma ( len + sizeof ( *iobuf ), IOB_ALIGN );
-	if ( ! data )
+	data = malloc_dma ( alloc_len, IOB_ALIGN );
+	if ( ! data ) {
+		iob_pool_stats.failures++;
 		return NULL;
+	}
 
+ populate:
 	iobuf = ( struct io_buffer * ) ( data + len );
 	iobuf->head = iobuf->data = iobuf->tail = data;
 	iobuf->end = iobuf;
+	iobuf->flags = 0;
 	return iobuf;
 }
 
@@ -67,15 +110,52 @@ struct io_buffer * alloc_iob ( size_t len ) {
  * @v iobuf	I/O buffer
  */
 void free_iob ( struct io_buffer *iobuf ) {
-	if ( iobuf ) {
-		assert ( iobuf->head <= iobuf->data );
-		assert ( iobuf->data <= iobuf->tail );
-		assert ( iobuf->tail <= iobuf->end );
-		free_dma ( iobuf->head,
-			   ( iobuf->end - iobuf->head ) + sizeof ( *iobuf ) );
+	size_t len;
+
+	if ( ! iobuf )
+		return;
+
+	assert ( iobuf->head <= iobuf->data );
+	assert ( iobuf->data <= iobuf->tail );
+	assert ( iobuf->tail <= iobuf->end );
+
+	len = ( iobuf->end - iobuf->head );
+	if ( iob_pooled ( len ) ) {
+		/* Return to pool, if there is space */
+		if ( iob_pool_stats.count < IOB_POOL_MAX ) {
+			list_add ( &iobuf->list, &iob_pool );
+			iob_pool_stats.count++;
+		} else {
+			free_dma ( iobuf->head, IOB_POOL_BLOCK_SIZE );
+		}
+	} else {
+		free_dma ( iobuf->head, ( len + sizeof ( *iobuf ) ) );
 	}
 }
 
+/**
+ * Discard recycled I/O buffers
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int iob_pool_discard ( void ) {
+	struct io_buffer *iobuf;
+
+	/* Release one buffer from the pool back to the heap */
+	iobuf = list_first_entry ( &iob_pool, struct io_buffer, list );
+	if ( ! iobuf )
+		return 0;
+	list_del ( &iobuf->list );
+	iob_pool_stats.count--;
+	free_dma ( iobuf->head, IOB_POOL_BLOCK_SIZE );
+	return 1;
+}
+
+/** I/O buffer pool cache discarder */
+struct cache_discarder iob_pool_cache_discarder __cache_discarder = {
+	.discard = iob_pool_discard,
+};
+
 /**
  * Ensure I/O buffer has sufficient headroom
  *
@@ -27,6 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/init.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/malloc.h>
+#include <ipxe/profile.h>
 #include <valgrind/memcheck.h>
 
 /** @file
@@ -85,6 +86,53 @@ struct autosized_block {
 /** List of free memory blocks */
 static LIST_HEAD ( free_blocks );
 
+/**
+ * Number of size classes
+ *
+ * Freed blocks of up to ( NUM_SIZE_CLASSES * MIN_MEMBLOCK_SIZE )
+ * bytes (i.e. 4kB on 64-bit builds and 2kB on 32-bit builds, which
+ * covers all common I/O buffer sizes) are not merged back into the
+ * main free list.  Instead, they are kept on a per-size free list, so
+ * that a subsequent allocation of the same size can be satisfied
+ * without having to search the main free list.  Each per-size free
+ * list holds at most MAX_CLASS_BLOCKS blocks; any further freed
+ * blocks are merged into the main free list immediately, so that
+ * memory does not remain fragmented in the per-size free lists.  The
+ * remaining blocks are merged back into the main free list only when
+ * an allocation cannot otherwise be satisfied.
+ */
+#define NUM_SIZE_CLASSES 128
+
+/**
+ * Maximum number of blocks held on each size-class free list
+ *
+ * This is enough to absorb the free/allocate pairs made by the
+ * common steady-state workloads (such as recycling I/O buffers),
+ * while bounding the amount of memory that can be held outside the
+ * main free list.
+ */
+#define MAX_CLASS_BLOCKS 4
+
+/** Per-size-class free lists */
+static struct list_head class_blocks[NUM_SIZE_CLASSES];
+
+/** Number of blocks on each size-class free list */
+static uint8_t class_count[NUM_SIZE_CLASSES];
+
+/**
+ * Check if size-class free list is non-empty
+ *
+ * @v class		Size class
+ * @ret nonempty	Size-class free list is non-empty
+ *
+ * The count (rather than the list itself) must be used to check for
+ * an empty list, since the list heads are not initialised until the
+ * heap is initialised.
+ */
+static inline int class_nonempty ( unsigned int class ) {
+	return ( class_count[class] != 0 );
+}
+
 /** Total amount of free memory */
 size_t freemem;
 
@@ -99,29 +147,48 @@ size_t freemem;
 static char heap[HEAP_SIZE] __attribute__ (( aligned ( __alignof__(void *) )));
 
 /**
- * Mark all blocks in free list as defined
+ * Mark all blocks in free lists as defined
  *
  */
 static inline void valgrind_make_blocks_defined ( void ) {
 	struct memory_block *block;
+	unsigned int i;
 
 	if ( RUNNING_ON_VALGRIND > 0 ) {
 		VALGRIND_MAKE_MEM_DEFINED ( &free_blocks,
 					    sizeof ( free_blocks ) );
 		list_for_each_entry ( block, &free_blocks, list )
 			VALGRIND_MAKE_MEM_DEFINED ( block, sizeof ( *block ) );
+		for ( i = 0 ; i < NUM_SIZE_CLASSES ; i++ ) {
+			if ( ! class_nonempty ( i ) )
+				continue;
+			list_for_each_entry ( block, &class_blocks[i], list ) {
+				VALGRIND_MAKE_MEM_DEFINED ( block,
+							    sizeof ( *block ) );
+			}
+		}
 	}
 }
 
 /**
- * Mark all blocks in free list as inaccessible
+ * Mark all blocks in free lists as inaccessible
  *
  */
 static inline void valgrind_make_blocks_noaccess ( void ) {
 	struct memory_block *block;
 	struct memory_block *tmp;
+	unsigned int i;
 
 	if ( RUNNING_ON_VALGRIND > 0 ) {
+		for ( i = 0 ; i < NUM_SIZE_CLASSES ; i++ ) {
+			if ( ! class_nonempty ( i ) )
+				continue;
+			list_for_each_entry_safe ( block, tmp, &class_blocks[i],
+						   list ) {
+				VALGRIND_MAKE_MEM_NOACCESS ( block,
+							     sizeof ( *block ));
+			}
+		}
 		list_for_each_entry_safe ( block, tmp, &free_blocks, list )
 			VALGRIND_MAKE_MEM_NOACCESS ( block, sizeof ( *block ) );
 		VALGRIND_MAKE_MEM_NOACCESS ( &free_blocks,
@@ -129,6 +196,58 @@ static inline void valgrind_make_blocks_noaccess ( void ) {
 	}
 }
 
+/**
+ * Identify size class for a memory block
+ *
+ * @v size		Block size (rounded up to MIN_MEMBLOCK_SIZE)
+ * @ret class		Size class, or negative if not size-classed
+ */
+static inline int memblock_class ( size_t size ) {
+	size_t class = ( ( size / MIN_MEMBLOCK_SIZE ) - 1 );
+
+	return ( ( class < NUM_SIZE_CLASSES ) ? ( ( int ) class ) : -1 );
+}
+
+/**
+ * Allocate a memory block from a size-class free list
+ *
+ * @v class		Size class
+ * @v align_mask	Physical alignment mask
+ * @ret block		Memory block, or NULL
+ *
+ * Only the first block on the free list is considered, so that this
+ * is always an O(1) operation.  Since blocks of a given size are
+ * almost always allocated with the same alignment, this will very
+ * rarely miss.
+ */
+static struct memory_block * alloc_class_block ( unsigned int class,
+						 size_t align_mask ) {
+	struct list_head *list = &class_blocks[class];
+	struct memory_block *block;
+
+	if ( ! class_nonempty ( class ) )
+		return NULL;
+	block = list_first_entry ( list, struct memory_block, list );
+	if ( virt_to_phys ( block ) & align_mask )
+		return NULL;
+	list_del ( &block->list );
+	class_count[class]--;
+	return block;
+}
+
+/**
+ * Add a memory block to a size-class free list
+ *
+ * @v class		Size class
+ * @v block		Memory block
+ */
+static void free_class_block ( unsigned int class,
+			       struct memory_block *block ) {
+
+	list_add ( &block->list, &class_blocks[class] );
+	class_count[class]++;
+}
+
 /**
  * Discard some cached data
  *
@@ -144,6 +263,92 @@ static unsigned int discard_cache ( void ) {
 	return discarded;
 }
 
+/**
+ * Merge a memory block into the free list
+ *
+ * @v freeing		Memory block (with size filled in)
+ */
+static void merge_memblock ( struct memory_block *freeing ) {
+	struct memory_block *block;
+	struct memory_block *tmp;
+	size_t size = freeing->size;
+	ssize_t gap_before;
+	ssize_t gap_after = -1;
+
+	/* Insert/merge into free list */
+	list_for_each_entry_safe ( block, tmp, &free_blocks, list ) {
+		/* Calculate gaps before and after the "freeing" block */
+		gap_before = ( ( ( void * ) freeing ) - 
+			       ( ( ( void * ) block ) + block->size ) );
+		gap_after = ( ( ( void * ) block ) - 
+			      ( ( ( void * ) freeing ) + freeing->size ) );
+		/* Merge with immediately preceding block, if possible */
+		if ( gap_before == 0 ) {
+			DBG ( "[%p,%p) + [%p,%p) -> [%p,%p)\n", block,
+			      ( ( ( void * ) block ) + block->size ), freeing,
+			      ( ( ( void * ) freeing ) + freeing->size ),block,
+			      ( ( ( void * ) freeing ) + freeing->size ) );
+			block->size += size;
+			list_del ( &block->list );
+			freeing = block;
+		}
+		/* Stop processing as soon as we reach a following block */
+		if ( gap_after >= 0 )
+			break;
+	}
+
+	/* Insert before the immediately following block.  If
+	 * possible, merge the following block into the "freeing"
+	 * block.
+	 */
+	DBG ( "[%p,%p)\n", freeing, ( ( ( void * ) freeing ) + freeing->size));
+	list_add_tail ( &freeing->list, &block->list );
+	if ( gap_after == 0 ) {
+		DBG ( "[%p,%p) + [%p,%p) -> [%p,%p)\n", freeing,
+		      ( ( ( void * ) freeing ) + freeing->size ), block,
+		      ( ( ( void * ) block ) + block->size ), freeing,
+		      ( ( ( void * ) block ) + block->size ) );
+		freeing->size += block->size;
+		list_del ( &block->list );
+	}
+}
+
+/**
+ * Merge all size-classed memory blocks into the free list
+ *
+ * @ret merged		Number of blocks merged
+ */
+static unsigned int merge_class_blocks ( void ) {
+	struct memory_block *block;
+	unsigned int merged = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < NUM_SIZE_CLASSES ; i++ ) {
+		if ( ! class_nonempty ( i ) )
+			continue;
+		while ( ( block = list_first_entry ( &class_blocks[i],
+						     struct memory_block,
+						     list ) ) ) {
+			list_del ( &block->list );
+			merge_memblock ( block );
+			merged++;
+		}
+		class_count[i] = 0;
+	}
+
+	if ( merged )
+		DBG ( "Merged %d size-classed blocks\n", merged );
+	return merged;
+}
+
+/** Memory allocation profiler */
+static struct profiler alloc_profiler __profiler =
+	{ .name = "memblock.alloc" };
+
+/** Memory free profiler */
+static struct profiler free_profiler __profiler =
+	{ .name = "memblock.free" };
+
 /**
  * Allocate a memory block
  *
@@ -164,7 +369,9 @@ void * alloc_memblock ( size_t size, size_t align ) {
 	struct memory_block *pre;
 	struct memory_block *post;
 	struct memory_block *ptr;
+	int class;
 
+	profile_start ( &alloc_profiler );
 	valgrind_make_blocks_defined();
 
 	/* Round up size to multiple of MIN_MEMBLOCK_SIZE and
@@ -174,6 +381,17 @@ void * alloc_memblock ( size_t size, size_t align ) {
 	align_mask = ( align - 1 ) | ( MIN_MEMBLOCK_SIZE - 1 );
 
 	DBG ( "Allocating %#zx (aligned %#zx)\n", size, align );
+
+	/* Try the size-class free list first */
+	class = memblock_class ( size );
+	if ( ( class >= 0 ) &&
+	     ( ( ptr = alloc_class_block ( class, align_mask ) ) != NULL ) ) {
+		freemem -= size;
+		DBG ( "Allocated [%p,%p) from size class\n", ptr,
+		      ( ( ( void * ) ptr ) + size ) );
+		goto done;
+	}
+
 	while ( 1 ) {
 		/* Search through blocks for the first one with enough space */
 		list_for_each_entry ( block, &free_blocks, list ) {
@@ -225,7 +443,12 @@ void * alloc_memblock ( size_t size, size_t align ) {
 			}
 		}
 
-		/* Try discarding some cached data to free up memory */
+		/* Try merging size-classed blocks back into the free
+		 * list, then try discarding some cached data to free
+		 * up memory.
+		 */
+		if ( merge_class_blocks() )
+			continue;
 		if ( ! discard_cache() ) {
 			/* Nothing available to discard */
 			DBG ( "Failed to allocate %#zx (aligned %#zx)\n",
@@ -237,6 +460,7 @@ void * alloc_memblock ( size_t size, size_t align ) {
 
  done:
 	valgrind_make_blocks_noaccess();
+	profile_stop ( &alloc_profiler );
 	return ptr;
 }
 
@@ -250,15 +474,13 @@ void * alloc_memblock ( size_t size, size_t align ) {
  */
 void free_memblock ( void *ptr, size_t size ) {
 	struct memory_block *freeing;
-	struct memory_block *block;
-	struct memory_block *tmp;
-	ssize_t gap_before;
-	ssize_t gap_after = -1;
+	int class;
 
 	/* Allow for ptr==NULL */
 	if ( ! ptr )
 		return;
 
+	profile_start ( &free_profiler );
 	valgrind_make_blocks_defined();
 
 	/* Round up size to match actual size that alloc_memblock()
@@ -270,47 +492,21 @@ void free_memblock ( void *ptr, size_t size ) {
 	freeing->size = size;
 	DBG ( "Freeing [%p,%p)\n", freeing, ( ( ( void * ) freeing ) + size ));
 
-	/* Insert/merge into free list */
-	list_for_each_entry_safe ( block, tmp, &free_blocks, list ) {
-		/* Calculate gaps before and after the "freeing" block */
-		gap_before = ( ( ( void * ) freeing ) - 
-			       ( ( ( void * ) block ) + block->size ) );
-		gap_after = ( ( ( void * ) block ) - 
-			      ( ( ( void * ) freeing ) + freeing->size ) );
-		/* Merge with immediately preceding block, if possible */
-		if ( gap_before == 0 ) {
-			DBG ( "[%p,%p) + [%p,%p) -> [%p,%p)\n", block,
-			      ( ( ( void * ) block ) + block->size ), freeing,
-			      ( ( ( void * ) freeing ) + freeing->size ),block,
-			      ( ( ( void * ) freeing ) + freeing->size ) );
-			block->size += size;
-			list_del ( &block->list );
-			freeing = block;
-		}
-		/* Stop processing as soon as we reach a following block */
-		if ( gap_after >= 0 )
-			break;
-	}
-
-	/* Insert before the immediately following block.  If
-	 * possible, merge the following block into the "freeing"
-	 * block.
+	/* Add to size-class free list if there is space, otherwise
+	 * merge into main free list
 	 */
-	DBG ( "[%p,%p)\n", freeing, ( ( ( void * ) freeing ) + freeing->size));
-	list_add_tail ( &freeing->list, &block->list );
-	if ( gap_after == 0 ) {
-		DBG ( "[%p,%p) + [%p,%p) -> [%p,%p)\n", freeing,
-		      ( ( ( void * ) freeing ) + freeing->size ), block,
-		      ( ( ( void * ) block ) + block->size ), freeing,
-		      ( ( ( void * ) block ) + block->size ) );
-		freeing->size += block->size;
-		list_del ( &block->list );
+	class = memblock_class ( size );
+	if ( ( class >= 0 ) && ( class_count[class] < MAX_CLASS_BLOCKS ) ) {
+		free_class_block ( class, freeing );
+	} else {
+		merge_memblock ( freeing );
 	}
 
 	/* Update free memory counter */
 	freemem += size;
 
 	valgrind_make_blocks_noaccess();
+	profile_stop ( &free_profiler );
 }
 
 /**
@@ -449,6 +645,10 @@ void mpopulate ( void *start, size_t len ) {
  *
  */
 static void init_heap ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < NUM_SIZE_CLASSES ; i++ )
+		INIT_LIST_HEAD ( &class_blocks[i] );
 	VALGRIND_MAKE_MEM_NOACCESS ( heap, sizeof ( heap ) );
 	mpopulate ( heap, sizeof ( heap ) );
 }
@@ -466,11 +666,22 @@ struct init_fn heap_init_fn __init_fn ( INIT_EARLY ) = {
  */
 void mdumpfree ( void ) {
 	struct memory_block *block;
+	unsigned int i;
 
 	printf ( "Free block list:\n" );
 	list_for_each_entry ( block, &free_blocks, list ) {
 		printf ( "[%p,%p] (size %#zx)\n", block,
 			 ( ( ( void * ) block ) + block->size ), block->size );
 	}
+	for ( i = 0 ; i < NUM_SIZE_CLASSES ; i++ ) {
+		if ( ! class_nonempty ( i ) )
+			continue;
+		printf ( "Size class %#zx:\n",
+			 ( ( i + 1 ) * MIN_MEMBLOCK_SIZE ) );
+		list_for_each_entry ( block, &class_blocks[i], list ) {
+			printf ( "[%p,%p]\n", block,
+				 ( ( ( void * ) block ) + block->size ) );
+		}
+	}
 }
 #endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ipxe/timer.h>
+#include <ipxe/profile.h>
+
+/** @file
+ *
+ * Profiling
+ *
+ * Each sample is accumulated into running totals (from which the
+ * mean and standard deviation are calculated) and into a logarithmic
+ * histogram (from which percentiles are estimated).  No division is
+ * required when recording a sample, so that the overhead of a probe
+ * is small compared to the code being measured.
+ */
+
+/**
+ * Record profiling sample
+ *
+ * @v profiler		Profiler
+ * @v sample		Sample (in CPU cycles)
+ */
+void profile_update ( struct profiler *profiler, unsigned long sample ) {
+	unsigned int bucket;
+
+	/* Update extremes */
+	if ( ( profiler->count == 0 ) || ( sample < profiler->min ) )
+		profiler->min = sample;
+	if ( sample > profiler->max )
+		profiler->max = sample;
+
+	/* Update running totals */
+	profiler->count++;
+	profiler->total += sample;
+	profiler->total_sq += ( ( ( uint64_t ) sample ) * sample );
+
+	/* Update histogram */
+	bucket = flsl ( sample );
+	if ( bucket >= PROFILE_BUCKETS )
+		bucket = ( PROFILE_BUCKETS - 1 );
+	profiler->hist[bucket]++;
+}
+
+/**
+ * Calculate mean sample value
+ *
+ * @v profiler		Profiler
+ * @ret mean		Mean sample value
+ */
+unsigned long profile_mean ( struct profiler *profiler ) {
+
+	if ( ! profiler->count )
+		return 0;
+	return ( profiler->total / profiler->count );
+}
+
+/**
+ * Calculate integer square root
+ *
+ * @v value		Value
+ * @ret root		Square root (rounded down)
+ */
+static unsigned long profile_sqrt ( uint64_t value ) {
+	uint64_t root = 0;
+	uint64_t bit = ( 1ULL << 62 );
+
+	while ( bit > value )
+		bit >>= 2;
+	while ( bit ) {
+		if ( value >= ( root + bit ) ) {
+			value -= ( root + bit );
+			root = ( ( root >> 1 ) + bit );
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+/**
+ * Calculate sample standard deviation
+ *
+ * @v profiler		Profiler
+ * @ret stddev		Standard deviation
+ */
+unsigned long profile_stddev ( struct profiler *profiler ) {
+	uint64_t mean;
+	uint64_t mean_sq;
+
+	if ( ! profiler->count )
+		return 0;
+	mean = profile_mean ( profiler );
+	mean_sq = ( profiler->total_sq / profiler->count );
+
+	/* Guard against rounding errors */
+	if ( mean_sq < ( mean * mean ) )
+		return 0;
+	return profile_sqrt ( mean_sq - ( mean * mean ) );
+}
+
+/**
+ * Estimate sample percentile
+ *
+ * @v profiler		Profiler
+ * @v percentile	Percentile (0-100)
+ * @ret value		Estimated sample value
+ *
+ * The value is interpolated linearly within the histogram bucket
+ * containing the requested percentile.
+ */
+unsigned long profile_percentile ( struct profiler *profiler,
+				   unsigned int percentile ) {
+	uint64_t target;
+	uint64_t seen = 0;
+	uint64_t low;
+	uint64_t high;
+	uint64_t value;
+	unsigned int i;
+
+	if ( ! profiler->count )
+		return 0;
+
+	/* Identify rank of requested sample (counting from one) */
+	target = ( ( ( ( uint64_t ) profiler->count ) * percentile + 99 ) /
+		   100 );
+	if ( ! target )
+		target = 1;
+
+	/* Locate bucket containing this sample */
+	for ( i = 0 ; i < PROFILE_BUCKETS ; i++ ) {
+		if ( ( seen + profiler->hist[i] ) >= target )
+			break;
+		seen += profiler->hist[i];
+	}
+	if ( i == PROFILE_BUCKETS )
+		return profiler->max;
+
+	/* Interpolate within bucket, and clamp to observed range */
+	low = ( i ? ( 1ULL << ( i - 1 ) ) : 0 );
+	high = ( ( i == ( PROFILE_BUCKETS - 1 ) ) ?
+		 profiler->max : ( 1ULL << i ) );
+	value = ( low + ( ( ( high - low ) * ( target - seen ) ) /
+			  profiler->hist[i] ) );
+	if ( value < profiler->min )
+		value = profiler->min;
+	if ( value > profiler->max )
+		value = profiler->max;
+	return value;
+}
+
+/**
+ * Reset profiler
+ *
+ * @v profiler		Profiler
+ */
+void profile_reset ( struct profiler *profiler ) {
+	const char *name = profiler->name;
+
+	memset ( profiler, 0, sizeof ( *profiler ) );
+	profiler->name = name;
+}
+
+/**
+ * Get profiling timestamp rate
+ *
+ * @ret rate		Timestamp rate (in CPU cycles per microsecond)
+ *
+ * The rate is calibrated against udelay() on first use, and is
+ * intended only for converting accumulated timestamp differences
+ * into approximate times for display.
+ */
+unsigned long profile_rate ( void ) {
+	static unsigned long rate;
+	unsigned long started;
+
+	if ( ! rate ) {
+		started = profile_timestamp();
+		udelay ( PROFILE_CALIBRATE_USECS );
+		rate = ( ( profile_timestamp() - started ) /
+			 PROFILE_CALIBRATE_USECS );
+		if ( ! rate )
+			rate = 1;
+	}
+	return rate;
+}
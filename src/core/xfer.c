@@ -219,6 +219,94 @@ int xfer_deliver ( struct interface *intf,
 	return rc;
 }
 
+/**
+ * Get buffer for direct data placement
+ *
+ * @v intf		Data transfer interface
+ * @v len		Length of data to be placed
+ * @v meta		Data transfer metadata
+ * @ret data		Buffer, or NULL if direct placement is not possible
+ *
+ * A recipient that holds its own receive buffer (such as the image
+ * downloader) may expose that buffer so that the sender can write
+ * data directly into its final location, rather than allocating an
+ * I/O buffer only for the recipient to copy the data out again.  The
+ * returned buffer is valid for @c len bytes at the position described
+ * by @c meta.  The sender must complete the placement by calling
+ * xfer_deliver_into() with the same metadata before making any other
+ * call on the interface, even if it fails to produce the data; it may
+ * deliver fewer than @c len bytes (including zero bytes).
+ *
+ * Since the meaning of the buffer depends upon any transformation
+ * applied to the data, this method is never passed through to the
+ * far side of a pass-through interface.
+ */
+void * xfer_buffer ( struct interface *intf, size_t len,
+		     struct xfer_metadata *meta ) {
+	struct interface *dest;
+	xfer_buffer_TYPE ( void * ) *op =
+		intf_get_dest_op_no_passthru ( intf, xfer_buffer, &dest );
+	void *object = intf_object ( dest );
+	void *data;
+
+	if ( op ) {
+		data = op ( object, len, meta );
+	} else {
+		/* Default is to not support direct placement */
+		data = NULL;
+	}
+
+	if ( data ) {
+		DBGC ( INTF_COL ( intf ), "INTF " INTF_INTF_FMT " buffer "
+		       "%zd\n", INTF_INTF_DBG ( intf, dest ), len );
+	}
+
+	intf_put ( dest );
+	return data;
+}
+
+/**
+ * Deliver directly placed data
+ *
+ * @v intf		Data transfer interface
+ * @v len		Length of data placed
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ *
+ * The data must already have been written to the buffer returned by
+ * xfer_buffer().
+ */
+int xfer_deliver_into ( struct interface *intf, size_t len,
+			struct xfer_metadata *meta ) {
+	struct interface *dest;
+	xfer_deliver_into_TYPE ( void * ) *op =
+		intf_get_dest_op_no_passthru ( intf, xfer_deliver_into,
+					       &dest );
+	void *object = intf_object ( dest );
+	int rc;
+
+	DBGC ( INTF_COL ( intf ), "INTF " INTF_INTF_FMT " deliver_into %zd\n",
+	       INTF_INTF_DBG ( intf, dest ), len );
+
+	if ( op ) {
+		rc = op ( object, len, meta );
+	} else {
+		/* Default is to fail, since xfer_buffer() cannot
+		 * have returned a buffer.
+		 */
+		rc = -ENOTSUP;
+	}
+
+	if ( rc != 0 ) {
+		DBGC ( INTF_COL ( intf ), "INTF " INTF_INTF_FMT
+		       " deliver_into failed: %s\n",
+		       INTF_INTF_DBG ( intf, dest ), strerror ( rc ) );
+	}
+
+	intf_put ( dest );
+	return rc;
+}
+
 /*****************************************************************************
  *
  * Data transfer interface helper functions
@@ -266,6 +354,14 @@ int xfer_deliver_iob ( struct interface *intf, struct io_buffer *iobuf ) {
 int xfer_deliver_raw_meta ( struct interface *intf, const void *data,
 			    size_t len, struct xfer_metadata *meta ) {
 	struct io_buffer *iobuf;
+	void *buffer;
+
+	/* Place data directly into the recipient's buffer, if possible */
+	buffer = xfer_buffer ( intf, len, meta );
+	if ( buffer ) {
+		memcpy ( buffer, data, len );
+		return xfer_deliver_into ( intf, len, meta );
+	}
 
 	iobuf = xfer_alloc_iob ( intf, len );
 	if ( ! iobuf )
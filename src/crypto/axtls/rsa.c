@@ -72,8 +72,16 @@ void RSA_pub_key_new(RSA_CTX **ctx,
 {
     RSA_CTX *rsa_ctx;
     BI_CTX *bi_ctx = bi_initialize();
-    *ctx = (RSA_CTX *)calloc(1, sizeof(RSA_CTX));
-    rsa_ctx = *ctx;
+    *ctx = NULL;
+    if (bi_ctx == NULL)
+        return;
+    rsa_ctx = (RSA_CTX *)calloc(1, sizeof(RSA_CTX));
+    if (rsa_ctx == NULL)
+    {
+        bi_terminate(bi_ctx);
+        return;
+    }
+    *ctx = rsa_ctx;
     rsa_ctx->bi_ctx = bi_ctx;
     rsa_ctx->num_octets = (mod_len & 0xFFF0);
     rsa_ctx->m = bi_import(bi_ctx, modulus, mod_len);
@@ -23,7 +23,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <byteswap.h>
 #include <ipxe/crypto.h>
 #include <ipxe/cbc.h>
+#include <ipxe/gcm.h>
 #include <ipxe/aes.h>
+#include <bits/aes.h>
 #include "crypto/axtls/crypto.h"
 
 /** @file
@@ -32,6 +34,63 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Selected hardware accelerator, if any */
+static struct aes_accelerator *aes_accel;
+
+/** Hardware accelerators have been probed */
+static int aes_accel_probed;
+
+/**
+ * Find hardware accelerator
+ *
+ * @ret accel		Hardware accelerator, or NULL
+ */
+static struct aes_accelerator * aes_find_accelerator ( void ) {
+	struct aes_accelerator *accel;
+
+	if ( ! aes_accel_probed ) {
+		for_each_table_entry ( accel, AES_ACCELERATORS ) {
+			if ( accel->supported() ) {
+				DBG ( "AES using %s\n", accel->name );
+				aes_accel = accel;
+				break;
+			}
+		}
+		aes_accel_probed = 1;
+	}
+	return aes_accel;
+}
+
+/**
+ * Convert AXTLS key schedule for use by a hardware accelerator
+ *
+ * @v aes_ctx		AES context
+ *
+ * AXTLS holds the expanded key as host-endian dwords; hardware
+ * implementations expect the round keys as byte strings.
+ */
+static void aes_accel_setkey ( struct aes_context *aes_ctx ) {
+	struct aes_round_keys *keys = &aes_ctx->keys;
+	AES_CTX axtls_ctx;
+	uint32_t word;
+	unsigned int i;
+
+	/* Copy out AXTLS key schedule, since it shares storage */
+	memcpy ( &axtls_ctx, &aes_ctx->axtls_ctx, sizeof ( axtls_ctx ) );
+
+	/* Construct encryption round keys */
+	keys->rounds = axtls_ctx.rounds;
+	for ( i = 0 ; i < ( 4 * ( keys->rounds + 1 ) ) ; i++ ) {
+		word = htonl ( axtls_ctx.ks[i] );
+		memcpy ( &keys->encrypt[ i / 4 ][ 4 * ( i % 4 ) ], &word,
+			 sizeof ( word ) );
+	}
+	memset ( &axtls_ctx, 0, sizeof ( axtls_ctx ) );
+
+	/* Construct decryption round keys */
+	aes_ctx->accel->setkey ( keys );
+}
+
 /**
  * Set key
  *
@@ -65,6 +124,11 @@ static int aes_setkey ( void *ctx, const void *key, size_t keylen ) {
 
 	aes_ctx->decrypting = 0;
 
+	/* Use hardware accelerator, if available */
+	aes_ctx->accel = aes_find_accelerator();
+	if ( aes_ctx->accel )
+		aes_accel_setkey ( aes_ctx );
+
 	return 0;
 }
 
@@ -116,10 +180,22 @@ static void aes_encrypt ( void *ctx, const void *src, void *dst,
 			  size_t len ) {
 	struct aes_context *aes_ctx = ctx;
 
-	assert ( len == AES_BLOCKSIZE );
+	assert ( ( len % AES_BLOCKSIZE ) == 0 );
+
+	/* Use hardware accelerator, if available */
+	if ( aes_ctx->accel ) {
+		aes_ctx->accel->encrypt ( &aes_ctx->keys, src, dst, len );
+		return;
+	}
+
 	if ( aes_ctx->decrypting )
 		assert ( 0 );
-	aes_call_axtls ( &aes_ctx->axtls_ctx, src, dst, AES_encrypt );
+	while ( len ) {
+		aes_call_axtls ( &aes_ctx->axtls_ctx, src, dst, AES_encrypt );
+		src += AES_BLOCKSIZE;
+		dst += AES_BLOCKSIZE;
+		len -= AES_BLOCKSIZE;
+	}
 }
 
 /**
@@ -134,12 +210,24 @@ static void aes_decrypt ( void *ctx, const void *src, void *dst,
 			  size_t len ) {
 	struct aes_context *aes_ctx = ctx;
 
-	assert ( len == AES_BLOCKSIZE );
+	assert ( ( len % AES_BLOCKSIZE ) == 0 );
+
+	/* Use hardware accelerator, if available */
+	if ( aes_ctx->accel ) {
+		aes_ctx->accel->decrypt ( &aes_ctx->keys, src, dst, len );
+		return;
+	}
+
 	if ( ! aes_ctx->decrypting ) {
 		AES_convert_key ( &aes_ctx->axtls_ctx );
 		aes_ctx->decrypting = 1;
 	}
-	aes_call_axtls ( &aes_ctx->axtls_ctx, src, dst, AES_decrypt );
+	while ( len ) {
+		aes_call_axtls ( &aes_ctx->axtls_ctx, src, dst, AES_decrypt );
+		src += AES_BLOCKSIZE;
+		dst += AES_BLOCKSIZE;
+		len -= AES_BLOCKSIZE;
+	}
 }
 
 /** Basic AES algorithm */
@@ -156,3 +244,6 @@ struct cipher_algorithm aes_algorithm = {
 /* AES with cipher-block chaining */
 CBC_CIPHER ( aes_cbc, aes_cbc_algorithm,
 	     aes_algorithm, struct aes_context, AES_BLOCKSIZE );
+
+/* AES in Galois/Counter mode */
+GCM_CIPHER ( aes_gcm, aes_gcm_algorithm, aes_algorithm, struct aes_context );
@@ -20,10 +20,94 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <stdint.h>
+#include <byteswap.h>
 #include <ipxe/crc32.h>
+#include <bits/crc32.h>
 
 #define CRCPOLY		0xedb88320
 
+/**
+ * CRC lookup tables
+ *
+ * Table 0 is the standard byte-at-a-time lookup table.  Table @c n
+ * gives the CRC contribution of a byte followed by @c n zero bytes,
+ * which allows eight bytes to be processed with eight independent
+ * lookups ("slicing-by-8").
+ *
+ * The tables are constructed on first use, rather than being
+ * precomputed, in order to avoid adding 8kB to the size of the ROM
+ * image.
+ */
+static u32 crc32_table[8][256];
+
+/** CRC lookup tables have been constructed */
+static int crc32_table_ready;
+
+/**
+ * Construct CRC lookup tables
+ *
+ */
+static void crc32_init_table ( void ) {
+	u32 crc;
+	unsigned int i;
+	unsigned int j;
+
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = i;
+		for ( j = 0 ; j < 8 ; j++ )
+			crc = ( ( crc >> 1 ) ^ ( ( crc & 1 ) ? CRCPOLY : 0 ) );
+		crc32_table[0][i] = crc;
+	}
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = crc32_table[0][i];
+		for ( j = 1 ; j < 8 ; j++ ) {
+			crc = ( ( crc >> 8 ) ^ crc32_table[0][ crc & 0xff ] );
+			crc32_table[j][i] = crc;
+		}
+	}
+	crc32_table_ready = 1;
+}
+
+/** Selected hardware accelerator, if any */
+static struct crc32_accelerator *crc32_accel;
+
+/** Hardware accelerators have been probed */
+static int crc32_accel_probed;
+
+/**
+ * Find usable hardware accelerator
+ *
+ * @ret accel		Hardware accelerator, or NULL
+ */
+static struct crc32_accelerator * crc32_find_accelerator ( void ) {
+	struct crc32_accelerator *accel;
+
+	if ( ! crc32_accel_probed ) {
+		for_each_table_entry ( accel, CRC32_ACCELERATORS ) {
+			if ( accel->supported() ) {
+				DBG ( "CRC32 using %s\n", accel->name );
+				crc32_accel = accel;
+				break;
+			}
+		}
+		crc32_accel_probed = 1;
+	}
+	return crc32_accel;
+}
+
+/**
+ * Update CRC with a single byte
+ *
+ * @v crc	Current CRC value
+ * @v byte	Data byte
+ * @ret crc	Updated CRC value
+ */
+static inline __attribute__ (( always_inline )) u32
+crc32_le_byte ( u32 crc, u8 byte ) {
+	return ( ( crc >> 8 ) ^ crc32_table[0][ ( crc ^ byte ) & 0xff ] );
+}
+
 /**
  * Calculate 32-bit little-endian CRC checksum
  *
@@ -39,16 +123,52 @@ u32 crc32_le ( u32 seed, const void *data, size_t len )
 {
 	u32 crc = seed;
 	const u8 *src = data;
-	u32 mult;
-	int i;
-
-	while ( len-- ) {
-		crc ^= *src++;
-		for ( i = 0; i < 8; i++ ) {
-			mult = ( crc & 1 ) ? CRCPOLY : 0;
-			crc = ( crc >> 1 ) ^ mult;
+	const u32 *dwords;
+	struct crc32_accelerator *accel;
+	size_t accel_len;
+	u32 one;
+	u32 two;
+
+	/* Use hardware acceleration for the bulk of long buffers */
+	if ( len >= CRC32_ACCEL_MIN_LEN ) {
+		accel = crc32_find_accelerator();
+		if ( accel ) {
+			accel_len = ( len & ~( CRC32_ACCEL_BLOCKSIZE - 1 ) );
+			crc = accel->crc32_le ( crc, src, accel_len );
+			src += accel_len;
+			len -= accel_len;
 		}
 	}
 
+	/* Construct lookup tables, if not already done */
+	if ( ! crc32_table_ready )
+		crc32_init_table();
+
+	/* Process leading bytes until we reach dword alignment */
+	while ( len && ( ( ( intptr_t ) src ) & 3 ) ) {
+		crc = crc32_le_byte ( crc, *(src++) );
+		len--;
+	}
+
+	/* Process eight bytes at a time */
+	dwords = ( ( const u32 * ) src );
+	for ( ; len >= 8 ; len -= 8 ) {
+		one = ( le32_to_cpu ( *(dwords++) ) ^ crc );
+		two = le32_to_cpu ( *(dwords++) );
+		crc = ( crc32_table[7][ one & 0xff ] ^
+			crc32_table[6][ ( one >> 8 ) & 0xff ] ^
+			crc32_table[5][ ( one >> 16 ) & 0xff ] ^
+			crc32_table[4][ one >> 24 ] ^
+			crc32_table[3][ two & 0xff ] ^
+			crc32_table[2][ ( two >> 8 ) & 0xff ] ^
+			crc32_table[1][ ( two >> 16 ) & 0xff ] ^
+			crc32_table[0][ two >> 24 ] );
+	}
+	src = ( ( const u8 * ) dwords );
+
+	/* Process any trailing bytes */
+	while ( len-- )
+		crc = crc32_le_byte ( crc, *(src++) );
+
 	return crc;
 }
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/crypto.h>
+#include <ipxe/gcm.h>
+
+/** @file
+ *
+ * Galois/Counter Mode (GCM)
+ *
+ * This implements GCM as described in NIST SP 800-38D, restricted
+ * to 96-bit initialisation vectors.  Additional data and encrypted
+ * data may each be supplied via several calls, provided that all
+ * but the last call for each are multiples of the block size.
+ */
+
+/** Number of counter blocks to encrypt in a single call */
+#define GCM_BATCH 8
+
+/** Reduction constants for software multiplication */
+static const uint16_t gcm_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+/** Selected hardware accelerator, if any */
+static struct gcm_accelerator *gcm_accel;
+
+/** Hardware accelerators have been probed */
+static int gcm_accel_probed;
+
+/**
+ * Find hardware accelerator
+ *
+ * @ret accel		Hardware accelerator, or NULL
+ */
+static struct gcm_accelerator * gcm_find_accelerator ( void ) {
+	struct gcm_accelerator *accel;
+
+	if ( ! gcm_accel_probed ) {
+		for_each_table_entry ( accel, GCM_ACCELERATORS ) {
+			if ( accel->supported() ) {
+				DBG ( "GCM using %s\n", accel->name );
+				gcm_accel = accel;
+				break;
+			}
+		}
+		gcm_accel_probed = 1;
+	}
+	return gcm_accel;
+}
+
+/**
+ * Construct software multiplication table
+ *
+ * @v gcm		GCM context
+ *
+ * The table holds the products of the hash key with each possible
+ * 4-bit value.
+ */
+static void gcm_build_table ( struct gcm_context *gcm ) {
+	uint64_t vh = be64_to_cpu ( gcm->key.qword[0] );
+	uint64_t vl = be64_to_cpu ( gcm->key.qword[1] );
+	uint32_t t;
+	unsigned int i;
+	unsigned int j;
+
+	gcm->hh[0] = 0;
+	gcm->hl[0] = 0;
+	gcm->hh[8] = vh;
+	gcm->hl[8] = vl;
+	for ( i = 4 ; i > 0 ; i >>= 1 ) {
+		t = ( ( vl & 1 ) * 0xe1000000UL );
+		vl = ( ( vh << 63 ) | ( vl >> 1 ) );
+		vh = ( ( vh >> 1 ) ^ ( ( ( uint64_t ) t ) << 32 ) );
+		gcm->hh[i] = vh;
+		gcm->hl[i] = vl;
+	}
+	for ( i = 2 ; i <= 8 ; i <<= 1 ) {
+		for ( j = 1 ; j < i ; j++ ) {
+			gcm->hh[ i + j ] = ( gcm->hh[i] ^ gcm->hh[j] );
+			gcm->hl[ i + j ] = ( gcm->hl[i] ^ gcm->hl[j] );
+		}
+	}
+}
+
+/**
+ * Shift software multiplication result by four bits
+ *
+ * @v zh		High qword
+ * @v zl		Low qword
+ */
+static inline void gcm_shift4 ( uint64_t *zh, uint64_t *zl ) {
+	unsigned int rem = ( *zl & 0x0f );
+
+	*zl = ( ( *zh << 60 ) | ( *zl >> 4 ) );
+	*zh = ( ( *zh >> 4 ) ^ ( ( ( uint64_t ) gcm_last4[rem] ) << 48 ) );
+}
+
+/**
+ * Multiply accumulated hash by hash key
+ *
+ * @v gcm		GCM context
+ */
+static void gcm_multiply ( struct gcm_context *gcm ) {
+	uint8_t *x = gcm->hash.byte;
+	uint64_t zh;
+	uint64_t zl;
+	unsigned int lo;
+	unsigned int hi;
+	int i;
+
+	/* Use hardware accelerator, if available */
+	if ( gcm->accel ) {
+		gcm->accel->multiply ( &gcm->hash, &gcm->key );
+		return;
+	}
+
+	/* Multiply using 4-bit table */
+	lo = ( x[15] & 0x0f );
+	zh = gcm->hh[lo];
+	zl = gcm->hl[lo];
+	for ( i = 15 ; i >= 0 ; i-- ) {
+		lo = ( x[i] & 0x0f );
+		hi = ( x[i] >> 4 );
+		if ( i != 15 ) {
+			gcm_shift4 ( &zh, &zl );
+			zh ^= gcm->hh[lo];
+			zl ^= gcm->hl[lo];
+		}
+		gcm_shift4 ( &zh, &zl );
+		zh ^= gcm->hh[hi];
+		zl ^= gcm->hl[hi];
+	}
+	gcm->hash.qword[0] = cpu_to_be64 ( zh );
+	gcm->hash.qword[1] = cpu_to_be64 ( zl );
+}
+
+/**
+ * Update accumulated hash
+ *
+ * @v gcm		GCM context
+ * @v data		Data
+ * @v len		Length of data
+ *
+ * A trailing partial block is padded with zeroes.
+ */
+static void gcm_hash ( struct gcm_context *gcm, const void *data,
+		       size_t len ) {
+	union gcm_block block;
+	size_t frag_len;
+
+	while ( len ) {
+		frag_len = len;
+		if ( frag_len > sizeof ( block ) ) {
+			frag_len = sizeof ( block );
+		} else {
+			memset ( &block, 0, sizeof ( block ) );
+		}
+		memcpy ( &block, data, frag_len );
+		gcm->hash.qword[0] ^= block.qword[0];
+		gcm->hash.qword[1] ^= block.qword[1];
+		gcm_multiply ( gcm );
+		data += frag_len;
+		len -= frag_len;
+	}
+}
+
+/**
+ * Increment counter block
+ *
+ * @v ctr		Counter block
+ */
+static inline void gcm_increment ( union gcm_block *ctr ) {
+	ctr->dword[3] = cpu_to_be32 ( be32_to_cpu ( ctr->dword[3] ) + 1 );
+}
+
+/**
+ * Encrypt or decrypt data in counter mode
+ *
+ * @v ctx		Context
+ * @v src		Data to process
+ * @v dst		Buffer for processed data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm		GCM context
+ */
+static void gcm_ctr ( void *ctx, const void *src, void *dst, size_t len,
+		      struct cipher_algorithm *raw_cipher,
+		      struct gcm_context *gcm ) {
+	union gcm_block keystream[GCM_BATCH];
+	const uint8_t *in = src;
+	uint8_t *out = dst;
+	uint8_t *ks;
+	unsigned int count;
+	size_t frag_len;
+	unsigned int i;
+
+	while ( len ) {
+
+		/* Generate a batch of keystream blocks */
+		count = ( ( len + sizeof ( keystream[0] ) - 1 ) /
+			  sizeof ( keystream[0] ) );
+		if ( count > GCM_BATCH )
+			count = GCM_BATCH;
+		for ( i = 0 ; i < count ; i++ ) {
+			memcpy ( &keystream[i], &gcm->ctr,
+				 sizeof ( keystream[i] ) );
+			gcm_increment ( &gcm->ctr );
+		}
+		cipher_encrypt ( raw_cipher, ctx, keystream, keystream,
+				 ( count * sizeof ( keystream[0] ) ) );
+
+		/* XOR with data */
+		frag_len = ( count * sizeof ( keystream[0] ) );
+		if ( frag_len > len )
+			frag_len = len;
+		ks = keystream[0].byte;
+		for ( i = 0 ; i < frag_len ; i++ )
+			out[i] = ( in[i] ^ ks[i] );
+		in += frag_len;
+		out += frag_len;
+		len -= frag_len;
+	}
+}
+
+/**
+ * Set key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm		GCM context
+ * @ret rc		Return status code
+ */
+int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm ) {
+	int rc;
+
+	assert ( raw_cipher->blocksize == GCM_BLOCKSIZE );
+
+	/* Set underlying cipher key */
+	if ( ( rc = cipher_setkey ( raw_cipher, ctx, key, keylen ) ) != 0 )
+		return rc;
+
+	/* Construct hash key by encrypting the all-zeroes block */
+	memset ( &gcm->key, 0, sizeof ( gcm->key ) );
+	cipher_encrypt ( raw_cipher, ctx, &gcm->key, &gcm->key,
+			 sizeof ( gcm->key ) );
+
+	/* Use hardware accelerator if available, otherwise build
+	 * software multiplication table.
+	 */
+	gcm->accel = gcm_find_accelerator();
+	if ( ! gcm->accel )
+		gcm_build_table ( gcm );
+
+	return 0;
+}
+
+/**
+ * Set initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector (of length GCM_IV_LEN)
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm		GCM context
+ */
+void gcm_setiv ( void *ctx, const void *iv,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm ) {
+
+	/* Construct initial counter block */
+	memcpy ( &gcm->ctr, iv, GCM_IV_LEN );
+	gcm->ctr.dword[3] = cpu_to_be32 ( 1 );
+	cipher_encrypt ( raw_cipher, ctx, &gcm->ctr, &gcm->ectr0,
+			 sizeof ( gcm->ectr0 ) );
+	gcm_increment ( &gcm->ctr );
+
+	/* Reset accumulated hash */
+	memset ( &gcm->hash, 0, sizeof ( gcm->hash ) );
+	gcm->aad_len = 0;
+	gcm->data_len = 0;
+}
+
+/**
+ * Encrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm		GCM context
+ */
+void gcm_encrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm ) {
+
+	if ( dst ) {
+		gcm_ctr ( ctx, src, dst, len, raw_cipher, gcm );
+		gcm_hash ( gcm, dst, len );
+		gcm->data_len += len;
+	} else {
+		gcm_hash ( gcm, src, len );
+		gcm->aad_len += len;
+	}
+}
+
+/**
+ * Decrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm		GCM context
+ */
+void gcm_decrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm ) {
+
+	gcm_hash ( gcm, src, len );
+	if ( dst ) {
+		gcm_ctr ( ctx, src, dst, len, raw_cipher, gcm );
+		gcm->data_len += len;
+	} else {
+		gcm->aad_len += len;
+	}
+}
+
+/**
+ * Generate authentication tag
+ *
+ * @v ctx		Context
+ * @v auth		Buffer for authentication tag (of length GCM_AUTH_LEN)
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm		GCM context
+ */
+void gcm_auth ( void *ctx __unused, void *auth,
+		struct cipher_algorithm *raw_cipher __unused,
+		struct gcm_context *gcm ) {
+	union gcm_block lengths;
+	union gcm_block *tag = auth;
+
+	/* Hash lengths (in bits) */
+	lengths.qword[0] = cpu_to_be64 ( gcm->aad_len * 8 );
+	lengths.qword[1] = cpu_to_be64 ( gcm->data_len * 8 );
+	gcm_hash ( gcm, &lengths, sizeof ( lengths ) );
+
+	/* Construct tag */
+	tag->qword[0] = ( gcm->hash.qword[0] ^ gcm->ectr0.qword[0] );
+	tag->qword[1] = ( gcm->hash.qword[1] ^ gcm->ectr0.qword[1] );
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * SHA-256 algorithm
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/crypto.h>
+#include <ipxe/sha256.h>
+
+/** SHA-256 initial hash values */
+static const uint32_t sha256_init_hash[] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/** SHA-256 round constants */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/**
+ * Rotate dword right
+ *
+ * @v value		Value
+ * @v bits		Number of bits to rotate
+ * @ret value		Rotated value
+ */
+static inline uint32_t sha256_ror ( uint32_t value, unsigned int bits ) {
+	return ( ( value >> bits ) | ( value << ( 32 - bits ) ) );
+}
+
+/**
+ * Process one SHA-256 block
+ *
+ * @v context		SHA-256 context
+ */
+static void sha256_transform ( struct sha256_context *context ) {
+	const uint32_t *block = ( ( const void * ) context->block );
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t s0, s1, ch, maj, temp1, temp2;
+	unsigned int i;
+
+	/* Prepare message schedule */
+	for ( i = 0 ; i < 16 ; i++ )
+		w[i] = be32_to_cpu ( block[i] );
+	for ( ; i < 64 ; i++ ) {
+		s0 = ( sha256_ror ( w[ i - 15 ], 7 ) ^
+		       sha256_ror ( w[ i - 15 ], 18 ) ^ ( w[ i - 15 ] >> 3 ) );
+		s1 = ( sha256_ror ( w[ i - 2 ], 17 ) ^
+		       sha256_ror ( w[ i - 2 ], 19 ) ^ ( w[ i - 2 ] >> 10 ) );
+		w[i] = ( w[ i - 16 ] + s0 + w[ i - 7 ] + s1 );
+	}
+
+	/* Compress */
+	a = context->hash[0];
+	b = context->hash[1];
+	c = context->hash[2];
+	d = context->hash[3];
+	e = context->hash[4];
+	f = context->hash[5];
+	g = context->hash[6];
+	h = context->hash[7];
+	for ( i = 0 ; i < 64 ; i++ ) {
+		s1 = ( sha256_ror ( e, 6 ) ^ sha256_ror ( e, 11 ) ^
+		       sha256_ror ( e, 25 ) );
+		ch = ( ( e & f ) ^ ( ~e & g ) );
+		temp1 = ( h + s1 + ch + sha256_k[i] + w[i] );
+		s0 = ( sha256_ror ( a, 2 ) ^ sha256_ror ( a, 13 ) ^
+		       sha256_ror ( a, 22 ) );
+		maj = ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+		temp2 = ( s0 + maj );
+		h = g;
+		g = f;
+		f = e;
+		e = ( d + temp1 );
+		d = c;
+		c = b;
+		b = a;
+		a = ( temp1 + temp2 );
+	}
+	context->hash[0] += a;
+	context->hash[1] += b;
+	context->hash[2] += c;
+	context->hash[3] += d;
+	context->hash[4] += e;
+	context->hash[5] += f;
+	context->hash[6] += g;
+	context->hash[7] += h;
+}
+
+/**
+ * Initialise SHA-256 digest
+ *
+ * @v ctx		SHA-256 context
+ */
+static void sha256_init ( void *ctx ) {
+	struct sha256_context *context = ctx;
+
+	memcpy ( context->hash, sha256_init_hash, sizeof ( context->hash ) );
+	context->byte_count = 0;
+}
+
+/**
+ * Update SHA-256 digest with new data
+ *
+ * @v ctx		SHA-256 context
+ * @v src		Data to digest
+ * @v len		Length of data
+ */
+static void sha256_update ( void *ctx, const void *src, size_t len ) {
+	struct sha256_context *context = ctx;
+	size_t offset;
+	size_t frag_len;
+
+	while ( len ) {
+		offset = ( context->byte_count % sizeof ( context->block ) );
+		frag_len = ( sizeof ( context->block ) - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( ( context->block + offset ), src, frag_len );
+		context->byte_count += frag_len;
+		src += frag_len;
+		len -= frag_len;
+		if ( ( offset + frag_len ) == sizeof ( context->block ) )
+			sha256_transform ( context );
+	}
+}
+
+/**
+ * Finalise SHA-256 digest
+ *
+ * @v ctx		SHA-256 context
+ * @v out		Buffer for digest output
+ */
+static void sha256_final ( void *ctx, void *out ) {
+	struct sha256_context *context = ctx;
+	uint64_t bit_count = cpu_to_be64 ( context->byte_count * 8 );
+	static const uint8_t pad[SHA256_BLOCK_SIZE] = { 0x80 };
+	uint32_t *digest = out;
+	size_t offset;
+	unsigned int i;
+
+	/* Pad to leave room for the bit count in the final block */
+	offset = ( context->byte_count % sizeof ( context->block ) );
+	sha256_update ( context, pad,
+			( ( ( 2 * sizeof ( context->block ) ) -
+			    sizeof ( bit_count ) - offset - 1 ) %
+			  sizeof ( context->block ) ) + 1 );
+	sha256_update ( context, &bit_count, sizeof ( bit_count ) );
+
+	/* Construct digest */
+	for ( i = 0 ; i < ( sizeof ( context->hash ) /
+			    sizeof ( context->hash[0] ) ) ; i++ ) {
+		digest[i] = cpu_to_be32 ( context->hash[i] );
+	}
+}
+
+/** SHA-256 algorithm */
+struct digest_algorithm sha256_algorithm = {
+	.name		= "sha256",
+	.ctxsize	= sizeof ( struct sha256_context ),
+	.blocksize	= SHA256_BLOCK_SIZE,
+	.digestsize	= SHA256_DIGEST_SIZE,
+	.init		= sha256_init,
+	.update		= sha256_update,
+	.final		= sha256_final,
+};
@@ -125,12 +125,16 @@ void vring_add_buf(struct vring_virtqueue *vq,
 void vring_kick(unsigned int ioaddr, struct vring_virtqueue *vq, int num_added)
 {
    struct vring *vr = &vq->vring;
+   u16 old, new;
 
    wmb();
-   vr->avail->idx += num_added;
+   old = vr->avail->idx;
+   new = old + num_added;
+   vr->avail->idx = new;
 
    mb();
-   if (!(vr->used->flags & VRING_USED_F_NO_NOTIFY))
+   if (vq->event ? vring_need_event(vring_avail_event(vr), new, old) :
+       !(vr->used->flags & VRING_USED_F_NO_NOTIFY))
            vp_notify(ioaddr, vq->queue_index);
 }
 
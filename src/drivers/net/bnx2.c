@@ -19,6 +19,8 @@ FILE_LICENCE ( GPL_ANY );
 #include <errno.h>
 #include <ipxe/pci.h>
 #include <ipxe/ethernet.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/netdevice.h>
 #include "string.h"
 #include <mii.h>
 #include "bnx2.h"
@@ -2549,6 +2551,13 @@ bnx2_poll(struct nic* nic, int retrieve)
 			{
 				nic->packetlen = len;
 				memcpy(nic->packet, data + bp->rx_offset, len);
+				if ((status & (L2_FHDR_STATUS_TCP_SEGMENT |
+					       L2_FHDR_STATUS_UDP_DATAGRAM)) &&
+				    !(status & (L2_FHDR_ERRORS_TCP_XSUM |
+						L2_FHDR_ERRORS_UDP_XSUM))) {
+					nic->packetflags |=
+						IOB_FL_CSUM_VERIFIED;
+				}
 				result = 1;
 			}
 
@@ -2635,6 +2644,7 @@ bnx2_probe(struct nic *nic, struct pci_device *pdev)
 	*/
 	
 	nic->nic_op	= &bnx2_operations;
+	nic->caps |= NETDEV_CAP_RX_CSUM;
 
 	memcpy(nic->node_addr, bp->mac_addr, ETH_ALEN);
 	printf("Ethernet addr: %s\n", eth_ntoa( nic->node_addr ) );
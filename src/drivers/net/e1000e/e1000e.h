@@ -169,8 +169,20 @@ struct e1000_adapter {
 	unsigned int flags;
 	unsigned int flags2;
 
-#define NUM_TX_DESC	8
-#define NUM_RX_DESC	8
+/* Descriptor ring sizes may be overridden at build time, e.g. with
+ * EXTRA_CFLAGS=-DE1000E_NUM_RX_DESC=64.  Each must be a power of two
+ * no smaller than 8, since the rings are aligned to their own size
+ * and the hardware requires a multiple of 128 bytes.  Every receive
+ * descriptor holds a 2kB I/O buffer allocated from the heap.
+ */
+#ifndef E1000E_NUM_TX_DESC
+#define E1000E_NUM_TX_DESC	64
+#endif
+#ifndef E1000E_NUM_RX_DESC
+#define E1000E_NUM_RX_DESC	32
+#endif
+#define NUM_TX_DESC	E1000E_NUM_TX_DESC
+#define NUM_RX_DESC	E1000E_NUM_RX_DESC
 
 	struct io_buffer *tx_iobuf[NUM_TX_DESC];
 	struct io_buffer *rx_iobuf[NUM_RX_DESC];
@@ -685,6 +685,7 @@ static void e1000e_free_rx_resources ( struct e1000_adapter *adapter )
 static int e1000e_refill_rx_ring ( struct e1000_adapter *adapter )
 {
 	int i, rx_curr;
+	int rx_tail = -1;
 	int rc = 0;
 	struct e1000_rx_desc *rx_curr_desc;
 	struct e1000_hw *hw = &adapter->hw;
@@ -713,10 +714,14 @@ static int e1000e_refill_rx_ring ( struct e1000_adapter *adapter )
 			break;
 		} else {
 			rx_curr_desc->buffer_addr = virt_to_bus ( iob->data );
-
-			E1000_WRITE_REG ( hw, E1000_RDT(0), rx_curr );
+			rx_tail = rx_curr;
 		}
 	}
+
+	/* Hand all refilled descriptors to the hardware at once */
+	if ( rx_tail >= 0 )
+		E1000_WRITE_REG ( hw, E1000_RDT(0), rx_tail );
+
 	return rc;
 }
 
@@ -789,6 +794,10 @@ static void e1000e_configure_rx ( struct e1000_adapter *adapter )
 	E1000_WRITE_REG ( hw, E1000_RDH(0), 0 );
 	E1000_WRITE_REG ( hw, E1000_RDT(0), NUM_RX_DESC - 1 );
 
+	/* Enable TCP/UDP receive checksum offload */
+	E1000_WRITE_REG ( hw, E1000_RXCSUM,
+			  ( E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL ) );
+
 	/* Enable Receives */
 	rctl |=	 E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SZ_2048 |
 		 E1000_RCTL_MPE;
@@ -800,6 +809,22 @@ static void e1000e_configure_rx ( struct e1000_adapter *adapter )
 	DBG ( "E1000_RCTL:  %#08x\n",  E1000_READ_REG ( hw, E1000_RCTL ) );
 }
 
+/**
+ * e1000e_rx_csum_verified - check for hardware-verified TCP/UDP checksum
+ *
+ * @v rx_status	Receive descriptor status
+ * @v rx_err	Receive descriptor errors
+ * @ret verified	Transport-layer checksum has been verified
+ **/
+static inline int e1000e_rx_csum_verified ( uint32_t rx_status,
+					    uint32_t rx_err )
+{
+	return ( ( rx_status & ( E1000_RXD_STAT_TCPCS |
+				 E1000_RXD_STAT_UDPCS ) ) &&
+		 ! ( rx_status & E1000_RXD_STAT_IXSM ) &&
+		 ! ( rx_err & E1000_RXD_ERR_TCPE ) );
+}
+
 /**
  * e1000_process_rx_packets - process received packets
  *
@@ -849,6 +874,13 @@ static void e1000e_process_rx_packets ( struct net_device *netdev )
 			DBG ( "e1000_poll: Corrupted packet received!"
 			      " rx_err: %#08x\n", rx_err );
 		} else	{
+			/* Skip software checksum verification if possible */
+			if ( ( netdev->caps & NETDEV_CAP_RX_CSUM ) &&
+			     e1000e_rx_csum_verified ( rx_status, rx_err ) ) {
+				adapter->rx_iobuf[i]->flags |=
+					IOB_FL_CSUM_VERIFIED;
+			}
+
 			/* Add this packet to the receive queue. */
 			netdev_rx ( netdev, adapter->rx_iobuf[i] );
 		}
@@ -967,6 +999,10 @@ static void e1000e_poll ( struct net_device *netdev )
 
 	DBG ( "e1000_poll: intr_status = %#08x\n", icr );
 
+	/* Record packets dropped for lack of receive descriptors */
+	if ( icr & E1000_ICR_RXO )
+		netdev_rx_overrun ( netdev, E1000_READ_REG ( hw, E1000_MPC ) );
+
 	e1000e_process_tx_packets ( netdev );
 
 	e1000e_process_rx_packets ( netdev );
@@ -1115,6 +1151,9 @@ int e1000e_probe ( struct pci_device *pdev )
 
 	DBG ( "adapter->hw.mac.type: %#08x\n", adapter->hw.mac.type );
 
+	/* Hardware can verify TCP/UDP receive checksums */
+	netdev->caps |= NETDEV_CAP_RX_CSUM;
+
 	/* Force auto-negotiation */
 	adapter->hw.mac.autoneg = 1;
 	adapter->fc_autoneg = 1;
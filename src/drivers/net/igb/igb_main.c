@@ -393,6 +393,7 @@ static void igb_free_rx_resources ( struct igb_adapter *adapter )
 static int igb_refill_rx_ring ( struct igb_adapter *adapter )
 {
 	int i, rx_curr;
+	int rx_tail = -1;
 	int rc = 0;
 	struct e1000_rx_desc *rx_curr_desc;
 	struct e1000_hw *hw = &adapter->hw;
@@ -421,10 +422,14 @@ static int igb_refill_rx_ring ( struct igb_adapter *adapter )
 			break;
 		} else {
 			rx_curr_desc->buffer_addr = virt_to_bus ( iob->data );
-
-			E1000_WRITE_REG ( hw, E1000_RDT(0), rx_curr );
+			rx_tail = rx_curr;
 		}
 	}
+
+	/* Hand all refilled descriptors to the hardware at once */
+	if ( rx_tail >= 0 )
+		E1000_WRITE_REG ( hw, E1000_RDT(0), rx_tail );
+
 	return rc;
 }
 
@@ -510,9 +515,11 @@ static void igb_configure_rx ( struct igb_adapter *adapter )
 	E1000_WRITE_REG ( hw, E1000_RXDCTL(0), rxdctl );
 	E1000_WRITE_FLUSH ( hw );
 
+	/* Enable TCP/UDP receive checksum offload */
 	rxcsum = E1000_READ_REG(hw, E1000_RXCSUM);
-	rxcsum &= ~( E1000_RXCSUM_TUOFL | E1000_RXCSUM_IPPCSE );
-	E1000_WRITE_REG ( hw, E1000_RXCSUM, 0 );
+	rxcsum &= ~E1000_RXCSUM_IPPCSE;
+	rxcsum |= ( E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL );
+	E1000_WRITE_REG ( hw, E1000_RXCSUM, rxcsum );
 
 	/* The initial value for MRQC disables multiple receive
 	 * queues, however this setting is not recommended.
@@ -564,6 +571,22 @@ static void igb_configure_rx ( struct igb_adapter *adapter )
 	DBG ( "RCTL:  %#08x\n",	 E1000_READ_REG ( hw, E1000_RCTL ) );
 }
 
+/**
+ * igb_rx_csum_verified - check for hardware-verified TCP/UDP checksum
+ *
+ * @v rx_status	Receive descriptor status
+ * @v rx_err	Receive descriptor errors
+ * @ret verified	Transport-layer checksum has been verified
+ **/
+static inline int igb_rx_csum_verified ( uint32_t rx_status,
+					 uint32_t rx_err )
+{
+	return ( ( rx_status & ( E1000_RXD_STAT_TCPCS |
+				 E1000_RXD_STAT_UDPCS ) ) &&
+		 ! ( rx_status & E1000_RXD_STAT_IXSM ) &&
+		 ! ( rx_err & E1000_RXD_ERR_TCPE ) );
+}
+
 /**
  * igb_process_rx_packets - process received packets
  *
@@ -615,6 +638,13 @@ static void igb_process_rx_packets ( struct net_device *netdev )
 			DBG ( "igb_process_rx_packets: Corrupted packet received!"
 			      " rx_err: %#08x\n", rx_err );
 		} else	{
+			/* Skip software checksum verification if possible */
+			if ( ( netdev->caps & NETDEV_CAP_RX_CSUM ) &&
+			     igb_rx_csum_verified ( rx_status, rx_err ) ) {
+				adapter->rx_iobuf[i]->flags |=
+					IOB_FL_CSUM_VERIFIED;
+			}
+
 			/* Add this packet to the receive queue. */
 			netdev_rx ( netdev, adapter->rx_iobuf[i] );
 		}
@@ -733,6 +763,10 @@ static void igb_poll ( struct net_device *netdev )
 
 	DBG ( "igb_poll: intr_status = %#08x\n", icr );
 
+	/* Record packets dropped for lack of receive descriptors */
+	if ( icr & E1000_ICR_RXO )
+		netdev_rx_overrun ( netdev, E1000_READ_REG ( hw, E1000_MPC ) );
+
 	igb_process_tx_packets ( netdev );
 
 	igb_process_rx_packets ( netdev );
@@ -857,6 +891,9 @@ int igb_probe ( struct pci_device *pdev )
 
 	DBG ( "adapter->hw.mac.type: %#08x\n", adapter->hw.mac.type );
 
+	/* Hardware can verify TCP/UDP receive checksums */
+	netdev->caps |= NETDEV_CAP_RX_CSUM;
+
 	/* Force auto-negotiation */
 	adapter->hw.mac.autoneg = 1;
 	adapter->fc_autoneg = 1;
@@ -47,9 +47,11 @@ static void legacy_poll ( struct net_device *netdev ) {
 		return;
 
 	nic->packet = iobuf->data;
+	nic->packetflags = 0;
 	if ( nic->nic_op->poll ( nic, 1 ) ) {
 		DBG ( "Received %d bytes\n", nic->packetlen );
 		iob_put ( iobuf, nic->packetlen );
+		iobuf->flags |= nic->packetflags;
 		netdev_rx ( netdev, iobuf );
 	} else {
 		free_iob ( iobuf );
@@ -114,6 +116,9 @@ int legacy_probe ( void *hwdev,
 	 */
 	dev->desc.irq = nic.irqno;
 
+	/* Copy any capabilities advertised by the probe routine */
+	netdev->caps = nic.caps;
+
 	if ( ( rc = register_netdev ( netdev ) ) != 0 )
 		goto err_register;
 
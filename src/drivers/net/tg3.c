@@ -19,6 +19,8 @@ FILE_LICENCE ( GPL2_ONLY );
 #include <errno.h>
 #include <ipxe/pci.h>
 #include <ipxe/ethernet.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/netdevice.h>
 #include "string.h"
 #include <mii.h>
 #include "tg3.h"
@@ -1891,7 +1893,9 @@ static int tg3_setup_hw(struct tg3 *tp)
 			  GRC_MODE_NO_RX_PHDR_CSUM);
 	tp->grc_mode |= GRC_MODE_HOST_SENDBDS;
 	tp->grc_mode |= GRC_MODE_NO_TX_PHDR_CSUM;
-	tp->grc_mode |= GRC_MODE_NO_RX_PHDR_CSUM;
+	/* Leave the pseudo-header in the receive checksum, so that a
+	 * valid TCP/UDP packet is reported with a checksum of 0xffff.
+	 */
 
 	tw32(GRC_MODE,
 		tp->grc_mode | 
@@ -2786,6 +2790,10 @@ static int tg3_get_invariants(struct tg3 *tp)
 	if ((pci_state_reg & PCISTATE_BUS_32BIT) != 0)
 		tp->tg3_flags |= TG3_FLAG_PCI_32BIT;
 
+	/* The 5700 B0 cannot be trusted to verify receive checksums */
+	if (tp->pci_chip_rev_id == CHIPREV_ID_5700_B0)
+		tp->tg3_flags |= TG3_FLAG_BROKEN_CHECKSUMS;
+
 	/* Chip-specific fixup from Broadcom driver */
 	if ((tp->pci_chip_rev_id == CHIPREV_ID_5704_A0) &&
 	    (!(pci_state_reg & PCISTATE_RETRY_SAME_DMA))) {
@@ -3120,6 +3128,13 @@ static int tg3_poll(struct nic *nic, int retrieve)
 			
 			nic->packetlen = len;
 			memcpy(nic->packet, bus_to_virt(desc->addr_lo), len);
+			if ((nic->caps & NETDEV_CAP_RX_CSUM) &&
+			    (desc->type_flags & RXD_FLAG_TCPUDP_CSUM) &&
+			    !(desc->type_flags & RXD_FLAG_ERROR) &&
+			    (((desc->ip_tcp_csum & RXD_TCPCSUM_MASK)
+			      >> RXD_TCPCSUM_SHIFT) == 0xffff)) {
+				nic->packetflags |= IOB_FL_CSUM_VERIFIED;
+			}
 			result = 1;
 		}
 		tp->rx_rcb_ptr = (tp->rx_rcb_ptr + 1) % TG3_RX_RCB_RING_SIZE;
@@ -3374,6 +3389,9 @@ static int tg3_probe ( struct nic *nic, struct pci_device *pdev ) {
 		goto err_out_disable;
 	}
 
+	if (!(tp->tg3_flags & TG3_FLAG_BROKEN_CHECKSUMS))
+		nic->caps |= NETDEV_CAP_RX_CSUM;
+
 	nic->nic_op	= &tg3_operations;
 	return 1;
 
@@ -59,6 +59,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * than space, it is heavy-weight and allocated like traditional descriptor
  * rings in the open() function of the driver and not in probe().
  *
+ * The driver negotiates VIRTIO_NET_F_MRG_RXBUF, which allows the virtio net
+ * header and the packet to share a single rx descriptor,
+ * VIRTIO_NET_F_GUEST_CSUM, which allows the host to skip checksumming packets
+ * that it has already validated, and VIRTIO_RING_F_EVENT_IDX, which allows
+ * the host to suppress unnecessary kicks.  None of these are required.
+ *
  * There is no true interrupt enable/disable.  Virtqueues have callback
  * enable/disable flags but these are only hints.  The hypervisor may still
  * raise an interrupt.  Nevertheless, this driver disables callbacks in the
@@ -76,9 +82,20 @@ enum {
 	QUEUE_NB
 };
 
+/** Max number of pending rx packets
+ *
+ * May be overridden at build time, e.g. with
+ * EXTRA_CFLAGS=-DVIRTIO_NET_NUM_RX_BUF=64.  Each pending rx packet
+ * uses two descriptors, so the number actually used is also limited
+ * to half of the rx virtqueue size.
+ */
+#ifndef VIRTIO_NET_NUM_RX_BUF
+#define VIRTIO_NET_NUM_RX_BUF 32
+#endif
+
 enum {
 	/** Max number of pending rx packets */
-	NUM_RX_BUF = 8,
+	NUM_RX_BUF = VIRTIO_NET_NUM_RX_BUF,
 
 	/** Max Ethernet frame length, including FCS and VLAN tag */
 	RX_BUF_SIZE = 1522,
@@ -97,45 +114,86 @@ struct virtnet_nic {
 	/** Pending rx packet count */
 	unsigned int rx_num_iobufs;
 
-	/** Virtio net packet header, we only need one */
-	struct virtio_net_hdr empty_header;
+	/** Negotiated features */
+	u32 features;
+
+	/** Length of virtio net packet header */
+	size_t hdr_len;
+
+	/** Number of rx buffers remaining to be discarded */
+	unsigned int rx_discard;
+
+	/** Virtio net tx packet header, we only need one */
+	struct virtio_net_hdr_mrg_rxbuf empty_header;
 };
 
+/** Features supported by this driver */
+#define VIRTNET_FEATURES ( ( 1 << VIRTIO_NET_F_MAC ) |			\
+			   ( 1 << VIRTIO_NET_F_GUEST_CSUM ) |		\
+			   ( 1 << VIRTIO_NET_F_MRG_RXBUF ) |		\
+			   ( 1 << VIRTIO_RING_F_EVENT_IDX ) )
+
+/** Check if a feature has been negotiated
+ *
+ * @v virtnet		Virtio-net NIC
+ * @v feature		Feature bit
+ * @ret negotiated	Feature has been negotiated
+ */
+static inline int virtnet_has_feature ( struct virtnet_nic *virtnet,
+					unsigned int feature ) {
+	return ( virtnet->features & ( 1 << feature ) );
+}
+
 /** Add an iobuf to a virtqueue
  *
  * @v netdev		Network device
  * @v vq_idx		Virtqueue index (RX_INDEX or TX_INDEX)
  * @v iobuf		I/O buffer
+ * @v num_added		Number of iobufs already added since the last kick
  *
- * The virtqueue is kicked after the iobuf has been added.
+ * The caller must kick the virtqueue after adding a batch of iobufs.
  */
 static void virtnet_enqueue_iob ( struct net_device *netdev,
-				  int vq_idx, struct io_buffer *iobuf ) {
+				  int vq_idx, struct io_buffer *iobuf,
+				  int num_added ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 	struct vring_virtqueue *vq = &virtnet->virtqueue[vq_idx];
-	unsigned int out = ( vq_idx == TX_INDEX ) ? 2 : 0;
-	unsigned int in = ( vq_idx == TX_INDEX ) ? 0 : 2;
-	struct vring_list list[] = {
-		{
-			/* Share a single zeroed virtio net header between all
-			 * rx and tx packets.  This works because this driver
-			 * does not use any advanced features so none of the
-			 * header fields get used.
-			 */
-			.addr = ( char* ) &virtnet->empty_header,
-			.length = sizeof ( virtnet->empty_header ),
-		},
-		{
-			.addr = ( char* ) iobuf->data,
-			.length = iob_len ( iobuf ),
-		},
-	};
+	struct vring_list list[2];
+	unsigned int count;
+
+	if ( vq_idx == TX_INDEX ) {
+		/* Share a single zeroed virtio net header between all tx
+		 * packets.  This works because this driver does not use
+		 * any tx offloads so none of the header fields get used.
+		 */
+		list[0].addr = ( char * ) &virtnet->empty_header;
+		list[0].length = virtnet->hdr_len;
+		list[1].addr = ( char * ) iobuf->data;
+		list[1].length = iob_len ( iobuf );
+		count = 2;
+	} else if ( virtnet_has_feature ( virtnet, VIRTIO_NET_F_MRG_RXBUF ) ) {
+		/* Receive header and packet into a single descriptor */
+		list[0].addr = ( char * ) iobuf->data;
+		list[0].length = iob_len ( iobuf );
+		count = 1;
+	} else {
+		/* Receive header and packet into separate descriptors,
+		 * both within the iobuf so that each packet keeps its
+		 * own header.
+		 */
+		list[0].addr = ( char * ) iobuf->data;
+		list[0].length = virtnet->hdr_len;
+		list[1].addr = ( char * ) ( iobuf->data + virtnet->hdr_len );
+		list[1].length = ( iob_len ( iobuf ) - virtnet->hdr_len );
+		count = 2;
+	}
 
 	DBGC ( virtnet, "VIRTIO-NET %p enqueuing iobuf %p on vq %d\n",
 	       virtnet, iobuf, vq_idx );
 
-	vring_add_buf ( vq, list, out, in, iobuf, 0 );
-	vring_kick ( virtnet->ioaddr, vq, 1 );
+	vring_add_buf ( vq, list, ( ( vq_idx == TX_INDEX ) ? count : 0 ),
+			( ( vq_idx == TX_INDEX ) ? 0 : count ), iobuf,
+			num_added );
 }
 
 /** Try to keep rx virtqueue filled with iobufs
@@ -144,12 +202,25 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
  */
 static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
+	struct vring_virtqueue *rx_vq = &virtnet->virtqueue[RX_INDEX];
+	size_t len = ( virtnet->hdr_len + RX_BUF_SIZE );
+	unsigned int max_iobufs = rx_vq->vring.num;
+	int num_added = 0;
+
+	/* Each rx packet needs two descriptors unless the header and
+	 * packet can share a descriptor.
+	 */
+	if ( ! virtnet_has_feature ( virtnet, VIRTIO_NET_F_MRG_RXBUF ) )
+		max_iobufs /= 2;
 
-	while ( virtnet->rx_num_iobufs < NUM_RX_BUF ) {
+	if ( max_iobufs > NUM_RX_BUF )
+		max_iobufs = NUM_RX_BUF;
+
+	while ( virtnet->rx_num_iobufs < max_iobufs ) {
 		struct io_buffer *iobuf;
 
 		/* Try to allocate a buffer, stop for now if out of memory */
-		iobuf = alloc_iob ( RX_BUF_SIZE );
+		iobuf = alloc_iob ( len );
 		if ( ! iobuf )
 			break;
 
@@ -157,11 +228,15 @@ static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 		list_add ( &iobuf->list, &virtnet->rx_iobufs );
 
 		/* Mark packet length until we know the actual size */
-		iob_put ( iobuf, RX_BUF_SIZE );
+		iob_put ( iobuf, len );
 
-		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf );
+		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf, num_added++ );
 		virtnet->rx_num_iobufs++;
 	}
+
+	/* Notify the device of all new rx packets at once */
+	if ( num_added )
+		vring_kick ( virtnet->ioaddr, rx_vq, num_added );
 }
 
 /** Open network device
@@ -178,6 +253,22 @@ static int virtnet_open ( struct net_device *netdev ) {
 	/* Reset for sanity */
 	vp_reset ( ioaddr );
 
+	/* Negotiate features */
+	features = vp_get_features ( ioaddr );
+	virtnet->features = ( features & VIRTNET_FEATURES );
+	vp_set_features ( ioaddr, virtnet->features );
+	virtnet->hdr_len =
+		( virtnet_has_feature ( virtnet, VIRTIO_NET_F_MRG_RXBUF ) ?
+		  sizeof ( struct virtio_net_hdr_mrg_rxbuf ) :
+		  sizeof ( struct virtio_net_hdr ) );
+	DBGC ( virtnet, "VIRTIO-NET %p features %#08x (using %#08x)\n",
+	       virtnet, features, virtnet->features );
+	if ( virtnet_has_feature ( virtnet, VIRTIO_NET_F_GUEST_CSUM ) ) {
+		netdev->caps |= NETDEV_CAP_RX_CSUM;
+	} else {
+		netdev->caps &= ~NETDEV_CAP_RX_CSUM;
+	}
+
 	/* Allocate virtqueues */
 	virtnet->virtqueue = zalloc ( QUEUE_NB *
 				      sizeof ( *virtnet->virtqueue ) );
@@ -193,19 +284,20 @@ static int virtnet_open ( struct net_device *netdev ) {
 			virtnet->virtqueue = NULL;
 			return -ENOENT;
 		}
+		virtnet->virtqueue[i].event = virtnet_has_feature ( virtnet,
+						VIRTIO_RING_F_EVENT_IDX );
 	}
 
 	/* Initialize rx packets */
 	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
 	virtnet->rx_num_iobufs = 0;
+	virtnet->rx_discard = 0;
 	virtnet_refill_rx_virtqueue ( netdev );
 
 	/* Disable interrupts before starting */
 	netdev_irq ( netdev, 0 );
 
 	/* Driver is ready */
-	features = vp_get_features ( ioaddr );
-	vp_set_features ( ioaddr, features & ( 1 << VIRTIO_NET_F_MAC ) );
 	vp_set_status ( ioaddr, VIRTIO_CONFIG_S_DRIVER | VIRTIO_CONFIG_S_DRIVER_OK );
 	return 0;
 }
@@ -241,7 +333,10 @@ static void virtnet_close ( struct net_device *netdev ) {
  */
 static int virtnet_transmit ( struct net_device *netdev,
 			      struct io_buffer *iobuf ) {
-	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf );
+	struct virtnet_nic *virtnet = netdev->priv;
+
+	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf, 0 );
+	vring_kick ( virtnet->ioaddr, &virtnet->virtqueue[TX_INDEX], 1 );
 	return 0;
 }
 
@@ -274,14 +369,54 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
 	while ( vring_more_used ( rx_vq ) ) {
 		unsigned int len;
 		struct io_buffer *iobuf = vring_get_buf ( rx_vq, &len );
+		struct virtio_net_hdr_mrg_rxbuf *header = iobuf->data;
 
 		/* Release ownership of iobuf */
 		list_del ( &iobuf->list );
 		virtnet->rx_num_iobufs--;
 
-		/* Update iobuf length */
-		iob_unput ( iobuf, RX_BUF_SIZE );
-		iob_put ( iobuf, len - sizeof ( struct virtio_net_hdr ) );
+		/* Discard remaining buffers of an oversized packet */
+		if ( virtnet->rx_discard ) {
+			virtnet->rx_discard--;
+			free_iob ( iobuf );
+			continue;
+		}
+
+		/* Sanity check */
+		if ( ( len < virtnet->hdr_len ) ||
+		     ( len > iob_len ( iobuf ) ) ) {
+			DBGC ( virtnet, "VIRTIO-NET %p rx iobuf %p has invalid "
+			       "length %d\n", virtnet, iobuf, len );
+			netdev_rx_err ( netdev, iobuf, -EINVAL );
+			continue;
+		}
+
+		/* Drop packets that did not fit within a single buffer.
+		 * This can happen only with merged rx buffers, and only
+		 * for frames larger than our maximum frame size.
+		 */
+		if ( virtnet_has_feature ( virtnet, VIRTIO_NET_F_MRG_RXBUF ) &&
+		     ( header->num_buffers > 1 ) ) {
+			DBGC ( virtnet, "VIRTIO-NET %p rx packet spans %d "
+			       "buffers\n", virtnet, header->num_buffers );
+			virtnet->rx_discard = ( header->num_buffers - 1 );
+			netdev_rx_err ( netdev, iobuf, -ERANGE );
+			continue;
+		}
+
+		/* Skip transport-layer checksum verification if the host
+		 * has already validated the checksum, or if the packet
+		 * originated within the host and so was never checksummed.
+		 */
+		if ( ( netdev->caps & NETDEV_CAP_RX_CSUM ) &&
+		     ( header->hdr.flags & ( VIRTIO_NET_HDR_F_NEEDS_CSUM |
+					     VIRTIO_NET_HDR_F_DATA_VALID ) ) ) {
+			iobuf->flags |= IOB_FL_CSUM_VERIFIED;
+		}
+
+		/* Update iobuf length and strip header */
+		iob_unput ( iobuf, ( iob_len ( iobuf ) - len ) );
+		iob_pull ( iobuf, virtnet->hdr_len );
 
 		DBGC ( virtnet, "VIRTIO-NET %p rx complete iobuf %p len %zd\n",
 		       virtnet, iobuf, iob_len ( iobuf ) );
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <ipxe/timer.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <usr/bench.h>
+
+/** @file
+ *
+ * Benchmark commands
+ *
+ */
+
+/** Default microbenchmark duration (in seconds) */
+#define BENCH_DEFAULT_TIME 1
+
+/** "bench" options */
+struct bench_options {
+	/** Microbenchmark duration (in seconds) */
+	unsigned int time;
+	/** Treat URIs as block devices */
+	int block;
+	/** Maximum length to read from block devices (in MB) */
+	unsigned int size;
+};
+
+/** "bench" option list */
+static struct option_descriptor bench_opts[] = {
+	OPTION_DESC ( "time", 't', required_argument,
+		      struct bench_options, time, parse_integer ),
+	OPTION_DESC ( "block", 'b', no_argument,
+		      struct bench_options, block, parse_flag ),
+	OPTION_DESC ( "size", 's', required_argument,
+		      struct bench_options, size, parse_integer ),
+};
+
+/** "bench" command descriptor */
+static struct command_descriptor bench_cmd =
+	COMMAND_DESC ( struct bench_options, bench_opts, 0, MAX_ARGUMENTS,
+		       "[--time <secs>] [--block [--size <MB>]] [<uri>...]" );
+
+/**
+ * The "bench" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int bench_exec ( int argc, char **argv ) {
+	struct bench_options opts;
+	const char *uri_string;
+	int rc;
+
+	/* Initialise options */
+	memset ( &opts, 0, sizeof ( opts ) );
+	opts.time = BENCH_DEFAULT_TIME;
+
+	/* Parse options */
+	if ( ( rc = reparse_options ( argc, argv, &bench_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Run microbenchmarks if no URIs are specified */
+	if ( optind == argc )
+		return bench_micro ( opts.time * TICKS_PER_SEC );
+
+	/* Benchmark each URI in turn */
+	for ( ; optind < argc ; optind++ ) {
+		uri_string = argv[optind];
+		if ( opts.block ) {
+			rc = bench_block ( uri_string,
+					   ( opts.size * 1024UL * 1024UL ) );
+		} else {
+			rc = bench_download ( uri_string );
+		}
+		if ( rc != 0 )
+			return rc;
+	}
+
+	return 0;
+}
+
+/** Benchmark commands */
+struct command bench_command __command = {
+	.name = "bench",
+	.exec = bench_exec,
+};
@@ -164,6 +164,40 @@ static int ifstat_exec ( int argc, char **argv ) {
 	return ifcommon_exec ( argc, argv, &ifstat_cmd, ifstat_payload, 0 );
 }
 
+/** "netstat" command descriptor */
+static struct command_descriptor netstat_cmd =
+	COMMAND_DESC ( struct ifcommon_options, ifcommon_opts, 0, MAX_ARGUMENTS,
+		       "[<interface>...]" );
+
+/**
+ * "netstat" payload
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int netstat_payload ( struct net_device *netdev ) {
+	netstat ( netdev );
+	return 0;
+}
+
+/**
+ * The "netstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int netstat_exec ( int argc, char **argv ) {
+	int rc;
+
+	if ( ( rc = ifcommon_exec ( argc, argv, &netstat_cmd,
+				    netstat_payload, 0 ) ) != 0 )
+		return rc;
+
+	iobstat();
+	return 0;
+}
+
 /** Interface management commands */
 struct command ifmgmt_commands[] __command = {
 	{
@@ -178,4 +212,8 @@ struct command ifmgmt_commands[] __command = {
 		.name = "ifstat",
 		.exec = ifstat_exec,
 	},
+	{
+		.name = "netstat",
+		.exec = netstat_exec,
+	},
 };
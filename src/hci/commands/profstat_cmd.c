@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/profile.h>
+
+/** @file
+ *
+ * Profiling commands
+ *
+ */
+
+/** "profstat" options */
+struct profstat_options {
+	/** Reset profilers after displaying */
+	int reset;
+};
+
+/** "profstat" option list */
+static struct option_descriptor profstat_opts[] = {
+	OPTION_DESC ( "reset", 'r', no_argument,
+		      struct profstat_options, reset, parse_flag ),
+};
+
+/** "profstat" command descriptor */
+static struct command_descriptor profstat_cmd =
+	COMMAND_DESC ( struct profstat_options, profstat_opts, 0, 0,
+		       "[--reset]" );
+
+/**
+ * The "profstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int profstat_exec ( int argc, char **argv ) {
+	struct profstat_options opts;
+	struct profiler *profiler;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &profstat_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Display (and optionally reset) all profilers with samples */
+	for_each_table_entry ( profiler, PROFILERS ) {
+		if ( ! profiler->count )
+			continue;
+		printf ( "%s: %ld samples, mean %ld stddev %ld, min %ld "
+			 "max %ld\n", profiler->name, profiler->count,
+			 profile_mean ( profiler ),
+			 profile_stddev ( profiler ), profiler->min,
+			 profiler->max );
+		printf ( "  [p50:%ld p90:%ld p99:%ld cycles]\n",
+			 profile_percentile ( profiler, 50 ),
+			 profile_percentile ( profiler, 90 ),
+			 profile_percentile ( profiler, 99 ) );
+		if ( opts.reset )
+			profile_reset ( profiler );
+	}
+
+	return 0;
+}
+
+/** Profiling commands */
+struct command profstat_command __command = {
+	.name = "profstat",
+	.exec = profstat_exec,
+};
@@ -8,14 +8,75 @@ struct cipher_algorithm;
 /** Basic AES blocksize */
 #define AES_BLOCKSIZE 16
 
+#include <stdint.h>
+#include <ipxe/tables.h>
 #include "crypto/axtls/crypto.h"
 
+/** AES round keys for a hardware-accelerated implementation */
+struct aes_round_keys {
+	/** Number of rounds */
+	unsigned int rounds;
+	/** Encryption round keys */
+	uint8_t encrypt[ AES_MAXROUNDS + 1 ][AES_BLOCKSIZE];
+	/** Decryption round keys */
+	uint8_t decrypt[ AES_MAXROUNDS + 1 ][AES_BLOCKSIZE];
+};
+
+/** A hardware-accelerated AES implementation */
+struct aes_accelerator {
+	/** Name */
+	const char *name;
+	/** Check for hardware support
+	 *
+	 * @ret supported	Implementation is usable on this CPU
+	 */
+	int ( * supported ) ( void );
+	/** Construct decryption round keys
+	 *
+	 * @v keys		Round keys
+	 *
+	 * The number of rounds and the encryption round keys will
+	 * already have been filled in.
+	 */
+	void ( * setkey ) ( struct aes_round_keys *keys );
+	/** Encrypt data
+	 *
+	 * @v keys		Round keys
+	 * @v src		Data to encrypt
+	 * @v dst		Buffer for encrypted data
+	 * @v len		Length of data (a multiple of AES_BLOCKSIZE)
+	 */
+	void ( * encrypt ) ( const struct aes_round_keys *keys,
+			     const void *src, void *dst, size_t len );
+	/** Decrypt data
+	 *
+	 * @v keys		Round keys
+	 * @v src		Data to decrypt
+	 * @v dst		Buffer for decrypted data
+	 * @v len		Length of data (a multiple of AES_BLOCKSIZE)
+	 */
+	void ( * decrypt ) ( const struct aes_round_keys *keys,
+			     const void *src, void *dst, size_t len );
+};
+
+/** AES accelerator table */
+#define AES_ACCELERATORS __table ( struct aes_accelerator, "aes_accelerators" )
+
+/** Declare an AES accelerator */
+#define __aes_accelerator __table_entry ( AES_ACCELERATORS, 01 )
+
 /** AES context */
 struct aes_context {
-	/** AES context for AXTLS */
-	AES_CTX axtls_ctx;
+	union {
+		/** AES context for AXTLS */
+		AES_CTX axtls_ctx;
+		/** Round keys for hardware accelerator */
+		struct aes_round_keys keys;
+	};
 	/** Cipher is being used for decrypting */
 	int decrypting;
+	/** Hardware accelerator, or NULL to use AXTLS */
+	struct aes_accelerator *accel;
 };
 
 /** AES context size */
@@ -23,6 +84,7 @@ struct aes_context {
 
 extern struct cipher_algorithm aes_algorithm;
 extern struct cipher_algorithm aes_cbc_algorithm;
+extern struct cipher_algorithm aes_gcm_algorithm;
 
 int aes_wrap ( const void *kek, const void *src, void *dest, int nblk );
 int aes_unwrap ( const void *kek, const void *src, void *dest, int nblk );
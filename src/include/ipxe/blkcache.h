@@ -0,0 +1,48 @@
+#ifndef _IPXE_BLKCACHE_H
+#define _IPXE_BLKCACHE_H
+
+/**
+ * @file
+ *
+ * Block device cache
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/interface.h>
+#include <ipxe/blockdev.h>
+
+/** Length of a block cache line
+ *
+ * Blocks are cached in aligned lines of this length.  Devices with a
+ * block size larger than this (or not dividing it) are not cached.
+ */
+#define BLKCACHE_LINE_LEN 4096
+
+/** Block cache statistics */
+struct block_cache_stats {
+	/** Number of reads satisfied entirely from the cache */
+	unsigned long hits;
+	/** Number of reads passed to the underlying device */
+	unsigned long misses;
+	/** Number of cache lines evicted to make room for new lines */
+	unsigned long evictions;
+	/** Number of cache lines invalidated by writes */
+	unsigned long invalidations;
+};
+
+extern struct block_cache_stats blkcache_stats;
+
+extern int blkcache_cacheable ( unsigned int count, size_t len );
+extern int blkcache_read ( struct interface *control, struct interface *dest,
+			   block_read_TYPE ( void * ) *op,
+			   struct interface *data, uint64_t lba,
+			   unsigned int count, userptr_t buffer, size_t len );
+extern void blkcache_invalidate ( struct interface *dest, uint64_t lba,
+				  unsigned int count, size_t len );
+extern void blkcache_flush ( struct interface *control );
+
+#endif /* _IPXE_BLKCACHE_H */
@@ -4,6 +4,42 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
+#include <ipxe/tables.h>
+
+/** Block size required by a hardware-accelerated CRC32 implementation */
+#define CRC32_ACCEL_BLOCKSIZE 16
+
+/** Minimum length worth passing to a hardware-accelerated implementation */
+#define CRC32_ACCEL_MIN_LEN 64
+
+/** A hardware-accelerated CRC32 implementation */
+struct crc32_accelerator {
+	/** Name */
+	const char *name;
+	/** Check for hardware support
+	 *
+	 * @ret supported	Implementation is usable on this CPU
+	 */
+	int ( * supported ) ( void );
+	/** Calculate 32-bit little-endian CRC checksum
+	 *
+	 * @v seed		Initial value
+	 * @v data		Data to checksum
+	 * @v len		Length of data
+	 * @ret crc		Updated CRC value
+	 *
+	 * @c len is at least CRC32_ACCEL_MIN_LEN, and is a multiple
+	 * of CRC32_ACCEL_BLOCKSIZE.
+	 */
+	u32 ( * crc32_le ) ( u32 seed, const void *data, size_t len );
+};
+
+/** CRC32 accelerator table */
+#define CRC32_ACCELERATORS \
+	__table ( struct crc32_accelerator, "crc32_accelerators" )
+
+/** Declare a CRC32 accelerator */
+#define __crc32_accelerator __table_entry ( CRC32_ACCELERATORS, 01 )
 
 u32 crc32_le ( u32 seed, const void *data, size_t len );
 
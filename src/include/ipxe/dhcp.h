@@ -391,6 +391,13 @@ struct dhcp_netdev_desc {
  */
 #define DHCP_EB_USE_CACHED DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0xb2 )
 
+/** Maximum TCP receive window
+ *
+ * If present, this overrides the default maximum TCP receive window
+ * size (in bytes) as configured at build time.
+ */
+#define DHCP_EB_TCP_WINDOW DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0xb3 )
+
 /** BIOS drive number
  *
  * This is the drive number for a drive emulated via INT 13.  0x80 is
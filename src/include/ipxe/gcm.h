@@ -0,0 +1,152 @@
+#ifndef _IPXE_GCM_H
+#define _IPXE_GCM_H
+
+/** @file
+ *
+ * Galois/Counter Mode (GCM)
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/tables.h>
+#include <ipxe/crypto.h>
+
+/** GCM block size */
+#define GCM_BLOCKSIZE 16
+
+/** GCM initialisation vector length */
+#define GCM_IV_LEN 12
+
+/** GCM authentication tag length */
+#define GCM_AUTH_LEN 16
+
+/** A GCM block */
+union gcm_block {
+	/** Raw bytes */
+	uint8_t byte[GCM_BLOCKSIZE];
+	/** Big-endian qwords */
+	uint64_t qword[ GCM_BLOCKSIZE / sizeof ( uint64_t ) ];
+	/** Big-endian dwords */
+	uint32_t dword[ GCM_BLOCKSIZE / sizeof ( uint32_t ) ];
+};
+
+/** A hardware-accelerated GHASH implementation */
+struct gcm_accelerator {
+	/** Name */
+	const char *name;
+	/** Check for hardware support
+	 *
+	 * @ret supported	Implementation is usable on this CPU
+	 */
+	int ( * supported ) ( void );
+	/** Multiply accumulated hash by hash key
+	 *
+	 * @v hash		Accumulated hash
+	 * @v key		Hash key
+	 */
+	void ( * multiply ) ( union gcm_block *hash,
+			      const union gcm_block *key );
+};
+
+/** GHASH accelerator table */
+#define GCM_ACCELERATORS __table ( struct gcm_accelerator, "gcm_accelerators" )
+
+/** Declare a GHASH accelerator */
+#define __gcm_accelerator __table_entry ( GCM_ACCELERATORS, 01 )
+
+/** GCM context */
+struct gcm_context {
+	/** Hash key */
+	union gcm_block key;
+	/** Accumulated hash */
+	union gcm_block hash;
+	/** Current counter block */
+	union gcm_block ctr;
+	/** Encrypted initial counter block */
+	union gcm_block ectr0;
+	/** Length of additional data */
+	uint64_t aad_len;
+	/** Length of encrypted data */
+	uint64_t data_len;
+	/** Hardware accelerator, or NULL to use software multiplication */
+	struct gcm_accelerator *accel;
+	/** Software multiplication table (high qwords) */
+	uint64_t hh[16];
+	/** Software multiplication table (low qwords) */
+	uint64_t hl[16];
+};
+
+extern int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_setiv ( void *ctx, const void *iv,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_encrypt ( void *ctx, const void *src, void *dst,
+			  size_t len, struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_decrypt ( void *ctx, const void *src, void *dst,
+			  size_t len, struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_auth ( void *ctx, void *auth,
+		       struct cipher_algorithm *raw_cipher,
+		       struct gcm_context *gcm_ctx );
+
+/**
+ * Create a Galois/Counter mode of behaviour of an existing cipher
+ *
+ * @v _gcm_name		Name for the new GCM cipher
+ * @v _gcm_cipher	New cipher algorithm
+ * @v _raw_cipher	Underlying cipher algorithm
+ * @v _raw_context	Context structure for the underlying cipher
+ *
+ * The underlying cipher must have a 128-bit block size.
+ */
+#define GCM_CIPHER( _gcm_name, _gcm_cipher, _raw_cipher, _raw_context )	\
+struct _gcm_name ## _context {						\
+	_raw_context raw_ctx;						\
+	struct gcm_context gcm_ctx;					\
+};									\
+static int _gcm_name ## _setkey ( void *ctx, const void *key,		\
+				  size_t keylen ) {			\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	return gcm_setkey ( &_gcm_name ## _ctx->raw_ctx, key, keylen,	\
+			    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );\
+}									\
+static void _gcm_name ## _setiv ( void *ctx, const void *iv ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_setiv ( &_gcm_name ## _ctx->raw_ctx, iv,			\
+		    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _encrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_encrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _decrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_decrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _auth ( void *ctx, void *auth ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_auth ( &_gcm_name ## _ctx->raw_ctx, auth,			\
+		   &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );		\
+}									\
+struct cipher_algorithm _gcm_cipher = {					\
+	.name		= #_gcm_name,					\
+	.ctxsize	= sizeof ( struct _gcm_name ## _context ),	\
+	.blocksize	= 1,						\
+	.authsize	= GCM_AUTH_LEN,					\
+	.setkey		= _gcm_name ## _setkey,				\
+	.setiv		= _gcm_name ## _setiv,				\
+	.encrypt	= _gcm_name ## _encrypt,			\
+	.decrypt	= _gcm_name ## _decrypt,			\
+	.auth		= _gcm_name ## _auth,				\
+};
+
+#endif /* _IPXE_GCM_H */
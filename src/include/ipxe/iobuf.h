@@ -33,6 +33,28 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define IOB_ZLEN 64
 
+/**
+ * I/O buffer pool block size
+ *
+ * I/O buffers which, including the descriptor, fit within a block of
+ * this size (and which are not so small that recycling them would
+ * waste significant memory) are always allocated as a full block of
+ * this size, and are recycled via the I/O buffer pool rather than
+ * being returned to the heap when freed.  This covers the receive
+ * buffers allocated by all drivers for a standard Ethernet MTU.
+ */
+#define IOB_POOL_BLOCK_SIZE IOB_ALIGN
+
+/**
+ * Maximum number of I/O buffers held in the I/O buffer pool
+ *
+ * The heap is small, and buffers held in the pool are unavailable for
+ * any other use.  The pool needs only to absorb the free_iob() and
+ * alloc_iob() pairs made as received packets are consumed and the
+ * receive ring is refilled, so a few buffers are sufficient.
+ */
+#define IOB_POOL_MAX 4
+
 /**
  * A persistent I/O buffer
  *
@@ -57,8 +79,27 @@ struct io_buffer {
 	void *tail;
 	/** End of the buffer */
         void *end;
+
+	/** Time at which buffer was added to a receive queue
+	 *
+	 * This is a profiling timestamp (in CPU cycles), maintained
+	 * by the network device layer, and is used only to measure
+	 * receive queue latency.
+	 */
+	unsigned long queued;
+	/** Flags */
+	unsigned int flags;
 };
 
+/** Transport-layer checksum has already been verified
+ *
+ * This may be set by a network device driver on a received packet
+ * when the device (or hypervisor) has already validated the TCP or
+ * UDP checksum, in which case the transport layer will not verify it
+ * again.
+ */
+#define IOB_FL_CSUM_VERIFIED 0x0001
+
 /**
  * Reserve space at start of I/O buffer
  *
@@ -199,6 +240,7 @@ static inline void iob_populate ( struct io_buffer *iobuf,
 	iobuf->head = iobuf->data = data;
 	iobuf->tail = ( data + len );
 	iobuf->end = ( data + max_len );
+	iobuf->flags = 0;
 }
 
 /**
@@ -221,6 +263,20 @@ static inline void iob_populate ( struct io_buffer *iobuf,
 	(iobuf) = NULL;					\
 	__iobuf; } )
 
+/** I/O buffer pool statistics */
+struct io_buffer_pool_stats {
+	/** Number of allocations satisfied from the pool */
+	unsigned long hits;
+	/** Number of allocations that had to use the heap */
+	unsigned long misses;
+	/** Number of buffers currently held in the pool */
+	unsigned int count;
+	/** Number of allocations that failed */
+	unsigned long failures;
+};
+
+extern struct io_buffer_pool_stats iob_pool_stats;
+
 extern struct io_buffer * __malloc alloc_iob ( size_t len );
 extern void free_iob ( struct io_buffer *iobuf );
 extern void iob_pad ( struct io_buffer *iobuf, size_t min_len );
@@ -14,12 +14,45 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/scsi.h>
 #include <ipxe/chap.h>
 #include <ipxe/refcnt.h>
+#include <ipxe/list.h>
 #include <ipxe/xfer.h>
 #include <ipxe/process.h>
 
 /** Default iSCSI port */
 #define ISCSI_PORT 3260
 
+/** Maximum data segment length that we are prepared to receive */
+#define ISCSI_MAX_RECV_DATA_SEG_LEN ( 256 * 1024 )
+
+/** Maximum data segment length that we send
+ *
+ * Each data segment that we send is held in a single I/O buffer, so
+ * this limits the memory used regardless of how large a segment the
+ * target is prepared to receive.
+ */
+#define ISCSI_MAX_SEND_DATA_SEG_LEN 8192
+
+/** Maximum burst length that we request */
+#define ISCSI_MAX_BURST_LEN ( 1024 * 1024 )
+
+/** First burst length that we request */
+#define ISCSI_FIRST_BURST_LEN ( 256 * 1024 )
+
+/** Maximum number of outstanding R2Ts per task that we request */
+#define ISCSI_MAX_R2T 4
+
+/** Maximum number of concurrent tasks per session */
+#define ISCSI_MAX_TASKS 8
+
+/** Default maximum data segment length (as per RFC 3720) */
+#define ISCSI_DEFAULT_MAX_RECV_DATA_SEG_LEN 8192
+
+/** Default first burst length (as per RFC 3720) */
+#define ISCSI_DEFAULT_FIRST_BURST_LEN 65536
+
+/** Default maximum burst length (as per RFC 3720) */
+#define ISCSI_DEFAULT_MAX_BURST_LEN 262144
+
 /**
  * iSCSI segment lengths
  *
@@ -119,8 +152,10 @@ struct iscsi_bhs_common_response {
 	uint32_t statsn;
 	/** Expected command sequence number */
 	uint32_t expcmdsn;
+	/** Maximum command sequence number */
+	uint32_t maxcmdsn;
 	/** Fields specific to the PDU type */
-	uint8_t other_d[16];
+	uint8_t other_d[12];
 };
 
 /**
@@ -531,6 +566,55 @@ enum iscsi_rx_state {
 	ISCSI_RX_DATA_PADDING,
 };
 
+/** An iSCSI data-out transfer
+ *
+ * This is either a sequence of unsolicited data-out PDUs, or a
+ * sequence of data-out PDUs in response to an R2T.
+ */
+struct iscsi_transfer {
+	/** Target transfer tag */
+	uint32_t ttt;
+	/** Buffer offset */
+	uint32_t offset;
+	/** Length */
+	uint32_t len;
+};
+
+/** An iSCSI task
+ *
+ * A task represents a single SCSI command in progress.
+ */
+struct iscsi_task {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** iSCSI session */
+	struct iscsi_session *iscsi;
+	/** List of tasks within the session */
+	struct list_head list;
+	/** SCSI command interface */
+	struct interface data;
+
+	/** SCSI command */
+	struct scsi_cmd command;
+	/** Initiator task tag */
+	uint32_t itt;
+	/** Command sequence number */
+	uint32_t cmdsn;
+	/** Command PDU is waiting to be transmitted */
+	int tx_pending;
+	/** Length of immediate data sent with the command PDU */
+	uint32_t immediate_len;
+
+	/** Pending data-out transfers
+	 *
+	 * There may be at most one unsolicited transfer plus one
+	 * transfer for each outstanding R2T.
+	 */
+	struct iscsi_transfer transfer[ ISCSI_MAX_R2T + 1 ];
+	/** Number of pending data-out transfers */
+	unsigned int num_transfers;
+};
+
 /** An iSCSI session */
 struct iscsi_session {
 	/** Reference counter */
@@ -538,8 +622,6 @@ struct iscsi_session {
 
 	/** SCSI command-issuing interface */
 	struct interface control;
-	/** SCSI command interface */
-	struct interface data;
 	/** Transport-layer socket */
 	struct interface socket;
 
@@ -585,36 +667,26 @@ struct iscsi_session {
 	uint16_t isid_iana_qual;
 	/** Initiator task tag
 	 *
-	 * This is the tag of the current command.  It is incremented
-	 * whenever a new command is started.
+	 * This is the tag used for login requests.  It is
+	 * regenerated whenever a new connection is opened.
 	 */
 	uint32_t itt;
-	/** Target transfer tag
-	 *
-	 * This is the tag attached to a sequence of data-out PDUs in
-	 * response to an R2T.
-	 */
-	uint32_t ttt;
-	/** Transfer offset
-	 *
-	 * This is the offset for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
-	 */
-	uint32_t transfer_offset;
-	/** Transfer length
-	 *
-	 * This is the length for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
-	 */
-	uint32_t transfer_len;
 	/** Command sequence number
 	 *
-	 * This is the sequence number of the current command, used to
-	 * fill out the CmdSN field in iSCSI request PDUs.  It is
-	 * updated with the value of the ExpCmdSN field whenever we
-	 * receive an iSCSI response PDU containing such a field.
+	 * This is the sequence number to be assigned to the next
+	 * command, used to fill out the CmdSN field in iSCSI request
+	 * PDUs.  It is initialised from the ExpCmdSN field of the
+	 * login response, and incremented whenever a new command is
+	 * issued.
 	 */
 	uint32_t cmdsn;
+	/** Maximum command sequence number
+	 *
+	 * This is the most recent value of the MaxCmdSN field of an
+	 * iSCSI response PDU, and limits the number of commands that
+	 * may be issued.
+	 */
+	uint32_t maxcmdsn;
 	/** Status sequence number
 	 *
 	 * This is the most recent status sequence number present in
@@ -623,7 +695,27 @@ struct iscsi_session {
 	 * the ExpStatSN field with this value plus one.
 	 */
 	uint32_t statsn;
-	
+
+	/** Maximum data segment length that we send
+	 *
+	 * This is the target's MaxRecvDataSegmentLength, limited to
+	 * ISCSI_MAX_SEND_DATA_SEG_LEN.
+	 */
+	uint32_t max_send_len;
+	/** Negotiated first burst length */
+	uint32_t first_burst_len;
+	/** Negotiated maximum burst length */
+	uint32_t max_burst_len;
+	/** Negotiated maximum number of outstanding R2Ts per task */
+	unsigned int max_r2t;
+
+	/** List of tasks */
+	struct list_head tasks;
+	/** Number of tasks */
+	unsigned int num_tasks;
+	/** Task owning the current TX PDU, if any */
+	struct iscsi_task *tx_task;
+
 	/** Basic header segment for current TX PDU */
 	union iscsi_bhs tx_bhs;
 	/** State of the TX engine */
@@ -642,9 +734,6 @@ struct iscsi_session {
 	/** Buffer for received data (not always used) */
 	void *rx_buffer;
 
-	/** Current SCSI command, if any */
-	struct scsi_cmd *command;
-
 	/** Target socket address (for boot firmware table) */
 	struct sockaddr target_sockaddr;
 	/** SCSI LUN (for boot firmware table) */
@@ -696,6 +785,12 @@ struct iscsi_session {
 /** Target authenticated itself correctly */
 #define ISCSI_STATUS_AUTH_REVERSE_OK 0x00040000
 
+/** Target has agreed to InitialR2T=No */
+#define ISCSI_STATUS_NO_INITIAL_R2T 0x00080000
+
+/** Target has agreed to ImmediateData=Yes */
+#define ISCSI_STATUS_IMMEDIATE_DATA 0x00100000
+
 /** Default initiator IQN prefix */
 #define ISCSI_DEFAULT_IQN_PREFIX "iqn.2010-04.org.ipxe"
 
@@ -270,10 +270,71 @@ struct net_device_stats {
 	unsigned int good;
 	/** Count of error completions */
 	unsigned int bad;
+	/** Count of bytes (including link-layer headers) */
+	unsigned long bytes;
 	/** Error breakdowns */
 	struct net_device_error errors[NETDEV_MAX_UNIQUE_ERRORS];
 };
 
+/** Number of buckets in network device receive latency histogram */
+#define NETDEV_RX_LATENCY_BUCKETS 32
+
+/** Network device receive queue statistics */
+struct net_device_rx_queue_stats {
+	/** Current receive queue depth */
+	unsigned int depth;
+	/** Maximum observed receive queue depth */
+	unsigned int max_depth;
+	/** Number of receive batches processed */
+	unsigned int batches;
+	/** Number of packets processed in receive batches */
+	unsigned int packets;
+	/** Largest receive batch processed */
+	unsigned int max_batch;
+	/** Number of times the device has been polled */
+	unsigned int polls;
+	/** Total receive latency (in CPU cycles) */
+	uint64_t latency;
+	/** Receive latency histogram
+	 *
+	 * Bucket @c n counts packets that waited on the receive queue
+	 * for fewer than 2^n (and at least 2^(n-1)) CPU cycles.  The
+	 * final bucket also counts all longer waits.
+	 */
+	unsigned int latency_hist[NETDEV_RX_LATENCY_BUCKETS];
+	/** Number of packets dropped by the device due to lack of
+	 * receive descriptors
+	 */
+	unsigned int overruns;
+	/** Number of packets with hardware-verified checksums */
+	unsigned int csum_verified;
+};
+
+/** Network device transmit queue statistics */
+struct net_device_tx_queue_stats {
+	/** Current transmit queue depth */
+	unsigned int depth;
+	/** Maximum observed transmit queue depth */
+	unsigned int max_depth;
+};
+
+/** Network device per-protocol statistics */
+struct net_device_protocol_stats {
+	/** Network-layer protocol (in network byte order), or zero */
+	uint16_t net_proto;
+	/** Count of received packets */
+	unsigned int rx;
+	/** Count of received bytes (excluding link-layer headers) */
+	unsigned long rx_bytes;
+	/** Count of transmitted packets */
+	unsigned int tx;
+	/** Count of transmitted bytes (excluding link-layer headers) */
+	unsigned long tx_bytes;
+};
+
+/** Maximum number of network-layer protocols that we will keep track of */
+#define NETDEV_MAX_PROTOCOLS 4
+
 /**
  * A network device
  *
@@ -324,6 +385,12 @@ struct net_device {
 	 * This is the bitwise-OR of zero or more NETDEV_XXX constants.
 	 */
 	unsigned int state;
+	/** Offload capabilities
+	 *
+	 * This is the bitwise-OR of zero or more NETDEV_CAP_XXX
+	 * constants.
+	 */
+	unsigned int caps;
 	/** Link status code
 	 *
 	 * Zero indicates that the link is up; any other value
@@ -343,6 +410,13 @@ struct net_device {
 	struct net_device_stats tx_stats;
 	/** RX statistics */
 	struct net_device_stats rx_stats;
+	/** RX queue statistics */
+	struct net_device_rx_queue_stats rxq_stats;
+	/** TX queue statistics */
+	struct net_device_tx_queue_stats txq_stats;
+	/** Per-protocol statistics */
+	struct net_device_protocol_stats
+		proto_stats[NETDEV_MAX_PROTOCOLS];
 
 	/** Configuration settings applicable to this device */
 	struct generic_settings settings;
@@ -360,6 +434,14 @@ struct net_device {
 /** Network device receive queue processing is frozen */
 #define NETDEV_RX_FROZEN 0x0004
 
+/** Network device can verify received TCP and UDP checksums
+ *
+ * A driver for such a device may set IOB_FL_CSUM_VERIFIED on
+ * received packets whose transport-layer checksum has been verified
+ * by the hardware.
+ */
+#define NETDEV_CAP_RX_CSUM 0x0001
+
 /** Link-layer protocol table */
 #define LL_PROTOCOLS __table ( struct ll_protocol, "ll_protocols" )
 
@@ -432,6 +514,48 @@ struct net_driver {
 /** Bus ID setting tag */
 #define NETDEV_SETTING_TAG_BUS_ID NETDEV_SETTING_TAG ( 0x02 )
 
+/** Network device transmitted packet count setting tag */
+#define NETDEV_SETTING_TAG_TX_PACKETS NETDEV_SETTING_TAG ( 0x10 )
+
+/** Network device transmit error count setting tag */
+#define NETDEV_SETTING_TAG_TX_ERRORS NETDEV_SETTING_TAG ( 0x11 )
+
+/** Network device transmitted byte count setting tag */
+#define NETDEV_SETTING_TAG_TX_BYTES NETDEV_SETTING_TAG ( 0x12 )
+
+/** Network device maximum transmit queue depth setting tag */
+#define NETDEV_SETTING_TAG_TXQ_MAX NETDEV_SETTING_TAG ( 0x13 )
+
+/** Network device received packet count setting tag */
+#define NETDEV_SETTING_TAG_RX_PACKETS NETDEV_SETTING_TAG ( 0x14 )
+
+/** Network device receive error count setting tag */
+#define NETDEV_SETTING_TAG_RX_ERRORS NETDEV_SETTING_TAG ( 0x15 )
+
+/** Network device received byte count setting tag */
+#define NETDEV_SETTING_TAG_RX_BYTES NETDEV_SETTING_TAG ( 0x16 )
+
+/** Network device maximum receive queue depth setting tag */
+#define NETDEV_SETTING_TAG_RXQ_MAX NETDEV_SETTING_TAG ( 0x17 )
+
+/** Network device poll count setting tag */
+#define NETDEV_SETTING_TAG_POLLS NETDEV_SETTING_TAG ( 0x18 )
+
+/** Network device mean receive latency setting tag */
+#define NETDEV_SETTING_TAG_RX_LATENCY NETDEV_SETTING_TAG ( 0x19 )
+
+/** Network device receive ring overrun count setting tag */
+#define NETDEV_SETTING_TAG_RX_OVERRUNS NETDEV_SETTING_TAG ( 0x1a )
+
+/**
+ * Check if tag is a network device statistics setting tag
+ *
+ * @v tag		Setting tag
+ * @ret is_stats	Tag is a (read-only) statistics setting tag
+ */
+#define IS_NETDEV_STATS_SETTING_TAG( tag ) \
+	( ( (tag) & ~0x0fU ) == ( unsigned int ) NETDEV_SETTING_TAG ( 0x10 ) )
+
 extern struct list_head net_devices;
 extern struct net_device_operations null_netdev_operations;
 extern struct settings_operations netdev_settings_operations;
@@ -648,6 +772,20 @@ static inline void netdev_tx_complete_next ( struct net_device *netdev ) {
 	netdev_tx_complete_next_err ( netdev, 0 );
 }
 
+/**
+ * Record packets dropped due to receive ring overrun
+ *
+ * @v netdev		Network device
+ * @v count		Number of dropped packets
+ *
+ * Drivers should call this when the hardware reports that packets
+ * were dropped because no receive descriptors were available.
+ */
+static inline __attribute__ (( always_inline )) void
+netdev_rx_overrun ( struct net_device *netdev, unsigned int count ) {
+	netdev->rxq_stats.overruns += count;
+}
+
 /**
  * Mark network device as having link up
  *
@@ -5,76 +5,100 @@
  *
  * Profiling
  *
+ * Profilers are registered at compile time, and accumulate timing
+ * samples (in CPU cycles) for a section of code bracketed by
+ * profile_start() and profile_stop().  Sampling is compiled in only
+ * for objects built with the profiling debug level enabled, e.g.
+ *
+ * @code
+ *
+ *   make bin/rtl8139.dsk DEBUG=tcp:4,netdevice:4
+ *
+ * @endcode
+ *
+ * so that probes cost nothing in normal builds, and do not generate
+ * any debug output that would distort the timings.
  */
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
+#include <bits/profile.h>
+#include <ipxe/tables.h>
 
-/**
- * A data structure for storing profiling information
- */
-union profiler {
-	/** Timestamp (in CPU-specific "ticks") */
-	uint64_t timestamp;
-	/** Registers returned by rdtsc.
+/** Profiling is compiled in for this object */
+#define PROFILING ( DBGLVL_MAX & DBGLVL_PROFILE )
+
+/** Number of buckets in a profiler's histogram */
+#define PROFILE_BUCKETS 32
+
+/** Duration of profiling timestamp rate calibration (in us) */
+#define PROFILE_CALIBRATE_USECS 1000
+
+/** A profiler */
+struct profiler {
+	/** Name */
+	const char *name;
+	/** Start timestamp */
+	unsigned long started;
+	/** Number of samples */
+	unsigned long count;
+	/** Sum of samples */
+	uint64_t total;
+	/** Sum of squares of samples */
+	uint64_t total_sq;
+	/** Smallest sample */
+	unsigned long min;
+	/** Largest sample */
+	unsigned long max;
+	/** Sample histogram
 	 *
-	 * This part should really be architecture-specific code.
+	 * Bucket @c n counts samples of fewer than 2^n (and at least
+	 * 2^(n-1)) cycles.  The final bucket also counts all larger
+	 * samples.
 	 */
-	struct {
-		uint32_t eax;
-		uint32_t edx;
-	} rdtsc;
+	unsigned long hist[PROFILE_BUCKETS];
 };
 
-/**
- * Static per-object profiler, for use with simple_profile()
- */
-static union profiler simple_profiler;
+/** Profiler table */
+#define PROFILERS __table ( struct profiler, "profilers" )
+
+/** Declare a profiler */
+#define __profiler __table_entry ( PROFILERS, 01 )
+
+extern void profile_update ( struct profiler *profiler,
+			     unsigned long sample );
+extern unsigned long profile_mean ( struct profiler *profiler );
+extern unsigned long profile_stddev ( struct profiler *profiler );
+extern unsigned long profile_percentile ( struct profiler *profiler,
+					  unsigned int percentile );
+extern void profile_reset ( struct profiler *profiler );
+extern unsigned long profile_rate ( void );
 
 /**
- * Perform profiling
- *
- * @v profiler		Profiler data structure
- * @ret delta		Elapsed ticks since last call to profile().
- *
- * Call profile() both before and after the code you wish to measure.
- * The "after" call will return the measurement.  For example:
- *
- * @code
- *
- *     profile ( &profiler );
- *     ... do something here ...
- *     printf ( "It took %ld ticks to execute\n", profile ( &profiler ) );
+ * Start profiling
  *
- * @endcode
+ * @v profiler		Profiler
  */
-static inline __attribute__ (( always_inline )) unsigned long
-profile ( union profiler *profiler ) {
-	uint64_t last_timestamp = profiler->timestamp;
+static inline __attribute__ (( always_inline )) void
+profile_start ( struct profiler *profiler ) {
 
-	__asm__ __volatile__ ( "rdtsc" :
-			       "=a" ( profiler->rdtsc.eax ),
-			       "=d" ( profiler->rdtsc.edx ) );
-	return ( profiler->timestamp - last_timestamp );
+	if ( PROFILING )
+		profiler->started = profile_timestamp();
 }
 
 /**
- * Perform profiling
+ * Stop profiling
  *
- * @ret delta		Elapsed ticks since last call to profile().
- *
- * When you only need one profiler, you can avoid the hassle of
- * creating your own @c profiler data structure by using
- * simple_profile() instead.
- *
- * simple_profile() is equivalent to profile(&simple_profiler), where
- * @c simple_profiler is a @c profiler data structure that is static
- * to each object which includes @c profile.h.
+ * @v profiler		Profiler
  */
-static inline __attribute__ (( always_inline )) unsigned long
-simple_profile ( void ) {
-	return profile ( &simple_profiler );
+static inline __attribute__ (( always_inline )) void
+profile_stop ( struct profiler *profiler ) {
+
+	if ( PROFILING ) {
+		profile_update ( profiler,
+				 ( profile_timestamp() - profiler->started ) );
+	}
 }
 
 #endif /* _IPXE_PROFILE_H */
@@ -0,0 +1,37 @@
+#ifndef _IPXE_SHA256_H
+#define _IPXE_SHA256_H
+
+/** @file
+ *
+ * SHA-256 algorithm
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+struct digest_algorithm;
+
+/** SHA-256 digest size */
+#define SHA256_DIGEST_SIZE 32
+
+/** SHA-256 block size */
+#define SHA256_BLOCK_SIZE 64
+
+/** SHA-256 context */
+struct sha256_context {
+	/** Intermediate hash value */
+	uint32_t hash[ SHA256_DIGEST_SIZE / sizeof ( uint32_t ) ];
+	/** Partial data block */
+	uint8_t block[SHA256_BLOCK_SIZE];
+	/** Total number of bytes processed */
+	uint64_t byte_count;
+};
+
+/** SHA-256 context size */
+#define SHA256_CTX_SIZE sizeof ( struct sha256_context )
+
+extern struct digest_algorithm sha256_algorithm;
+
+#endif /* _IPXE_SHA256_H */
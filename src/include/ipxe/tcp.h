@@ -54,6 +54,83 @@ struct tcp_mss_option {
 /** Code for the TCP MSS option */
 #define TCP_OPTION_MSS 2
 
+/** TCP window scale option */
+struct tcp_window_scale_option {
+	uint8_t kind;
+	uint8_t length;
+	uint8_t scale;
+} __attribute__ (( packed ));
+
+/** Padded TCP window scale option (used for sending) */
+struct tcp_window_scale_padded_option {
+	uint8_t nop[1];
+	struct tcp_window_scale_option wsopt;
+} __attribute__ (( packed ));
+
+/** Code for the TCP window scale option */
+#define TCP_OPTION_WS 3
+
+/** Maximum TCP window scale
+ *
+ * RFC 7323 limits the window scale to 14, giving a maximum window of
+ * 1GB.
+ */
+#define TCP_MAX_WINDOW_SCALE 14
+
+/** TCP selective acknowledgement permitted option */
+struct tcp_sack_permitted_option {
+	uint8_t kind;
+	uint8_t length;
+} __attribute__ (( packed ));
+
+/** Padded TCP selective acknowledgement permitted option (used for
+ * sending)
+ */
+struct tcp_sack_permitted_padded_option {
+	uint8_t nop[2];
+	struct tcp_sack_permitted_option spopt;
+} __attribute__ (( packed ));
+
+/** Code for the TCP selective acknowledgement permitted option */
+#define TCP_OPTION_SACK_PERMITTED 4
+
+/** TCP selective acknowledgement option */
+struct tcp_sack_option {
+	uint8_t kind;
+	uint8_t length;
+} __attribute__ (( packed ));
+
+/** Padded TCP selective acknowledgement option (used for sending) */
+struct tcp_sack_padded_option {
+	uint8_t nop[2];
+	struct tcp_sack_option sackopt;
+} __attribute__ (( packed ));
+
+/** TCP selective acknowledgement block */
+struct tcp_sack_block {
+	/** Left edge of block */
+	uint32_t left;
+	/** Right edge of block */
+	uint32_t right;
+} __attribute__ (( packed ));
+
+/** Code for the TCP selective acknowledgement option */
+#define TCP_OPTION_SACK 5
+
+/** Maximum number of TCP selective acknowledgement blocks
+ *
+ * The TCP options space is limited to 40 bytes.  The SACK option
+ * uses 4 bytes (including padding) plus 8 bytes per block.  We
+ * therefore have space for 4 blocks, or only 3 blocks if the 12-byte
+ * (padded) timestamp option is also present.
+ */
+#define TCP_SACK_MAX 4
+
+/** Maximum number of TCP selective acknowledgement blocks when
+ * timestamps are in use
+ */
+#define TCP_SACK_MAX_TS 3
+
 /** TCP timestamp option */
 struct tcp_timestamp_option {
 	uint8_t kind;
@@ -75,6 +152,10 @@ struct tcp_timestamp_padded_option {
 struct tcp_options {
 	/** MSS option, if present */
 	const struct tcp_mss_option *mssopt;
+	/** Window scale option, if present */
+	const struct tcp_window_scale_option *wsopt;
+	/** SACK permitted option, if present */
+	const struct tcp_sack_permitted_option *spopt;
 	/** Timestampe option, if present */
 	const struct tcp_timestamp_option *tsopt;
 };
@@ -258,31 +339,44 @@ struct tcp_options {
 #define TCP_MIN_PORT 1
 
 /**
- * Maxmimum advertised TCP window size
+ * Advertised TCP window scale
  *
- * We estimate the TCP window size as the amount of free memory we
- * have.  This is not strictly accurate (since it ignores any space
- * already allocated as RX buffers), but it will do for now.
+ * Using a scale factor of 2**9 provides for a maximum window of 32MB,
+ * which is sufficient to allow 10 Gigabit transfers with a 25ms RTT
+ * (or Gigabit transfers with a 250ms RTT).  The granularity of the
+ * advertised window is therefore 512 bytes, which is still less than
+ * a single packet.
+ */
+#define TCP_RX_WINDOW_SCALE 9
+
+/**
+ * Maxmimum advertised TCP window size
  *
- * Since we don't store out-of-order received packets, the
- * retransmission penalty is that the whole window contents must be
- * resent.  This suggests keeping the window size small, but bear in
- * mind that the maximum bandwidth on any link is limited to
+ * The maximum bandwidth on any link is limited to
  *
  *    max_bandwidth = ( tcp_window / round_trip_time )
  *
- * With a 48kB window, which probably accurately reflects our amount
- * of free memory, and a WAN RTT of say 200ms, this gives a maximum
- * bandwidth of 240kB/s.  This is sufficiently close to realistic that
- * we will need to be careful that our advertised window doesn't end
- * up limiting WAN download speeds.
+ * This is the largest window representable using our advertised
+ * window scale.  The configured maximum window is given by
+ * TCP_WINDOW_SIZE in config/general.h, and may be overridden at
+ * runtime using the "tcp-window" setting.  Neither may exceed this
+ * value.
+ *
+ * Since in-order data is delivered immediately to the application,
+ * only out-of-order data is held on the receive queue.  We must
+ * nevertheless be able to buffer whatever we advertise, and so the
+ * advertised window is also limited to three quarters of the free
+ * heap memory.  The heap is only 128kB, much of which is used by
+ * network device receive rings, and so in practice the advertised
+ * window is limited by the heap to a few tens of kilobytes.  With a
+ * 32kB window and a WAN RTT of say 50ms, this gives a maximum
+ * bandwidth of 640kB/s (or 64MB/s with a LAN RTT of 0.5ms).
  *
- * Finally, since the window goes into a 16-bit field and we cannot
- * actually use 65536, we use a window size of (65536-4) to ensure
- * that payloads remain dword-aligned.
+ * Memory used by the receive queue may be reclaimed via the TCP
+ * cache discarder if memory runs short, at the cost of a
+ * retransmission.
  */
-//#define TCP_MAX_WINDOW_SIZE	( 65536 - 4 )
-#define TCP_MAX_WINDOW_SIZE	8192
+#define TCP_MAX_WINDOW_SIZE ( 0xffffUL << TCP_RX_WINDOW_SCALE )
 
 /**
  * Path MTU
@@ -302,6 +396,20 @@ struct tcp_options {
  */
 #define TCP_MSS 1460
 
+/** Maximum length of TCP options */
+#define TCP_MAX_OPTIONS_LEN 40
+
+/**
+ * Maximum combined length of link-layer, network-layer and TCP headers
+ *
+ * This is the space that must be reserved at the start of a
+ * transmitted I/O buffer to hold a TCP header with the largest
+ * possible set of options, plus all lower-layer headers.
+ */
+#define MAX_LL_NET_TCP_HEADER_LEN					\
+	( MAX_LL_NET_HEADER_LEN + sizeof ( struct tcp_header ) +	\
+	  TCP_MAX_OPTIONS_LEN )
+
 /** TCP maximum segment lifetime
  *
  * Currently set to 2 minutes, as per RFC 793.
@@ -0,0 +1,44 @@
+#ifndef _IPXE_TEST_H
+#define _IPXE_TEST_H
+
+/** @file
+ *
+ * Self-test infrastructure
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <ipxe/tables.h>
+
+/** A self-test set */
+struct self_test {
+	/** Test set name */
+	const char *name;
+	/** Run self-tests */
+	void ( * exec ) ( void );
+};
+
+/** Self-test table */
+#define SELF_TESTS __table ( struct self_test, "self_tests" )
+
+/**
+ * Declare a self-test
+ *
+ * A file declaring self-tests must also use REQUIRE_OBJECT(test) to
+ * link in the self-test runner, which executes every linked-in
+ * self-test during initialisation.
+ */
+#define __self_test __table_entry ( SELF_TESTS, 01 )
+
+extern void test_ok ( int success, const char *file, unsigned int line,
+		      const char *test );
+
+/**
+ * Report test result
+ *
+ * @v success		Test succeeded
+ */
+#define ok( success ) test_ok ( (success), __FILE__, __LINE__, #success )
+
+#endif /* _IPXE_TEST_H */
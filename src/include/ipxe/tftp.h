@@ -14,6 +14,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define TFTP_PORT	       69 /**< Default TFTP server port */
 #define	TFTP_DEFAULT_BLKSIZE  512 /**< Default TFTP data block size */
 #define	TFTP_MAX_BLKSIZE     1432
+#define	TFTP_DEFAULT_WINDOWSIZE 1 /**< Default TFTP window size */
+#define	TFTP_MAX_WINDOWSIZE     8 /**< Default requested window size */
 
 #define TFTP_RRQ		1 /**< Read request opcode */
 #define TFTP_WRQ		2 /**< Write request opcode */
@@ -81,5 +83,6 @@ union tftp_any {
 };
 
 extern void tftp_set_request_blksize ( unsigned int blksize );
+extern void tftp_set_request_windowsize ( unsigned int windowsize );
 
 #endif /* _IPXE_TFTP_H */
@@ -16,6 +16,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/crypto.h>
 #include <ipxe/md5.h>
 #include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
 #include <ipxe/x509.h>
 
 /** A TLS header */
@@ -40,6 +41,9 @@ struct tls_header {
 /** TLS version 1.1 */
 #define TLS_VERSION_TLS_1_1 0x0302
 
+/** TLS version 1.2 */
+#define TLS_VERSION_TLS_1_2 0x0303
+
 /** Change cipher content type */
 #define TLS_TYPE_CHANGE_CIPHER 20
 
@@ -73,6 +77,26 @@ struct tls_header {
 #define TLS_RSA_WITH_NULL_SHA 0x0002
 #define TLS_RSA_WITH_AES_128_CBC_SHA 0x002f
 #define TLS_RSA_WITH_AES_256_CBC_SHA 0x0035
+#define TLS_RSA_WITH_AES_128_GCM_SHA256 0x009c
+
+/** Length of implicit (fixed) part of an authenticated cipher nonce */
+#define TLS_FIXED_IV_LEN 4
+
+/** Length of explicit part of an authenticated cipher nonce */
+#define TLS_EXPLICIT_IV_LEN 8
+
+/** Maximum length of handshake verification hash
+ *
+ * This is the MD5+SHA1 hash used before TLSv1.2, which is longer
+ * than the SHA-256 hash used by TLSv1.2.
+ */
+#define TLS_MAX_VERIFY_HANDSHAKE_LEN ( MD5_DIGEST_SIZE + SHA1_DIGEST_SIZE )
+
+/** Maximum length of a TLS session ID */
+#define TLS_MAX_SESSION_ID_LEN 32
+
+/** Maximum number of cached TLS sessions */
+#define TLS_MAX_CACHED_SESSIONS 4
 
 /** TLS RX state machine state */
 enum tls_rx_state {
@@ -110,6 +134,8 @@ struct tls_cipherspec {
 	void *cipher_next_ctx;
 	/** MAC secret */
 	void *mac_secret;
+	/** Implicit nonce (authenticated ciphers only) */
+	uint8_t fixed_iv[TLS_FIXED_IV_LEN];
 };
 
 /** TLS pre-master secret */
@@ -133,6 +159,24 @@ struct tls_session {
 	/** Reference counter */
 	struct refcnt refcnt;
 
+	/** Protocol version
+	 *
+	 * This is a TLS_VERSION_XXX constant, in host byte order.
+	 * It holds the highest version that we support until the
+	 * server has selected a version.
+	 */
+	uint16_t version;
+	/** Server name, or NULL */
+	char *name;
+	/** Session ID */
+	uint8_t session_id[TLS_MAX_SESSION_ID_LEN];
+	/** Length of session ID */
+	size_t session_id_len;
+	/** Cipher suite (in network byte order) */
+	uint16_t cipher_suite;
+	/** Session is being resumed via an abbreviated handshake */
+	int resumed;
+
 	/** Plaintext stream */
 	struct interface plainstream;
 	/** Ciphertext stream */
@@ -158,6 +202,8 @@ struct tls_session {
 	uint8_t handshake_md5_ctx[MD5_CTX_SIZE];
 	/** SHA1 context for handshake verification */
 	uint8_t handshake_sha1_ctx[SHA1_CTX_SIZE];
+	/** SHA-256 context for handshake verification (TLSv1.2) */
+	uint8_t handshake_sha256_ctx[SHA256_CTX_SIZE];
 
 	/** Hack: server RSA public key */
 	struct x509_rsa_public_key rsa;
@@ -181,7 +227,7 @@ struct tls_session {
 	void *rx_data;
 };
 
-extern int add_tls ( struct interface *xfer,
+extern int add_tls ( struct interface *xfer, const char *name,
 		     struct interface **next );
 
 #endif /* _IPXE_TLS_H */
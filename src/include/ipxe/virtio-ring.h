@@ -14,6 +14,12 @@
 /* We've given up on this device. */
 #define VIRTIO_CONFIG_S_FAILED          0x80
 
+/* The Guest publishes the used index for which it expects an interrupt
+ * at the end of the avail ring. Host should ignore the avail->flags field. */
+/* The Host publishes the avail index for which it expects a kick
+ * at the end of the used ring. Guest should ignore the used->flags field. */
+#define VIRTIO_RING_F_EVENT_IDX         29
+
 #define MAX_QUEUE_NUM      (256)
 
 #define VRING_DESC_F_NEXT  1
@@ -60,9 +66,17 @@ struct vring {
 
 #define vring_size(num) \
    (((((sizeof(struct vring_desc) * num) + \
-      (sizeof(struct vring_avail) + sizeof(u16) * num)) \
+      (sizeof(struct vring_avail) + sizeof(u16) * (num + 1))) \
          + PAGE_MASK) & ~PAGE_MASK) + \
-         (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num))
+         (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num) + \
+         sizeof(u16))
+
+/* With VIRTIO_RING_F_EVENT_IDX, the used_event and avail_event fields
+ * live immediately after the avail and used rings respectively. */
+#define vring_used_event(vr) ((vr)->avail->ring[(vr)->num])
+#define vring_avail_event(vr) \
+   (*(u16 *)((void *)(vr)->used + sizeof(struct vring_used) + \
+             sizeof(struct vring_used_elem) * (vr)->num))
 
 typedef unsigned char virtio_queue_t[PAGE_MASK + vring_size(MAX_QUEUE_NUM)];
 
@@ -71,6 +85,8 @@ struct vring_virtqueue {
    struct vring vring;
    u16 free_head;
    u16 last_used_idx;
+   /* VIRTIO_RING_F_EVENT_IDX has been negotiated */
+   int event;
    void *vdata[MAX_QUEUE_NUM];
    /* PCI */
    int queue_index;
@@ -111,6 +127,8 @@ static inline void vring_init(struct vring *vr,
 static inline void vring_enable_cb(struct vring_virtqueue *vq)
 {
    vq->vring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+   if (vq->event)
+           vring_used_event(&vq->vring) = vq->last_used_idx;
 }
 
 static inline void vring_disable_cb(struct vring_virtqueue *vq)
@@ -119,6 +137,18 @@ static inline void vring_disable_cb(struct vring_virtqueue *vq)
 }
 
 
+/*
+ * vring_need_event
+ *
+ * has the other side asked to be notified of any index in (old, new] ?
+ *
+ */
+
+static inline int vring_need_event(u16 event_idx, u16 new_idx, u16 old)
+{
+   return (u16)(new_idx - event_idx - 1) < (u16)(new_idx - old);
+}
+
 /*
  * vring_more_used
  *
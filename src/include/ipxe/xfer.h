@@ -89,6 +89,18 @@ extern int xfer_deliver ( struct interface *intf,
 	typeof ( int ( object_type, struct io_buffer *iobuf,	\
 		       struct xfer_metadata *meta ) )
 
+extern void * xfer_buffer ( struct interface *intf, size_t len,
+			    struct xfer_metadata *meta );
+#define xfer_buffer_TYPE( object_type )				\
+	typeof ( void * ( object_type, size_t len,			\
+			  struct xfer_metadata *meta ) )
+
+extern int xfer_deliver_into ( struct interface *intf, size_t len,
+			       struct xfer_metadata *meta );
+#define xfer_deliver_into_TYPE( object_type )				\
+	typeof ( int ( object_type, size_t len,			\
+		       struct xfer_metadata *meta ) )
+
 /* Data transfer interface helper functions */
 
 extern int xfer_redirect ( struct interface *xfer, int type, ... );
@@ -42,10 +42,12 @@ struct nic {
 	unsigned char		*node_addr;
 	unsigned char		*packet;
 	unsigned int		packetlen;
+	unsigned int		packetflags;	/* I/O buffer flags */
 	unsigned int		ioaddr;
 	unsigned char		irqno;
 	unsigned int		mbps;
 	duplex_t		duplex;
+	unsigned int		caps;	/* network device capabilities */
 	void			*priv_data;	/* driver private data */
 };
 
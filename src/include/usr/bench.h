@@ -0,0 +1,16 @@
+#ifndef _USR_BENCH_H
+#define _USR_BENCH_H
+
+/** @file
+ *
+ * Benchmarks
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+extern int bench_micro ( unsigned long duration );
+extern int bench_download ( const char *uri_string );
+extern int bench_block ( const char *uri_string, unsigned long max_len );
+
+#endif /* _USR_BENCH_H */
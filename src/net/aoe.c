@@ -33,6 +33,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/features.h>
 #include <ipxe/interface.h>
 #include <ipxe/xfer.h>
+#include <ipxe/timer.h>
 #include <ipxe/uri.h>
 #include <ipxe/open.h>
 #include <ipxe/ata.h>
@@ -49,6 +50,13 @@ FEATURE ( FEATURE_PROTOCOL, "AoE", DHCP_EB_FEATURE_AOE, 1 );
 
 struct net_protocol aoe_protocol __net_protocol;
 
+/** Maximum number of outstanding ATA commands per device
+ *
+ * The number of outstanding commands is also limited by the buffer
+ * count advertised by the target in its configuration response.
+ */
+#define AOE_MAX_WINDOW 64
+
 /******************************************************************************
  *
  * AoE devices and commands
@@ -79,8 +87,21 @@ struct aoe_device {
 	/** Target MAC address */
 	uint8_t target[MAX_LL_ADDR_LEN];
 
-	/** Saved timeout value */
-	unsigned long timeout;
+	/** Smoothed round-trip time (in ticks, scaled by 8) */
+	unsigned long srtt;
+	/** Round-trip time variation (in ticks, scaled by 4) */
+	unsigned long rttvar;
+
+	/** Number of outstanding ATA commands */
+	unsigned int outstanding;
+	/** Maximum number of outstanding ATA commands */
+	unsigned int max_window;
+	/** Congestion window (in ATA commands) */
+	unsigned int window;
+	/** Responses received since congestion window was last opened */
+	unsigned int window_acks;
+	/** Time at which congestion window was last closed */
+	unsigned long window_closed;
 
 	/** Configuration command interface */
 	struct interface config;
@@ -141,6 +162,8 @@ struct aoe_command_type {
 			size_t len, const void *ll_source );
 };
 
+static struct aoe_command_type aoecmd_ata;
+
 /**
  * Get reference to AoE device
  *
@@ -199,6 +222,88 @@ static const char * aoedev_name ( struct aoe_device *aoedev ) {
 	return buf;
 }
 
+/**
+ * Calculate AoE device retransmission timeout
+ *
+ * @v aoedev		AoE device
+ * @ret timeout		Retransmission timeout (in ticks)
+ *
+ * A zero timeout (before any round-trip time has been measured)
+ * causes the retry timer to use its default minimum timeout.
+ */
+static unsigned long aoedev_rto ( struct aoe_device *aoedev ) {
+	return ( ( aoedev->srtt >> 3 ) + aoedev->rttvar );
+}
+
+/**
+ * Update AoE device round-trip time estimate
+ *
+ * @v aoedev		AoE device
+ * @v rtt		Measured round-trip time (in ticks)
+ *
+ * This uses the standard smoothed round-trip time and variation
+ * estimators as used by TCP (RFC 6298).
+ */
+static void aoedev_rtt ( struct aoe_device *aoedev, unsigned long rtt ) {
+	long delta;
+
+	if ( ! aoedev->srtt ) {
+		aoedev->srtt = ( rtt << 3 );
+		aoedev->rttvar = ( rtt << 1 );
+	} else {
+		delta = ( rtt - ( aoedev->srtt >> 3 ) );
+		aoedev->srtt += delta;
+		if ( delta < 0 )
+			delta = -delta;
+		aoedev->rttvar += ( delta - ( aoedev->rttvar >> 2 ) );
+	}
+	DBGC2 ( aoedev, "AoE %s RTT %ld srtt %ld rttvar %ld rto %ld\n",
+		aoedev_name ( aoedev ), rtt, ( aoedev->srtt >> 3 ),
+		( aoedev->rttvar >> 2 ), aoedev_rto ( aoedev ) );
+}
+
+/**
+ * Open AoE device congestion window
+ *
+ * @v aoedev		AoE device
+ *
+ * The window grows additively by one command for each window's
+ * worth of successful responses, up to the target's buffer count.
+ */
+static void aoedev_window_open ( struct aoe_device *aoedev ) {
+
+	if ( ++aoedev->window_acks < aoedev->window )
+		return;
+	aoedev->window_acks = 0;
+	if ( aoedev->window < aoedev->max_window ) {
+		aoedev->window++;
+		DBGC2 ( aoedev, "AoE %s window opened to %d\n",
+			aoedev_name ( aoedev ), aoedev->window );
+	}
+}
+
+/**
+ * Close AoE device congestion window
+ *
+ * @v aoedev		AoE device
+ *
+ * The window is halved on retransmission.  Since all commands
+ * outstanding at the time of a loss are likely to time out
+ * together, the window is closed at most once per retransmission
+ * timeout.
+ */
+static void aoedev_window_close ( struct aoe_device *aoedev ) {
+	unsigned long now = currticks();
+
+	if ( ( now - aoedev->window_closed ) < aoedev_rto ( aoedev ) )
+		return;
+	aoedev->window_closed = now;
+	aoedev->window_acks = 0;
+	aoedev->window = ( ( aoedev->window + 1 ) / 2 );
+	DBGC ( aoedev, "AoE %s window closed to %d\n",
+	       aoedev_name ( aoedev ), aoedev->window );
+}
+
 /**
  * Free AoE command
  *
@@ -227,18 +332,23 @@ static void aoecmd_close ( struct aoe_command *aoecmd, int rc ) {
 	/* Stop timer */
 	stop_timer ( &aoecmd->timer );
 
-	/* Preserve the timeout value for subsequent commands */
-	aoedev->timeout = aoecmd->timer.timeout;
-
 	/* Remove from list of commands */
 	if ( ! list_empty ( &aoecmd->list ) ) {
 		list_del ( &aoecmd->list );
 		INIT_LIST_HEAD ( &aoecmd->list );
+		if ( aoecmd->type == &aoecmd_ata ) {
+			assert ( aoedev->outstanding > 0 );
+			aoedev->outstanding--;
+		}
 		aoecmd_put ( aoecmd );
 	}
 
 	/* Shut down interfaces */
 	intf_shutdown ( &aoecmd->ata, rc );
+
+	/* Notify device that a command slot may have become free */
+	if ( aoedev->configured )
+		xfer_window_changed ( &aoedev->ata );
 }
 
 /**
@@ -333,11 +443,21 @@ static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
 		goto done;
 	}
 
+	/* Update round-trip time estimate, using only commands that
+	 * have not been retransmitted (Karn's algorithm)
+	 */
+	if ( ! aoecmd->timer.count )
+		aoedev_rtt ( aoedev, ( currticks() - aoecmd->timer.start ) );
+
 	/* Hand off to command completion handler */
 	if ( ( rc = aoecmd->type->rsp ( aoecmd, iobuf->data, iob_len ( iobuf ),
 					ll_source ) ) != 0 )
 		goto done;
 
+	/* Open congestion window on successful ATA commands */
+	if ( aoecmd->type == &aoecmd_ata )
+		aoedev_window_open ( aoedev );
+
  done:
 	/* Free I/O buffer */
 	free_iob ( iobuf );
@@ -361,6 +481,10 @@ static void aoecmd_expired ( struct retry_timer *timer, int fail ) {
 	if ( fail ) {
 		aoecmd_close ( aoecmd, -ETIMEDOUT );
 	} else {
+		DBGC ( aoecmd->aoedev, "AoE %s/%08x retransmitting\n",
+		       aoedev_name ( aoecmd->aoedev ), aoecmd->tag );
+		if ( aoecmd->type == &aoecmd_ata )
+			aoedev_window_close ( aoecmd->aoedev );
 		aoecmd_tx ( aoecmd );
 	}
 }
@@ -533,6 +657,7 @@ static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
 	struct ll_protocol *ll_protocol = aoedev->netdev->ll_protocol;
 	const struct aoehdr *aoehdr = data;
 	const struct aoecfg *aoecfg = &aoehdr->payload[0].cfg;
+	unsigned int bufcnt;
 
 	/* Sanity check */
 	if ( len < ( sizeof ( *aoehdr ) + sizeof ( *aoecfg ) ) ) {
@@ -550,6 +675,16 @@ static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
 	DBGC ( aoedev, "AoE %s has MAC address %s\n",
 	       aoedev_name ( aoedev ), ll_protocol->ntoa ( aoedev->target ) );
 
+	/* Limit outstanding commands to the target's buffer count */
+	bufcnt = ntohs ( aoecfg->bufcnt );
+	if ( bufcnt < 1 )
+		bufcnt = 1;
+	if ( bufcnt > AOE_MAX_WINDOW )
+		bufcnt = AOE_MAX_WINDOW;
+	aoedev->max_window = bufcnt;
+	DBGC ( aoedev, "AoE %s allows %d outstanding commands\n",
+	       aoedev_name ( aoedev ), aoedev->max_window );
+
 	return 0;
 }
 
@@ -631,8 +766,8 @@ static struct aoe_command * aoecmd_create ( struct aoe_device *aoedev,
 	aoecmd->type = type;
 	aoecmd->tag = tag;
 
-	/* Preserve timeout from last completed command */
-	aoecmd->timer.timeout = aoedev->timeout;
+	/* Use device's current retransmission timeout */
+	aoecmd->timer.timeout = aoedev_rto ( aoedev );
 
 	/* Return already mortalised.  (Reference is held by command list.) */
 	return aoecmd;
@@ -664,6 +799,7 @@ static int aoedev_ata_command ( struct aoe_device *aoedev,
 	if ( ! aoecmd )
 		return -ENOMEM;
 	memcpy ( &aoecmd->command, command, sizeof ( aoecmd->command ) );
+	aoedev->outstanding++;
 
 	/* Attempt to send command.  Allow failures to be handled by
 	 * the retry timer.
@@ -749,7 +885,17 @@ static void aoedev_close ( struct aoe_device *aoedev, int rc ) {
  * @ret len		Length of window
  */
 static size_t aoedev_window ( struct aoe_device *aoedev ) {
-	return ( aoedev->configured ? ~( ( size_t ) 0 ) : 0 );
+
+	/* Allow no commands until device is configured */
+	if ( ! aoedev->configured )
+		return 0;
+
+	/* Allow as many further commands as the congestion window
+	 * permits.
+	 */
+	if ( aoedev->outstanding >= aoedev->window )
+		return 0;
+	return ( aoedev->window - aoedev->outstanding );
 }
 
 /**
@@ -862,6 +1008,9 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 	aoedev->netdev = netdev_get ( netdev );
 	aoedev->major = major;
 	aoedev->minor = minor;
+	aoedev->max_window = 1;
+	aoedev->window = 1;
+	aoedev->window_closed = currticks();
 	memcpy ( aoedev->target, netdev->ll_broadcast,
 		 netdev->ll_protocol->ll_addr_len );
 
@@ -22,10 +22,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <string.h>
 #include <byteswap.h>
 #include <errno.h>
+#include <assert.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/if_arp.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
+#include <ipxe/init.h>
 #include <ipxe/arp.h>
 
 /** @file
@@ -38,98 +42,283 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Number of entries in the ARP cache
+ *
+ * This is a global cache, covering all network interfaces,
+ * network-layer protocols and link-layer protocols.
+ */
+#define NUM_ARP_ENTRIES 32
+
+/** Number of ARP cache hash buckets (must be a power of two) */
+#define ARP_HASH_SIZE 16
+
+/** Lifetime of a resolved ARP cache entry */
+#define ARP_LIFETIME ( 10 * 60 * TICKS_PER_SEC )
+
+/** Lifetime of a failed (negative) ARP cache entry */
+#define ARP_NEGATIVE_LIFETIME ( 3 * TICKS_PER_SEC )
+
+/** Maximum time to spend attempting to resolve an address */
+#define ARP_MAX_TIMEOUT ( 3 * TICKS_PER_SEC )
+
+/** Maximum number of packets held awaiting resolution of an address */
+#define ARP_MAX_PENDING 8
+
+/** ARP cache entry states */
+enum arp_state {
+	/** Resolution is in progress */
+	ARP_INCOMPLETE = 0,
+	/** Link-layer address is known */
+	ARP_RESOLVED,
+	/** Resolution failed */
+	ARP_FAILED,
+};
+
 /** An ARP cache entry */
 struct arp_entry {
+	/** List of ARP cache entries, in least-recently-used order
+	 *
+	 * Unused entries are held on the free list.
+	 */
+	struct list_head list;
+	/** Hash chain */
+	struct list_head hash;
+	/** Network device */
+	struct net_device *netdev;
 	/** Network-layer protocol */
 	struct net_protocol *net_protocol;
-	/** Link-layer protocol */
-	struct ll_protocol *ll_protocol;
 	/** Network-layer address */
 	uint8_t net_addr[MAX_NET_ADDR_LEN];
 	/** Link-layer address */
 	uint8_t ll_addr[MAX_LL_ADDR_LEN];
+	/** Source network-layer address used for ARP requests */
+	uint8_t source_net_addr[MAX_NET_ADDR_LEN];
+	/** Entry state */
+	enum arp_state state;
+	/** Expiry time (in ticks)
+	 *
+	 * Valid only for resolved and failed entries.
+	 */
+	unsigned long expiry;
+	/** Packets awaiting address resolution */
+	struct list_head tx_queue;
+	/** Number of packets awaiting address resolution */
+	unsigned int pending;
+	/** ARP request retransmission timer */
+	struct retry_timer timer;
 };
 
-/** Number of entries in the ARP cache
- *
- * This is a global cache, covering all network interfaces,
- * network-layer protocols and link-layer protocols.
- */
-#define NUM_ARP_ENTRIES 4
-
 /** The ARP cache */
 static struct arp_entry arp_table[NUM_ARP_ENTRIES];
 #define arp_table_end &arp_table[NUM_ARP_ENTRIES]
 
-static unsigned int next_new_arp_entry = 0;
+/** ARP cache hash buckets */
+static struct list_head arp_hash[ARP_HASH_SIZE];
+
+/** ARP cache entries in use, most recently used first */
+static LIST_HEAD ( arp_entries );
+
+/** Unused ARP cache entries */
+static LIST_HEAD ( arp_free );
 
 struct net_protocol arp_protocol __net_protocol;
 
+static void arp_expired ( struct retry_timer *timer, int over );
+
+/**
+ * Calculate ARP cache hash bucket
+ *
+ * @v net_protocol	Network-layer protocol
+ * @v net_addr		Network-layer address
+ * @ret bucket		Hash bucket
+ */
+static struct list_head * arp_bucket ( struct net_protocol *net_protocol,
+				       const void *net_addr ) {
+	const uint8_t *bytes = net_addr;
+	unsigned int hash = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < net_protocol->net_addr_len ; i++ )
+		hash = ( ( hash * 31 ) + bytes[i] );
+	return &arp_hash[ hash & ( ARP_HASH_SIZE - 1 ) ];
+}
+
+/**
+ * Check if ARP cache entry has expired
+ *
+ * @v arp		ARP cache entry
+ * @ret expired		ARP cache entry has expired
+ */
+static inline int arp_has_expired ( struct arp_entry *arp ) {
+	return ( ( arp->state != ARP_INCOMPLETE ) &&
+		 ( ( ( signed long ) ( currticks() - arp->expiry ) ) >= 0 ) );
+}
+
+/**
+ * Destroy ARP cache entry
+ *
+ * @v arp		ARP cache entry
+ * @v rc		Reason for destruction
+ *
+ * Any packets awaiting resolution are discarded.
+ */
+static void arp_destroy ( struct arp_entry *arp, int rc ) {
+	struct net_device *netdev = arp->netdev;
+	struct net_protocol *net_protocol = arp->net_protocol;
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+
+	DBG ( "ARP cache remove: %s %s %s: %s\n", netdev->name,
+	      net_protocol->name, net_protocol->ntoa ( arp->net_addr ),
+	      strerror ( rc ) );
+
+	/* Stop timer */
+	stop_timer ( &arp->timer );
+
+	/* Discard any pending packets */
+	list_for_each_entry_safe ( iobuf, tmp, &arp->tx_queue, list ) {
+		list_del ( &iobuf->list );
+		netdev_tx_err ( netdev, iobuf, rc );
+	}
+	arp->pending = 0;
+
+	/* Return entry to free list */
+	list_del ( &arp->hash );
+	list_del ( &arp->list );
+	list_add ( &arp->list, &arp_free );
+	arp->netdev = NULL;
+	netdev_put ( netdev );
+}
+
 /**
  * Find entry in the ARP cache
  *
- * @v ll_protocol	Link-layer protocol
+ * @v netdev		Network device
  * @v net_protocol	Network-layer protocol
  * @v net_addr		Network-layer address
  * @ret arp		ARP cache entry, or NULL if not found
  *
+ * A successful lookup marks the entry as most recently used.
+ * Expired entries are removed from the cache.
  */
-static struct arp_entry *
-arp_find_entry ( struct ll_protocol *ll_protocol,
-		 struct net_protocol *net_protocol,
-		 const void *net_addr ) {
+static struct arp_entry * arp_find_entry ( struct net_device *netdev,
+					   struct net_protocol *net_protocol,
+					   const void *net_addr ) {
+	struct list_head *bucket;
 	struct arp_entry *arp;
 
-	for ( arp = arp_table ; arp < arp_table_end ; arp++ ) {
-		if ( ( arp->ll_protocol == ll_protocol ) &&
+	bucket = arp_bucket ( net_protocol, net_addr );
+	list_for_each_entry ( arp, bucket, hash ) {
+		if ( ( arp->netdev == netdev ) &&
 		     ( arp->net_protocol == net_protocol ) &&
 		     ( memcmp ( arp->net_addr, net_addr,
-				net_protocol->net_addr_len ) == 0 ) )
+				net_protocol->net_addr_len ) == 0 ) ) {
+			if ( arp_has_expired ( arp ) ) {
+				arp_destroy ( arp, -ETIMEDOUT );
+				return NULL;
+			}
+			list_del ( &arp->list );
+			list_add ( &arp->list, &arp_entries );
 			return arp;
+		}
 	}
 	return NULL;
 }
 
 /**
- * Look up media-specific link-layer address in the ARP cache
+ * Create entry in the ARP cache
  *
  * @v netdev		Network device
  * @v net_protocol	Network-layer protocol
- * @v dest_net_addr	Destination network-layer address
- * @v source_net_addr	Source network-layer address
- * @ret dest_ll_addr	Destination link layer address
- * @ret rc		Return status code
+ * @v net_addr		Network-layer address
+ * @ret arp		ARP cache entry
  *
- * This function will use the ARP cache to look up the link-layer
- * address for the link-layer protocol associated with the network
- * device and the given network-layer protocol and addresses.  If
- * found, the destination link-layer address will be filled in in @c
- * dest_ll_addr.
+ * If the cache is full, the least recently used entry is evicted.
+ * The new entry is left in the incomplete state.
+ */
+static struct arp_entry * arp_create ( struct net_device *netdev,
+				       struct net_protocol *net_protocol,
+				       const void *net_addr ) {
+	struct arp_entry *arp;
+
+	/* Take an unused entry, evicting the least recently used
+	 * entry if necessary.
+	 */
+	if ( list_empty ( &arp_free ) ) {
+		arp = list_entry ( arp_entries.prev, struct arp_entry, list );
+		arp_destroy ( arp, -ENOBUFS );
+	}
+	arp = list_first_entry ( &arp_free, struct arp_entry, list );
+	assert ( arp != NULL );
+	list_del ( &arp->list );
+
+	/* Initialise entry */
+	arp->netdev = netdev_get ( netdev );
+	arp->net_protocol = net_protocol;
+	memcpy ( arp->net_addr, net_addr, net_protocol->net_addr_len );
+	arp->state = ARP_INCOMPLETE;
+	assert ( list_empty ( &arp->tx_queue ) );
+
+	/* Reset retry timer, which may have been backed off during a
+	 * previous use of this entry
+	 */
+	assert ( ! timer_running ( &arp->timer ) );
+	memset ( &arp->timer, 0, sizeof ( arp->timer ) );
+	timer_init ( &arp->timer, arp_expired, NULL );
+	arp->timer.max_timeout = ARP_MAX_TIMEOUT;
+
+	/* Add to cache */
+	list_add ( &arp->hash, arp_bucket ( net_protocol, net_addr ) );
+	list_add ( &arp->list, &arp_entries );
+
+	return arp;
+}
+
+/**
+ * Mark ARP cache entry as resolved
+ *
+ * @v arp		ARP cache entry
+ * @v ll_addr		Link-layer address
  *
- * If no address is found in the ARP cache, an ARP request will be
- * transmitted on the specified network device and -ENOENT will be
- * returned.
+ * Any packets awaiting resolution are transmitted.
  */
-int arp_resolve ( struct net_device *netdev, struct net_protocol *net_protocol,
-		  const void *dest_net_addr, const void *source_net_addr,
-		  void *dest_ll_addr ) {
+static void arp_resolved ( struct arp_entry *arp, const void *ll_addr ) {
+	struct net_device *netdev = arp->netdev;
+	struct net_protocol *net_protocol = arp->net_protocol;
 	struct ll_protocol *ll_protocol = netdev->ll_protocol;
-	const struct arp_entry *arp;
 	struct io_buffer *iobuf;
-	struct arphdr *arphdr;
-	int rc;
 
-	/* Look for existing entry in ARP table */
-	arp = arp_find_entry ( ll_protocol, net_protocol, dest_net_addr );
-	if ( arp ) {
-		DBG ( "ARP cache hit: %s %s => %s %s\n",
-		      net_protocol->name, net_protocol->ntoa ( arp->net_addr ),
-		      ll_protocol->name, ll_protocol->ntoa ( arp->ll_addr ) );
-		memcpy ( dest_ll_addr, arp->ll_addr, ll_protocol->ll_addr_len);
-		return 0;
+	/* Record link-layer address and (re)start lifetime */
+	memcpy ( arp->ll_addr, ll_addr, ll_protocol->ll_addr_len );
+	arp->state = ARP_RESOLVED;
+	arp->expiry = ( currticks() + ARP_LIFETIME );
+	stop_timer ( &arp->timer );
+	DBG ( "ARP cache update: %s %s %s => %s %s\n", netdev->name,
+	      net_protocol->name, net_protocol->ntoa ( arp->net_addr ),
+	      ll_protocol->name, ll_protocol->ntoa ( arp->ll_addr ) );
+
+	/* Transmit any pending packets */
+	while ( ( iobuf = list_first_entry ( &arp->tx_queue, struct io_buffer,
+					     list ) ) ) {
+		list_del ( &iobuf->list );
+		arp->pending--;
+		net_tx ( iobuf, netdev, net_protocol, arp->ll_addr,
+			 netdev->ll_addr );
 	}
-	DBG ( "ARP cache miss: %s %s\n", net_protocol->name,
-	      net_protocol->ntoa ( dest_net_addr ) );
+}
+
+/**
+ * Transmit ARP request
+ *
+ * @v arp		ARP cache entry
+ * @ret rc		Return status code
+ */
+static int arp_tx_request ( struct arp_entry *arp ) {
+	struct net_device *netdev = arp->netdev;
+	struct net_protocol *net_protocol = arp->net_protocol;
+	struct ll_protocol *ll_protocol = netdev->ll_protocol;
+	struct io_buffer *iobuf;
+	struct arphdr *arphdr;
 
 	/* Allocate ARP packet */
 	iobuf = alloc_iob ( MAX_LL_HEADER_LEN + sizeof ( *arphdr ) +
@@ -148,18 +337,127 @@ int arp_resolve ( struct net_device *netdev, struct net_protocol *net_protocol,
 	memcpy ( iob_put ( iobuf, ll_protocol->ll_addr_len ),
 		 netdev->ll_addr, ll_protocol->ll_addr_len );
 	memcpy ( iob_put ( iobuf, net_protocol->net_addr_len ),
-		 source_net_addr, net_protocol->net_addr_len );
+		 arp->source_net_addr, net_protocol->net_addr_len );
 	memset ( iob_put ( iobuf, ll_protocol->ll_addr_len ),
 		 0, ll_protocol->ll_addr_len );
 	memcpy ( iob_put ( iobuf, net_protocol->net_addr_len ),
-		 dest_net_addr, net_protocol->net_addr_len );
+		 arp->net_addr, net_protocol->net_addr_len );
 
 	/* Transmit ARP request */
-	if ( ( rc = net_tx ( iobuf, netdev, &arp_protocol,
-			     netdev->ll_broadcast, netdev->ll_addr ) ) != 0 )
-		return rc;
+	return net_tx ( iobuf, netdev, &arp_protocol, netdev->ll_broadcast,
+			netdev->ll_addr );
+}
 
-	return -ENOENT;
+/**
+ * Handle ARP request retransmission timer expiry
+ *
+ * @v timer		Retransmission timer
+ * @v over		Failure indicator
+ */
+static void arp_expired ( struct retry_timer *timer, int over ) {
+	struct arp_entry *arp =
+		container_of ( timer, struct arp_entry, timer );
+	struct net_device *netdev = arp->netdev;
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+
+	/* If we have exceeded the maximum timeout, mark the entry as
+	 * failed (so that further transmissions fail immediately
+	 * until the negative entry expires) and discard any pending
+	 * packets.
+	 */
+	if ( over ) {
+		DBG ( "ARP resolution failed: %s %s %s\n", netdev->name,
+		      arp->net_protocol->name,
+		      arp->net_protocol->ntoa ( arp->net_addr ) );
+		arp->state = ARP_FAILED;
+		arp->expiry = ( currticks() + ARP_NEGATIVE_LIFETIME );
+		list_for_each_entry_safe ( iobuf, tmp, &arp->tx_queue, list ) {
+			list_del ( &iobuf->list );
+			netdev_tx_err ( netdev, iobuf, -EHOSTUNREACH );
+		}
+		arp->pending = 0;
+		return;
+	}
+
+	/* Otherwise, retransmit the ARP request */
+	start_timer ( &arp->timer );
+	arp_tx_request ( arp );
+}
+
+/**
+ * Transmit packet, resolving link-layer address via ARP if necessary
+ *
+ * @v iobuf		I/O buffer
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v net_source	Source network-layer address
+ * @ret rc		Return status code
+ *
+ * This function takes ownership of the I/O buffer.  If the
+ * destination link-layer address is present in the ARP cache, the
+ * packet is transmitted immediately.  Otherwise, an ARP request is
+ * transmitted on the specified network device and the packet is
+ * held until the address is resolved.
+ */
+int arp_tx ( struct io_buffer *iobuf, struct net_device *netdev,
+	     struct net_protocol *net_protocol, const void *net_dest,
+	     const void *net_source ) {
+	struct ll_protocol *ll_protocol = netdev->ll_protocol;
+	struct arp_entry *arp;
+	struct io_buffer *oldest;
+	int rc;
+
+	/* Look for existing entry in ARP table */
+	arp = arp_find_entry ( netdev, net_protocol, net_dest );
+	if ( arp && ( arp->state == ARP_RESOLVED ) ) {
+		DBG ( "ARP cache hit: %s %s %s => %s %s\n", netdev->name,
+		      net_protocol->name, net_protocol->ntoa ( arp->net_addr ),
+		      ll_protocol->name, ll_protocol->ntoa ( arp->ll_addr ) );
+		return net_tx ( iobuf, netdev, net_protocol, arp->ll_addr,
+				netdev->ll_addr );
+	}
+	if ( arp && ( arp->state == ARP_FAILED ) ) {
+		DBG ( "ARP cache negative hit: %s %s %s\n", netdev->name,
+		      net_protocol->name, net_protocol->ntoa ( net_dest ) );
+		rc = -EHOSTUNREACH;
+		goto err;
+	}
+	DBG ( "ARP cache miss: %s %s %s\n", netdev->name, net_protocol->name,
+	      net_protocol->ntoa ( net_dest ) );
+
+	/* Create new entry and start resolution, if necessary */
+	if ( ! arp ) {
+		arp = arp_create ( netdev, net_protocol, net_dest );
+		memcpy ( arp->source_net_addr, net_source,
+			 net_protocol->net_addr_len );
+		start_timer ( &arp->timer );
+		if ( ( rc = arp_tx_request ( arp ) ) != 0 ) {
+			DBG ( "ARP could not transmit request: %s\n",
+			      strerror ( rc ) );
+			/* Continue; the timer will retransmit */
+		}
+	}
+
+	/* Hold packet until resolution completes, discarding the
+	 * oldest held packet if too many are already waiting.
+	 */
+	if ( arp->pending >= ARP_MAX_PENDING ) {
+		oldest = list_first_entry ( &arp->tx_queue, struct io_buffer,
+					    list );
+		list_del ( &oldest->list );
+		arp->pending--;
+		netdev_tx_err ( netdev, oldest, -ENOBUFS );
+	}
+	list_add_tail ( &iobuf->list, &arp->tx_queue );
+	arp->pending++;
+
+	return 0;
+
+ err:
+	netdev_tx_err ( netdev, iobuf, rc );
+	return rc;
 }
 
 /**
@@ -220,15 +518,10 @@ static int arp_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 		goto done;
 
 	/* See if we have an entry for this sender, and update it if so */
-	arp = arp_find_entry ( ll_protocol, net_protocol,
-			       arp_sender_pa ( arphdr ) );
+	arp = arp_find_entry ( netdev, net_protocol, arp_sender_pa ( arphdr ) );
 	if ( arp ) {
-		memcpy ( arp->ll_addr, arp_sender_ha ( arphdr ),
-			 arphdr->ar_hln );
+		arp_resolved ( arp, arp_sender_ha ( arphdr ) );
 		merge = 1;
-		DBG ( "ARP cache update: %s %s => %s %s\n",
-		      net_protocol->name, net_protocol->ntoa ( arp->net_addr ),
-		      ll_protocol->name, ll_protocol->ntoa ( arp->ll_addr ) );
 	}
 
 	/* See if we own the target protocol address */
@@ -237,16 +530,9 @@ static int arp_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 	
 	/* Create new ARP table entry if necessary */
 	if ( ! merge ) {
-		arp = &arp_table[next_new_arp_entry++ % NUM_ARP_ENTRIES];
-		arp->ll_protocol = ll_protocol;
-		arp->net_protocol = net_protocol;
-		memcpy ( arp->ll_addr, arp_sender_ha ( arphdr ),
-			 arphdr->ar_hln );
-		memcpy ( arp->net_addr, arp_sender_pa ( arphdr ),
-			 arphdr->ar_pln);
-		DBG ( "ARP cache add: %s %s => %s %s\n",
-		      net_protocol->name, net_protocol->ntoa ( arp->net_addr ),
-		      ll_protocol->name, ll_protocol->ntoa ( arp->ll_addr ) );
+		arp = arp_create ( netdev, net_protocol,
+				   arp_sender_pa ( arphdr ) );
+		arp_resolved ( arp, arp_sender_ha ( arphdr ) );
 	}
 
 	/* If it's not a request, there's nothing more to do */
@@ -290,3 +576,80 @@ struct net_protocol arp_protocol __net_protocol = {
 	.rx = arp_rx,
 	.ntoa = arp_ntoa,
 };
+
+/**
+ * Flush ARP cache entries for a network device
+ *
+ * @v netdev		Network device
+ * @v rc		Reason for flush
+ */
+static void arp_flush ( struct net_device *netdev, int rc ) {
+	struct arp_entry *arp;
+	struct arp_entry *tmp;
+
+	list_for_each_entry_safe ( arp, tmp, &arp_entries, list ) {
+		if ( arp->netdev == netdev )
+			arp_destroy ( arp, rc );
+	}
+}
+
+/**
+ * Probe ARP for a network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int arp_probe ( struct net_device *netdev __unused ) {
+	return 0;
+}
+
+/**
+ * Handle device or link state change
+ *
+ * @v netdev		Network device
+ */
+static void arp_notify ( struct net_device *netdev ) {
+
+	/* Flush ARP cache entries when device is closed */
+	if ( ! netdev_is_open ( netdev ) )
+		arp_flush ( netdev, -ENODEV );
+}
+
+/**
+ * Remove ARP cache entries for a network device
+ *
+ * @v netdev		Network device
+ */
+static void arp_remove ( struct net_device *netdev ) {
+	arp_flush ( netdev, -ENODEV );
+}
+
+/** ARP driver (for flushing the ARP cache) */
+struct net_driver arp_driver __net_driver = {
+	.name = "ARP",
+	.probe = arp_probe,
+	.notify = arp_notify,
+	.remove = arp_remove,
+};
+
+/**
+ * Initialise ARP cache
+ *
+ */
+static void arp_init ( void ) {
+	struct arp_entry *arp;
+	unsigned int i;
+
+	for ( i = 0 ; i < ARP_HASH_SIZE ; i++ )
+		INIT_LIST_HEAD ( &arp_hash[i] );
+	for ( arp = arp_table ; arp < arp_table_end ; arp++ ) {
+		INIT_LIST_HEAD ( &arp->tx_queue );
+		timer_init ( &arp->timer, arp_expired, NULL );
+		list_add_tail ( &arp->list, &arp_free );
+	}
+}
+
+/** ARP cache initialisation function */
+struct init_fn arp_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = arp_init,
+};
@@ -282,18 +282,19 @@ static uint16_t ipv4_pshdr_chksum ( struct io_buffer *iobuf, uint16_t csum ) {
 }
 
 /**
- * Determine link-layer address
+ * Determine link-layer address for broadcast or multicast packet
  *
  * @v dest		IPv4 destination address
- * @v src		IPv4 source address
  * @v netmask		IPv4 subnet mask
  * @v netdev		Network device
  * @v ll_dest		Link-layer destination address buffer
  * @ret rc		Return status code
+ *
+ * Returns -ENOENT for a unicast address, which must be resolved via
+ * ARP.
  */
-static int ipv4_ll_addr ( struct in_addr dest, struct in_addr src,
-			  struct in_addr netmask, struct net_device *netdev,
-			  uint8_t *ll_dest ) {
+static int ipv4_ll_addr ( struct in_addr dest, struct in_addr netmask,
+			  struct net_device *netdev, uint8_t *ll_dest ) {
 	struct ll_protocol *ll_protocol = netdev->ll_protocol;
 
 	if ( ( ( dest.s_addr ^ INADDR_BROADCAST ) & ~netmask.s_addr ) == 0 ) {
@@ -304,9 +305,8 @@ static int ipv4_ll_addr ( struct in_addr dest, struct in_addr src,
 	} else if ( IN_MULTICAST ( ntohl ( dest.s_addr ) ) ) {
 		return ll_protocol->mc_hash ( AF_INET, &dest, ll_dest );
 	} else {
-		/* Unicast address: resolve via ARP */
-		return arp_resolve ( netdev, &ipv4_protocol, &dest,
-				     &src, ll_dest );
+		/* Unicast address: must be resolved via ARP */
+		return -ENOENT;
 	}
 }
 
@@ -373,16 +373,6 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 			       ( ( netdev->rx_stats.bad & 0xf ) << 4 ) |
 			       ( ( netdev->rx_stats.good & 0xf ) << 0 ) );
 
-	/* Determine link-layer destination address */
-	if ( ( rc = ipv4_ll_addr ( next_hop, iphdr->src, netmask, netdev,
-				   ll_dest ) ) != 0 ) {
-		DBGC ( sin_dest->sin_addr, "IPv4 has no link-layer address for "
-		       "%s: %s\n", inet_ntoa ( next_hop ), strerror ( rc ) );
-		/* Record error for diagnosis */
-		netdev_tx_err ( netdev, iob_disown ( iobuf ), rc );
-		goto err;
-	}
-
 	/* Fix up checksums */
 	if ( trans_csum )
 		*trans_csum = ipv4_pshdr_chksum ( iobuf, *trans_csum );
@@ -395,6 +385,29 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 		iphdr->protocol, ntohs ( iphdr->ident ),
 		ntohs ( iphdr->chksum ) );
 
+	/* Determine link-layer destination address */
+	rc = ipv4_ll_addr ( next_hop, netmask, netdev, ll_dest );
+	if ( rc == -ENOENT ) {
+		/* Unicast address: hand off to link layer via ARP */
+		if ( ( rc = arp_tx ( iob_disown ( iobuf ), netdev,
+				     &ipv4_protocol, &next_hop,
+				     &iphdr->src ) ) != 0 ) {
+			DBGC ( sin_dest->sin_addr, "IPv4 could not transmit "
+			       "packet to %s via %s: %s\n",
+			       inet_ntoa ( next_hop ), netdev->name,
+			       strerror ( rc ) );
+			return rc;
+		}
+		return 0;
+	}
+	if ( rc != 0 ) {
+		DBGC ( sin_dest->sin_addr, "IPv4 has no link-layer address for "
+		       "%s: %s\n", inet_ntoa ( next_hop ), strerror ( rc ) );
+		/* Record error for diagnosis */
+		netdev_tx_err ( netdev, iob_disown ( iobuf ), rc );
+		goto err;
+	}
+
 	/* Hand off to link layer */
 	if ( ( rc = net_tx ( iobuf, netdev, &ipv4_protocol, ll_dest,
 			     netdev->ll_addr ) ) != 0 ) {
@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/dhcpopts.h>
 #include <ipxe/settings.h>
 #include <ipxe/device.h>
+#include <ipxe/profile.h>
 #include <ipxe/netdevice.h>
 
 /** @file
@@ -47,6 +48,153 @@ struct setting busid_setting __setting ( SETTING_NETDEV ) = {
 	.tag = NETDEV_SETTING_TAG_BUS_ID,
 };
 
+/** Network device statistics settings */
+struct setting tx_packets_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.tx",
+	.description = "Transmitted packets",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_TX_PACKETS,
+};
+struct setting tx_errors_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.tx-errors",
+	.description = "Transmit errors",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_TX_ERRORS,
+};
+struct setting tx_bytes_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.tx-bytes",
+	.description = "Transmitted bytes",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_TX_BYTES,
+};
+struct setting txq_max_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.txq-max",
+	.description = "Maximum transmit queue depth",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_TXQ_MAX,
+};
+struct setting rx_packets_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.rx",
+	.description = "Received packets",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_RX_PACKETS,
+};
+struct setting rx_errors_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.rx-errors",
+	.description = "Receive errors",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_RX_ERRORS,
+};
+struct setting rx_bytes_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.rx-bytes",
+	.description = "Received bytes",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_RX_BYTES,
+};
+struct setting rxq_max_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.rxq-max",
+	.description = "Maximum receive queue depth",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_RXQ_MAX,
+};
+struct setting polls_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.polls",
+	.description = "Device polls",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_POLLS,
+};
+struct setting rx_latency_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.rx-latency",
+	.description = "Mean receive queue latency (in us)",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_RX_LATENCY,
+};
+struct setting rx_overruns_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "stats.rx-overruns",
+	.description = "Receive ring overruns",
+	.type = &setting_type_uint32,
+	.tag = NETDEV_SETTING_TAG_RX_OVERRUNS,
+};
+
+/**
+ * Calculate mean receive queue latency
+ *
+ * @v netdev		Network device
+ * @ret latency		Mean latency (in microseconds)
+ */
+static unsigned long netdev_rx_latency ( struct net_device *netdev ) {
+	struct net_device_rx_queue_stats *stats = &netdev->rxq_stats;
+	uint64_t count = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < NETDEV_RX_LATENCY_BUCKETS ; i++ )
+		count += stats->latency_hist[i];
+	if ( ! count )
+		return 0;
+
+	return ( stats->latency / ( count * profile_rate() ) );
+}
+
+/**
+ * Fetch value of network device statistics setting
+ *
+ * @v netdev		Network device
+ * @v setting		Setting to fetch
+ * @v data		Buffer to fill with setting data
+ * @v len		Length of buffer
+ * @ret len		Length of setting data, or negative error
+ */
+static int netdev_fetch_stats ( struct net_device *netdev,
+				struct setting *setting,
+				void *data, size_t len ) {
+	unsigned long value;
+	uint32_t raw;
+
+	switch ( setting->tag ) {
+	case NETDEV_SETTING_TAG_TX_PACKETS:
+		value = netdev->tx_stats.good;
+		break;
+	case NETDEV_SETTING_TAG_TX_ERRORS:
+		value = netdev->tx_stats.bad;
+		break;
+	case NETDEV_SETTING_TAG_TX_BYTES:
+		value = netdev->tx_stats.bytes;
+		break;
+	case NETDEV_SETTING_TAG_TXQ_MAX:
+		value = netdev->txq_stats.max_depth;
+		break;
+	case NETDEV_SETTING_TAG_RX_PACKETS:
+		value = netdev->rx_stats.good;
+		break;
+	case NETDEV_SETTING_TAG_RX_ERRORS:
+		value = netdev->rx_stats.bad;
+		break;
+	case NETDEV_SETTING_TAG_RX_BYTES:
+		value = netdev->rx_stats.bytes;
+		break;
+	case NETDEV_SETTING_TAG_RXQ_MAX:
+		value = netdev->rxq_stats.max_depth;
+		break;
+	case NETDEV_SETTING_TAG_POLLS:
+		value = netdev->rxq_stats.polls;
+		break;
+	case NETDEV_SETTING_TAG_RX_LATENCY:
+		value = netdev_rx_latency ( netdev );
+		break;
+	case NETDEV_SETTING_TAG_RX_OVERRUNS:
+		value = netdev->rxq_stats.overruns;
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	raw = htonl ( value );
+	if ( len > sizeof ( raw ) )
+		len = sizeof ( raw );
+	memcpy ( data, &raw, len );
+	return sizeof ( raw );
+}
+
 /**
  * Check applicability of network device setting
  *
@@ -81,7 +229,8 @@ static int netdev_store ( struct settings *settings, struct setting *setting,
 		memcpy ( netdev->ll_addr, data, len );
 		return 0;
 	}
-	if ( setting_cmp ( setting, &busid_setting ) == 0 )
+	if ( ( setting_cmp ( setting, &busid_setting ) == 0 ) ||
+	     IS_NETDEV_STATS_SETTING_TAG ( setting->tag ) )
 		return -ENOTSUP;
 
 	return generic_settings_store ( settings, setting, data, len );
@@ -118,6 +267,8 @@ static int netdev_fetch ( struct settings *settings, struct setting *setting,
 		memcpy ( data, &dhcp_desc, len );
 		return sizeof ( dhcp_desc );
 	}
+	if ( IS_NETDEV_STATS_SETTING_TAG ( setting->tag ) )
+		return netdev_fetch_stats ( netdev, setting, data, len );
 
 	return generic_settings_fetch ( settings, setting, data, len );
 }
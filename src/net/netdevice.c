@@ -23,6 +23,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdio.h>
 #include <byteswap.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <config/general.h>
 #include <ipxe/if_ether.h>
@@ -30,6 +31,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/tables.h>
 #include <ipxe/process.h>
 #include <ipxe/init.h>
+#include <ipxe/profile.h>
 #include <ipxe/device.h>
 #include <ipxe/errortab.h>
 #include <ipxe/netdevice.h>
@@ -111,6 +113,13 @@ void netdev_link_down ( struct net_device *netdev ) {
 	}
 }
 
+/** Received packet enqueue profiler */
+static struct profiler netdev_rx_profiler __profiler =
+	{ .name = "netdev.rx" };
+
+/** Received packet processing profiler */
+static struct profiler net_rx_profiler __profiler = { .name = "net.rx" };
+
 /**
  * Record network device statistic
  *
@@ -150,6 +159,54 @@ static void netdev_record_stat ( struct net_device_stats *stats, int rc ) {
 	least_common_error->count = 1;
 }
 
+/**
+ * Find per-protocol statistics for network device
+ *
+ * @v netdev		Network device
+ * @v net_proto		Network-layer protocol, in network-byte order
+ * @ret stats		Per-protocol statistics, or NULL
+ *
+ * Statistics are kept only for the first @c NETDEV_MAX_PROTOCOLS
+ * protocols to be seen on the network device.
+ */
+static struct net_device_protocol_stats *
+netdev_protocol_stats ( struct net_device *netdev, uint16_t net_proto ) {
+	struct net_device_protocol_stats *stats;
+	unsigned int i;
+
+	for ( i = 0 ; i < ( sizeof ( netdev->proto_stats ) /
+			    sizeof ( netdev->proto_stats[0] ) ) ; i++ ) {
+		stats = &netdev->proto_stats[i];
+		if ( stats->net_proto == net_proto )
+			return stats;
+		if ( ! stats->net_proto ) {
+			stats->net_proto = net_proto;
+			return stats;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Record network device receive queue latency
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer being removed from the receive queue
+ */
+static void netdev_record_latency ( struct net_device *netdev,
+				    struct io_buffer *iobuf ) {
+	struct net_device_rx_queue_stats *stats = &netdev->rxq_stats;
+	unsigned long elapsed;
+	unsigned int bucket;
+
+	elapsed = ( profile_timestamp() - iobuf->queued );
+	stats->latency += elapsed;
+	bucket = flsl ( elapsed );
+	if ( bucket >= NETDEV_RX_LATENCY_BUCKETS )
+		bucket = ( NETDEV_RX_LATENCY_BUCKETS - 1 );
+	stats->latency_hist[bucket]++;
+}
+
 /**
  * Transmit raw packet via network device
  *
@@ -168,6 +225,9 @@ int netdev_tx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &netdev->tx_queue );
+	if ( ++netdev->txq_stats.depth > netdev->txq_stats.max_depth )
+		netdev->txq_stats.max_depth = netdev->txq_stats.depth;
+	netdev->tx_stats.bytes += iob_len ( iobuf );
 
 	/* Avoid calling transmit() on unopened network devices */
 	if ( ! netdev_is_open ( netdev ) ) {
@@ -237,6 +297,7 @@ void netdev_tx_complete_err ( struct net_device *netdev,
 
 	/* Dequeue and free I/O buffer */
 	list_del ( &iobuf->list );
+	netdev->txq_stats.depth--;
 	netdev_tx_err ( netdev, iobuf, rc );
 }
 
@@ -281,6 +342,8 @@ static void netdev_tx_flush ( struct net_device *netdev ) {
  */
 void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 
+	profile_start ( &netdev_rx_profiler );
+
 	DBGC2 ( netdev, "NETDEV %s received %p (%p+%zx)\n",
 		netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
 
@@ -288,14 +351,27 @@ void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 	if ( ( NETDEV_DISCARD_RATE > 0 ) &&
 	     ( ( random() % NETDEV_DISCARD_RATE ) == 0 ) ) {
 		netdev_rx_err ( netdev, iobuf, -EAGAIN );
+		profile_stop ( &netdev_rx_profiler );
 		return;
 	}
 
+	/* Record transport-layer checksum offload */
+	if ( iobuf->flags & IOB_FL_CSUM_VERIFIED ) {
+		assert ( netdev->caps & NETDEV_CAP_RX_CSUM );
+		netdev->rxq_stats.csum_verified++;
+	}
+
 	/* Enqueue packet */
+	iobuf->queued = profile_timestamp();
 	list_add_tail ( &iobuf->list, &netdev->rx_queue );
+	if ( ++netdev->rxq_stats.depth > netdev->rxq_stats.max_depth )
+		netdev->rxq_stats.max_depth = netdev->rxq_stats.depth;
 
-	/* Update statistics counter */
+	/* Update statistics counters */
 	netdev_record_stat ( &netdev->rx_stats, 0 );
+	netdev->rx_stats.bytes += iob_len ( iobuf );
+
+	profile_stop ( &netdev_rx_profiler );
 }
 
 /**
@@ -334,8 +410,10 @@ void netdev_rx_err ( struct net_device *netdev,
  */
 void netdev_poll ( struct net_device *netdev ) {
 
-	if ( netdev_is_open ( netdev ) )
+	if ( netdev_is_open ( netdev ) ) {
+		netdev->rxq_stats.polls++;
 		netdev->op->poll ( netdev );
+	}
 }
 
 /**
@@ -355,6 +433,8 @@ struct io_buffer * netdev_rx_dequeue ( struct net_device *netdev ) {
 		return NULL;
 
 	list_del ( &iobuf->list );
+	netdev->rxq_stats.depth--;
+	netdev_record_latency ( netdev, iobuf );
 	return iobuf;
 }
 
@@ -649,8 +729,16 @@ int net_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 	     struct net_protocol *net_protocol, const void *ll_dest,
 	     const void *ll_source ) {
 	struct ll_protocol *ll_protocol = netdev->ll_protocol;
+	struct net_device_protocol_stats *stats;
 	int rc;
 
+	/* Update per-protocol statistics */
+	stats = netdev_protocol_stats ( netdev, net_protocol->net_proto );
+	if ( stats ) {
+		stats->tx++;
+		stats->tx_bytes += iob_len ( iobuf );
+	}
+
 	/* Force a poll on the netdevice to (potentially) clear any
 	 * backed-up TX completions.  This is needed on some network
 	 * devices to avoid excessive losses due to small TX ring
@@ -685,6 +773,14 @@ int net_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 	     uint16_t net_proto, const void *ll_dest, const void *ll_source,
 	     unsigned int flags ) {
 	struct net_protocol *net_protocol;
+	struct net_device_protocol_stats *stats;
+
+	/* Update per-protocol statistics */
+	stats = netdev_protocol_stats ( netdev, net_proto );
+	if ( stats ) {
+		stats->rx++;
+		stats->rx_bytes += iob_len ( iobuf );
+	}
 
 	/* Hand off to network-layer protocol, if any */
 	for_each_table_entry ( net_protocol, NET_PROTOCOLS ) {
@@ -713,6 +809,8 @@ void net_poll ( void ) {
 	const void *ll_source;
 	uint16_t net_proto;
 	unsigned int flags;
+	unsigned int budget;
+	unsigned int count;
 	int rc;
 
 	/* Poll and process each network device */
@@ -730,25 +828,42 @@ void net_poll ( void ) {
 		if ( netdev_rx_frozen ( netdev ) )
 			continue;
 
-		/* Process at most one received packet.  Give priority
-		 * to getting packets out of the NIC over processing
-		 * the received packets, because we advertise a window
-		 * that assumes that we can receive packets from the
-		 * NIC faster than they arrive.
+		/* Process a batch of received packets.  Only packets
+		 * that were already queued when the batch started are
+		 * processed, up to a maximum of NETDEV_RX_BUDGET, so
+		 * that the batch size adapts to the queue depth while
+		 * still giving priority to getting packets out of the
+		 * NIC over processing the received packets (since we
+		 * advertise a window that assumes that we can receive
+		 * packets from the NIC faster than they arrive).
 		 */
-		if ( ( iobuf = netdev_rx_dequeue ( netdev ) ) ) {
+		budget = netdev->rxq_stats.depth;
+		if ( budget > NETDEV_RX_BUDGET )
+			budget = NETDEV_RX_BUDGET;
+		for ( count = 0 ; count < budget ; count++ ) {
+
+			/* Stop if queue processing has been frozen */
+			if ( netdev_rx_frozen ( netdev ) )
+				break;
+
+			/* Dequeue packet */
+			iobuf = netdev_rx_dequeue ( netdev );
+			if ( ! iobuf )
+				break;
 
 			DBGC2 ( netdev, "NETDEV %s processing %p (%p+%zx)\n",
 				netdev->name, iobuf, iobuf->data,
 				iob_len ( iobuf ) );
 
 			/* Remove link-layer header */
+			profile_start ( &net_rx_profiler );
 			ll_protocol = netdev->ll_protocol;
 			if ( ( rc = ll_protocol->pull ( netdev, iobuf,
 							&ll_dest, &ll_source,
 							&net_proto,
 							&flags ) ) != 0 ) {
 				free_iob ( iobuf );
+				profile_stop ( &net_rx_profiler );
 				continue;
 			}
 
@@ -759,6 +874,15 @@ void net_poll ( void ) {
 				/* Record error for diagnosis */
 				netdev_rx_err ( netdev, NULL, rc );
 			}
+			profile_stop ( &net_rx_profiler );
+		}
+
+		/* Update batch statistics */
+		if ( count ) {
+			netdev->rxq_stats.batches++;
+			netdev->rxq_stats.packets += count;
+			if ( count > netdev->rxq_stats.max_batch )
+				netdev->rxq_stats.max_batch = count;
 		}
 	}
 }
@@ -44,8 +44,78 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define MIN_TIMEOUT 7
 
-/** List of running timers */
-static LIST_HEAD ( timers );
+/** Number of slots in the timer wheel (must be a power of two)
+ *
+ * Running timers are held in a hashed timer wheel, with each timer
+ * placed in the slot corresponding to its expiry time.  Each step
+ * needs to examine only the slots for the ticks that have elapsed
+ * since the previous step, rather than every running timer.  Timers
+ * due to expire more than one revolution into the future simply
+ * remain in their slot until the wheel comes round to them again.
+ */
+#define TIMER_WHEEL_SIZE 256
+
+/* Statically initialise timer wheel slots, so that timers may be
+ * started before any initialisation functions have been called.
+ */
+#if TIMER_WHEEL_SIZE != 256
+#error "Timer wheel initialiser does not match TIMER_WHEEL_SIZE"
+#endif
+#define TIMER_WHEEL_INIT_1( n ) LIST_HEAD_INIT ( timer_wheel[n] )
+#define TIMER_WHEEL_INIT_2( n ) \
+	TIMER_WHEEL_INIT_1 ( n ), TIMER_WHEEL_INIT_1 ( (n) + 1 )
+#define TIMER_WHEEL_INIT_4( n ) \
+	TIMER_WHEEL_INIT_2 ( n ), TIMER_WHEEL_INIT_2 ( (n) + 2 )
+#define TIMER_WHEEL_INIT_8( n ) \
+	TIMER_WHEEL_INIT_4 ( n ), TIMER_WHEEL_INIT_4 ( (n) + 4 )
+#define TIMER_WHEEL_INIT_16( n ) \
+	TIMER_WHEEL_INIT_8 ( n ), TIMER_WHEEL_INIT_8 ( (n) + 8 )
+#define TIMER_WHEEL_INIT_32( n ) \
+	TIMER_WHEEL_INIT_16 ( n ), TIMER_WHEEL_INIT_16 ( (n) + 16 )
+#define TIMER_WHEEL_INIT_64( n ) \
+	TIMER_WHEEL_INIT_32 ( n ), TIMER_WHEEL_INIT_32 ( (n) + 32 )
+#define TIMER_WHEEL_INIT_128( n ) \
+	TIMER_WHEEL_INIT_64 ( n ), TIMER_WHEEL_INIT_64 ( (n) + 64 )
+#define TIMER_WHEEL_INIT_256( n ) \
+	TIMER_WHEEL_INIT_128 ( n ), TIMER_WHEEL_INIT_128 ( (n) + 128 )
+
+/** Timer wheel slots */
+static struct list_head timer_wheel[TIMER_WHEEL_SIZE] = {
+	TIMER_WHEEL_INIT_256 ( 0 )
+};
+
+/** Most recent tick processed by the timer wheel */
+static unsigned long timer_wheel_tick;
+
+/**
+ * Check if timer has expired
+ *
+ * @v timer		Retry timer
+ * @v now		Current time
+ * @ret expired		Timer has expired
+ */
+static inline int timer_due ( struct retry_timer *timer, unsigned long now ) {
+	return ( ( now - timer->start ) >= timer->timeout );
+}
+
+/**
+ * Place running timer in timer wheel
+ *
+ * @v timer		Retry timer
+ *
+ * The timer must already have been removed from any timer wheel
+ * slot.  A timer that is already due is placed in the slot for the
+ * most recently processed tick, so that it will expire on the next
+ * step.
+ */
+static void timer_wheel_add ( struct retry_timer *timer ) {
+	unsigned long expiry = ( timer->start + timer->timeout );
+
+	if ( ( ( signed long ) ( expiry - timer_wheel_tick ) ) < 0 )
+		expiry = timer_wheel_tick;
+	list_add_tail ( &timer->list,
+			&timer_wheel[ expiry & ( TIMER_WHEEL_SIZE - 1 ) ] );
+}
 
 /**
  * Start timer
@@ -57,8 +127,9 @@ static LIST_HEAD ( timers );
  * be stopped and the timer's callback function will be called.
  */
 void start_timer ( struct retry_timer *timer ) {
-	if ( ! timer->running ) {
-		list_add ( &timer->list, &timers );
+	if ( timer->running ) {
+		list_del ( &timer->list );
+	} else {
 		ref_get ( timer->refcnt );
 	}
 	timer->start = currticks();
@@ -74,6 +145,9 @@ void start_timer ( struct retry_timer *timer ) {
 	if ( timer->timeout < timer->min_timeout )
 		timer->timeout = timer->min_timeout;
 
+	/* Place in timer wheel */
+	timer_wheel_add ( timer );
+
 	DBG2 ( "Timer %p started at time %ld (expires at %ld)\n",
 	       timer, timer->start, ( timer->start + timer->timeout ) );
 }
@@ -87,6 +161,8 @@ void start_timer ( struct retry_timer *timer ) {
 void start_timer_fixed ( struct retry_timer *timer, unsigned long timeout ) {
 	start_timer ( timer );
 	timer->timeout = timeout;
+	list_del ( &timer->list );
+	timer_wheel_add ( timer );
 	DBG2 ( "Timer %p expiry time changed to %ld\n",
 	       timer, ( timer->start + timer->timeout ) );
 }
@@ -181,22 +257,44 @@ static void timer_expired ( struct retry_timer *timer ) {
  * @v process		Retry timer process
  */
 static void retry_step ( struct process *process __unused ) {
+	LIST_HEAD ( expired );
 	struct retry_timer *timer;
+	struct retry_timer *tmp;
 	unsigned long now = currticks();
-	unsigned long used;
+	unsigned long elapsed = ( now - timer_wheel_tick );
+	unsigned long tick;
+	unsigned int i;
 
-	/* Process at most one timer expiry.  We cannot process
-	 * multiple expiries in one pass, because one timer expiring
-	 * may end up triggering another timer's deletion from the
-	 * list.
+	/* Collect all expired timers from the slots for each tick
+	 * since the previous step (including the slot for the
+	 * previous step's tick, to pick up any timers started with a
+	 * zero timeout since then).
 	 */
-	list_for_each_entry ( timer, &timers, list ) {
-		used = ( now - timer->start );
-		if ( used >= timer->timeout ) {
-			timer_expired ( timer );
-			break;
+	if ( elapsed >= TIMER_WHEEL_SIZE )
+		elapsed = ( TIMER_WHEEL_SIZE - 1 );
+	for ( i = 0 ; i <= elapsed ; i++ ) {
+		tick = ( now - i );
+		list_for_each_entry_safe ( timer, tmp,
+					   &timer_wheel[ tick &
+						 ( TIMER_WHEEL_SIZE - 1 ) ],
+					   list ) {
+			if ( timer_due ( timer, now ) ) {
+				list_del ( &timer->list );
+				list_add_tail ( &timer->list, &expired );
+			}
 		}
 	}
+	timer_wheel_tick = now;
+
+	/* Process all expired timers.  A timer's expiry callback may
+	 * stop or restart other timers (including those on the
+	 * expired list), so take each timer from the head of the
+	 * list in turn.
+	 */
+	while ( ( timer = list_first_entry ( &expired, struct retry_timer,
+					     list ) ) ) {
+		timer_expired ( timer );
+	}
 }
 
 /** Retry timer process */
@@ -13,8 +13,12 @@
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
+#include <ipxe/dhcp.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/tcp.h>
+#include <ipxe/profile.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -64,6 +68,16 @@ struct tcp_connection {
 	 * Equivalent to SND.WND in RFC 793 terminology
 	 */
 	uint32_t snd_win;
+	/** Send window scale
+	 *
+	 * Equivalent to Snd.Wind.Shift in RFC 7323 terminology
+	 */
+	uint8_t snd_win_scale;
+	/** Receive window scale
+	 *
+	 * Equivalent to Rcv.Wind.Shift in RFC 7323 terminology
+	 */
+	uint8_t rcv_win_scale;
 	/** Current acknowledgement number
 	 *
 	 * Equivalent to RCV.NXT in RFC 793 terminology.
@@ -85,6 +99,12 @@ struct tcp_connection {
 	 * Equivalent to TS.Recent in RFC 1323 terminology.
 	 */
 	uint32_t ts_recent;
+	/** Selective acknowledgement list (in host-endian order)
+	 *
+	 * The first block reports the most recently received
+	 * out-of-order data, as required by RFC 2018.
+	 */
+	struct tcp_sack_block sack[TCP_SACK_MAX];
 
 	/** Transmit queue */
 	struct list_head tx_queue;
@@ -104,6 +124,8 @@ enum tcp_flags {
 	TCP_TS_ENABLED = 0x0002,
 	/** TCP acknowledgement is pending */
 	TCP_ACK_PENDING = 0x0004,
+	/** TCP selective acknowledgement is enabled */
+	TCP_SACK_ENABLED = 0x0008,
 };
 
 /** TCP internal header
@@ -118,6 +140,8 @@ struct tcp_rx_queued_header {
 	 * enqueued, and so excludes the SYN, if present.
 	 */
 	uint32_t seq;
+	/** Next SEQ value, in host-endian order */
+	uint32_t nxt;
 	/** Flags
 	 *
 	 * Only FIN is valid within this flags byte; all other flags
@@ -134,6 +158,9 @@ struct tcp_rx_queued_header {
  */
 static LIST_HEAD ( tcp_conns );
 
+/** Maximum TCP receive window */
+static size_t tcp_max_window = TCP_WINDOW_SIZE;
+
 /* Forward declarations */
 static struct interface_descriptor tcp_xfer_desc;
 static void tcp_expired ( struct retry_timer *timer, int over );
@@ -453,9 +480,107 @@ static size_t tcp_process_tx_queue ( struct tcp_connection *tcp, size_t max_len,
 }
 
 /**
- * Transmit any outstanding data
+ * Construct TCP selective acknowledgement block
  *
  * @v tcp		TCP connection
+ * @v seq		SEQ value to be contained within block
+ * @v sack		SACK block to fill in (in host-endian order)
+ * @ret len		Length of SACK block, or zero if SEQ is not queued
+ *
+ * The block is constructed from the contiguous range of queued
+ * out-of-order data that contains @c seq.
+ */
+static uint32_t tcp_sack_block ( struct tcp_connection *tcp, uint32_t seq,
+				 struct tcp_sack_block *sack ) {
+	struct io_buffer *iobuf;
+	struct tcp_rx_queued_header *tcpqhdr;
+	uint32_t left = tcp->rcv_ack;
+	uint32_t right = left;
+
+	/* Find the contiguous range which does not start after SEQ */
+	list_for_each_entry ( iobuf, &tcp->rx_queue, list ) {
+		tcpqhdr = iobuf->data;
+		if ( tcp_cmp ( tcpqhdr->seq, right ) > 0 ) {
+			if ( tcp_cmp ( tcpqhdr->seq, seq ) > 0 )
+				break;
+			left = tcpqhdr->seq;
+		}
+		if ( tcp_cmp ( tcpqhdr->nxt, right ) > 0 )
+			right = tcpqhdr->nxt;
+	}
+
+	/* Fail if this range does not contain SEQ, or lies entirely
+	 * below the acknowledgement number (and so is not out of
+	 * order).
+	 */
+	if ( ( tcp_cmp ( right, seq ) <= 0 ) ||
+	     ( tcp_cmp ( left, tcp->rcv_ack ) <= 0 ) )
+		return 0;
+
+	/* Populate SACK block */
+	sack->left = left;
+	sack->right = right;
+	return ( right - left );
+}
+
+/**
+ * Update TCP selective acknowledgement list
+ *
+ * @v tcp		TCP connection
+ * @v seq		SEQ value in first SACK block (in host-endian order)
+ * @ret count		Number of SACK blocks
+ *
+ * The first block reports the range containing @c seq (i.e. the most
+ * recently received segment), and the remaining blocks repeat the
+ * most recently reported blocks, as recommended by RFC 2018.
+ */
+static unsigned int tcp_sack ( struct tcp_connection *tcp, uint32_t seq ) {
+	struct tcp_sack_block sack[TCP_SACK_MAX];
+	unsigned int old;
+	unsigned int new = 0;
+	unsigned int i;
+
+	/* Populate first new SACK block */
+	if ( tcp_sack_block ( tcp, seq, &sack[0] ) )
+		new++;
+
+	/* Populate remaining new SACK blocks based on old SACK blocks */
+	for ( old = 0 ; old < TCP_SACK_MAX ; old++ ) {
+
+		/* Stop if we run out of space in the new list */
+		if ( new == TCP_SACK_MAX )
+			break;
+
+		/* Skip empty old SACK blocks */
+		if ( tcp->sack[old].left == tcp->sack[old].right )
+			continue;
+
+		/* Populate new SACK block */
+		if ( ! tcp_sack_block ( tcp, tcp->sack[old].left,
+					&sack[new] ) )
+			continue;
+
+		/* Eliminate duplicates */
+		for ( i = 0 ; i < new ; i++ ) {
+			if ( sack[i].left == sack[new].left )
+				break;
+		}
+		if ( i == new )
+			new++;
+	}
+
+	/* Update SACK list */
+	memset ( tcp->sack, 0, sizeof ( tcp->sack ) );
+	memcpy ( tcp->sack, sack, ( new * sizeof ( tcp->sack[0] ) ) );
+	return new;
+}
+
+/**
+ * Transmit any outstanding data (with selective acknowledgement)
+ *
+ * @v tcp		TCP connection
+ * @v sack_seq		SEQ for first selective acknowledgement (if any)
+ * @ret rc		Return status code
  * 
  * Transmits any outstanding data on the connection.
  *
@@ -463,17 +588,26 @@ static size_t tcp_process_tx_queue ( struct tcp_connection *tcp, size_t max_len,
  * will have been started if necessary, and so the stack will
  * eventually attempt to retransmit the failed packet.
  */
-static int tcp_xmit ( struct tcp_connection *tcp ) {
+static int tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
 	struct io_buffer *iobuf;
 	struct tcp_header *tcphdr;
 	struct tcp_mss_option *mssopt;
+	struct tcp_window_scale_padded_option *wsopt;
+	struct tcp_sack_permitted_padded_option *spopt;
 	struct tcp_timestamp_padded_option *tsopt;
+	struct tcp_sack_padded_option *sackopt;
+	struct tcp_sack_block *sack;
 	void *payload;
 	unsigned int flags;
+	unsigned int sack_count;
+	unsigned int sack_max;
+	unsigned int i;
+	size_t sack_len;
 	size_t len = 0;
 	uint32_t seq_len;
 	uint32_t app_win;
 	uint32_t max_rcv_win;
+	uint32_t max_representable_win;
 	int rc;
 
 	/* If retransmission timer is already running, do nothing */
@@ -509,25 +643,31 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		start_timer ( &tcp->timer );
 
 	/* Allocate I/O buffer */
-	iobuf = alloc_iob ( len + MAX_LL_NET_HEADER_LEN );
+	iobuf = alloc_iob ( len + MAX_LL_NET_TCP_HEADER_LEN );
 	if ( ! iobuf ) {
 		DBGC ( tcp, "TCP %p could not allocate iobuf for %08x..%08x "
 		       "%08x\n", tcp, tcp->snd_seq, ( tcp->snd_seq + seq_len ),
 		       tcp->rcv_ack );
 		return -ENOMEM;
 	}
-	iob_reserve ( iobuf, MAX_LL_NET_HEADER_LEN );
+	iob_reserve ( iobuf, MAX_LL_NET_TCP_HEADER_LEN );
 
 	/* Fill data payload from transmit queue */
 	tcp_process_tx_queue ( tcp, len, iobuf, 0 );
 
-	/* Expand receive window if possible */
+	/* Expand receive window if possible.  The configured maximum
+	 * window is still bounded by the amount of free memory, since
+	 * we must be able to buffer whatever we advertise.
+	 */
 	max_rcv_win = ( ( freemem * 3 ) / 4 );
-	if ( max_rcv_win > TCP_MAX_WINDOW_SIZE )
-		max_rcv_win = TCP_MAX_WINDOW_SIZE;
+	if ( max_rcv_win > tcp_max_window )
+		max_rcv_win = tcp_max_window;
 	app_win = xfer_window ( &tcp->xfer );
 	if ( max_rcv_win > app_win )
 		max_rcv_win = app_win;
+	max_representable_win = ( 0xffff << tcp->rcv_win_scale );
+	if ( max_rcv_win > max_representable_win )
+		max_rcv_win = max_representable_win;
 	max_rcv_win &= ~0x03; /* Keep everything dword-aligned */
 	if ( tcp->rcv_win < max_rcv_win )
 		tcp->rcv_win = max_rcv_win;
@@ -539,6 +679,15 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		mssopt->kind = TCP_OPTION_MSS;
 		mssopt->length = sizeof ( *mssopt );
 		mssopt->mss = htons ( TCP_MSS );
+		wsopt = iob_push ( iobuf, sizeof ( *wsopt ) );
+		wsopt->nop[0] = TCP_OPTION_NOP;
+		wsopt->wsopt.kind = TCP_OPTION_WS;
+		wsopt->wsopt.length = sizeof ( wsopt->wsopt );
+		wsopt->wsopt.scale = TCP_RX_WINDOW_SCALE;
+		spopt = iob_push ( iobuf, sizeof ( *spopt ) );
+		memset ( spopt->nop, TCP_OPTION_NOP, sizeof ( spopt->nop ) );
+		spopt->spopt.kind = TCP_OPTION_SACK_PERMITTED;
+		spopt->spopt.length = sizeof ( spopt->spopt );
 	}
 	if ( ( flags & TCP_SYN ) || ( tcp->flags & TCP_TS_ENABLED ) ) {
 		tsopt = iob_push ( iobuf, sizeof ( *tsopt ) );
@@ -548,6 +697,25 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		tsopt->tsopt.tsval = htonl ( currticks() );
 		tsopt->tsopt.tsecr = htonl ( tcp->ts_recent );
 	}
+	sack_max = ( ( tcp->flags & TCP_TS_ENABLED ) ?
+		     TCP_SACK_MAX_TS : TCP_SACK_MAX );
+	if ( ( tcp->flags & TCP_SACK_ENABLED ) &&
+	     ( ! list_empty ( &tcp->rx_queue ) ) &&
+	     ( ( sack_count = tcp_sack ( tcp, sack_seq ) ) != 0 ) ) {
+		if ( sack_count > sack_max )
+			sack_count = sack_max;
+		sack_len = ( sack_count * sizeof ( *sack ) );
+		sackopt = iob_push ( iobuf, ( sizeof ( *sackopt ) + sack_len ));
+		memset ( sackopt->nop, TCP_OPTION_NOP, sizeof ( sackopt->nop ) );
+		sackopt->sackopt.kind = TCP_OPTION_SACK;
+		sackopt->sackopt.length =
+			( sizeof ( sackopt->sackopt ) + sack_len );
+		sack = ( ( ( void * ) sackopt ) + sizeof ( *sackopt ) );
+		for ( i = 0 ; i < sack_count ; i++, sack++ ) {
+			sack->left = htonl ( tcp->sack[i].left );
+			sack->right = htonl ( tcp->sack[i].right );
+		}
+	}
 	if ( len != 0 )
 		flags |= TCP_PSH;
 	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
@@ -558,7 +726,7 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 	tcphdr->ack = htonl ( tcp->rcv_ack );
 	tcphdr->hlen = ( ( payload - iobuf->data ) << 2 );
 	tcphdr->flags = flags;
-	tcphdr->win = htons ( tcp->rcv_win );
+	tcphdr->win = htons ( tcp->rcv_win >> tcp->rcv_win_scale );
 	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
 
 	/* Dump header */
@@ -584,6 +752,18 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 	return 0;
 }
 
+/**
+ * Transmit any outstanding data
+ *
+ * @v tcp		TCP connection
+ * @ret rc		Return status code
+ */
+static int tcp_xmit ( struct tcp_connection *tcp ) {
+
+	/* Transmit without an explicit first selective acknowledgement */
+	return tcp_xmit_sack ( tcp, tcp->rcv_ack );
+}
+
 /**
  * Retransmission timer expired
  *
@@ -653,14 +833,14 @@ static int tcp_xmit_reset ( struct tcp_connection *tcp,
 	int rc;
 
 	/* Allocate space for dataless TX buffer */
-	iobuf = alloc_iob ( MAX_LL_NET_HEADER_LEN );
+	iobuf = alloc_iob ( MAX_LL_NET_TCP_HEADER_LEN );
 	if ( ! iobuf ) {
 		DBGC ( tcp, "TCP %p could not allocate iobuf for RST "
 		       "%08x..%08x %08x\n", tcp, ntohl ( in_tcphdr->ack ),
 		       ntohl ( in_tcphdr->ack ), ntohl ( in_tcphdr->seq ) );
 		return -ENOMEM;
 	}
-	iob_reserve ( iobuf, MAX_LL_NET_HEADER_LEN );
+	iob_reserve ( iobuf, MAX_LL_NET_TCP_HEADER_LEN );
 
 	/* Construct RST response */
 	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
@@ -671,7 +851,7 @@ static int tcp_xmit_reset ( struct tcp_connection *tcp,
 	tcphdr->ack = in_tcphdr->seq;
 	tcphdr->hlen = ( ( sizeof ( *tcphdr ) / 4 ) << 4 );
 	tcphdr->flags = ( TCP_RST | TCP_ACK );
-	tcphdr->win = htons ( TCP_MAX_WINDOW_SIZE );
+	tcphdr->win = htons ( 0 );
 	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
 
 	/* Dump header */
@@ -746,6 +926,18 @@ static void tcp_rx_opts ( struct tcp_connection *tcp, const void *data,
 		case TCP_OPTION_MSS:
 			options->mssopt = data;
 			break;
+		case TCP_OPTION_WS:
+			options->wsopt = data;
+			break;
+		case TCP_OPTION_SACK_PERMITTED:
+			options->spopt = data;
+			break;
+		case TCP_OPTION_SACK:
+			/* We never have more than one unacknowledged
+			 * packet in flight, so we have no use for any
+			 * selective acknowledgements sent by the peer.
+			 */
+			break;
 		case TCP_OPTION_TS:
 			options->tsopt = data;
 			break;
@@ -802,6 +994,14 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 		tcp->rcv_ack = seq;
 		if ( options->tsopt )
 			tcp->flags |= TCP_TS_ENABLED;
+		if ( options->wsopt ) {
+			tcp->snd_win_scale = options->wsopt->scale;
+			if ( tcp->snd_win_scale > TCP_MAX_WINDOW_SCALE )
+				tcp->snd_win_scale = TCP_MAX_WINDOW_SCALE;
+			tcp->rcv_win_scale = TCP_RX_WINDOW_SCALE;
+		}
+		if ( options->spopt )
+			tcp->flags |= TCP_SACK_ENABLED;
 	}
 
 	/* Ignore duplicate SYN */
@@ -873,7 +1073,7 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	/* Update SEQ and sent counters, and window size */
 	tcp->snd_seq = ack;
 	tcp->snd_sent = 0;
-	tcp->snd_win = win;
+	tcp->snd_win = ( win << tcp->snd_win_scale );
 
 	/* Remove any acknowledged data from transmit queue */
 	tcp_process_tx_queue ( tcp, len, NULL, 1 );
@@ -1024,15 +1224,19 @@ static void tcp_rx_enqueue ( struct tcp_connection *tcp, uint32_t seq,
 	/* Add internal header */
 	tcpqhdr = iob_push ( iobuf, sizeof ( *tcpqhdr ) );
 	tcpqhdr->seq = seq;
+	tcpqhdr->nxt = ( seq + seq_len );
 	tcpqhdr->flags = flags;
 
-	/* Add to RX queue */
-	list_for_each_entry ( queued, &tcp->rx_queue, list ) {
+	/* Add to RX queue.  Search backwards from the tail of the
+	 * queue, since with a large receive window the new packet
+	 * will most commonly belong at or near the end.
+	 */
+	list_for_each_entry_reverse ( queued, &tcp->rx_queue, list ) {
 		tcpqhdr = queued->data;
-		if ( tcp_cmp ( seq, tcpqhdr->seq ) < 0 )
+		if ( tcp_cmp ( seq, tcpqhdr->seq ) >= 0 )
 			break;
 	}
-	list_add_tail ( &iobuf->list, &queued->list );
+	list_add ( &iobuf->list, &queued->list );
 }
 
 /**
@@ -1079,6 +1283,9 @@ static void tcp_process_rx_queue ( struct tcp_connection *tcp ) {
 	}
 }
 
+/** Received packet profiler */
+static struct profiler tcp_rx_profiler __profiler = { .name = "tcp.rx" };
+
 /**
  * Process received packet
  *
@@ -1106,6 +1313,8 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	size_t old_xfer_window;
 	int rc;
 
+	profile_start ( &tcp_rx_profiler );
+
 	/* Sanity check packet */
 	if ( iob_len ( iobuf ) < sizeof ( *tcphdr ) ) {
 		DBG ( "TCP packet too short at %zd bytes (min %zd bytes)\n",
@@ -1126,13 +1335,15 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		rc = -EINVAL;
 		goto discard;
 	}
-	csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
-				       iob_len ( iobuf ) );
-	if ( csum != 0 ) {
-		DBG ( "TCP checksum incorrect (is %04x including checksum "
-		      "field, should be 0000)\n", csum );
-		rc = -EINVAL;
-		goto discard;
+	if ( ! ( iobuf->flags & IOB_FL_CSUM_VERIFIED ) ) {
+		csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
+					       iob_len ( iobuf ) );
+		if ( csum != 0 ) {
+			DBG ( "TCP checksum incorrect (is %04x including "
+			      "checksum field, should be 0000)\n", csum );
+			rc = -EINVAL;
+			goto discard;
+		}
 	}
 	
 	/* Parse parameters from header and strip header */
@@ -1203,8 +1414,11 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	/* Dump out any state change as a result of the received packet */
 	tcp_dump_state ( tcp );
 
-	/* Send out any pending data */
-	tcp_xmit ( tcp );
+	/* Send out any pending data.  If this packet was out of
+	 * order, the first selective acknowledgement block (if any)
+	 * will describe it.
+	 */
+	tcp_xmit_sack ( tcp, seq );
 
 	/* If this packet was the last we expect to receive, set up
 	 * timer to expire and cause the connection to be freed.
@@ -1218,11 +1432,13 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	if ( tcp_xfer_window ( tcp ) != old_xfer_window )
 		xfer_window_changed ( &tcp->xfer );
 
+	profile_stop ( &tcp_rx_profiler );
 	return 0;
 
  discard:
 	/* Free received packet */
 	free_iob ( iobuf );
+	profile_stop ( &tcp_rx_profiler );
 	return rc;
 }
 
@@ -1359,3 +1575,44 @@ struct uri_opener tcp_uri_opener __uri_opener = {
 	.open		= tcp_open_uri,
 };
 
+/***************************************************************************
+ *
+ * Settings
+ *
+ ***************************************************************************
+ */
+
+/** TCP receive window setting */
+struct setting tcp_window_setting __setting ( SETTING_MISC ) = {
+	.name = "tcp-window",
+	.description = "Maximum TCP receive window",
+	.tag = DHCP_EB_TCP_WINDOW,
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Apply TCP settings
+ *
+ * @ret rc		Return status code
+ */
+static int tcp_apply_settings ( void ) {
+	unsigned long window;
+
+	/* Use configured window, if any, falling back to the default */
+	if ( fetch_uint_setting ( NULL, &tcp_window_setting, &window ) <= 0 )
+		window = TCP_WINDOW_SIZE;
+	if ( window > TCP_MAX_WINDOW_SIZE )
+		window = TCP_MAX_WINDOW_SIZE;
+	if ( window != tcp_max_window ) {
+		DBG ( "TCP using maximum receive window of %ld bytes\n",
+		      window );
+		tcp_max_window = window;
+	}
+
+	return 0;
+}
+
+/** TCP settings applicator */
+struct settings_applicator tcp_settings_applicator __settings_applicator = {
+	.apply = tcp_apply_settings,
+};
@@ -47,12 +47,16 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/blockdev.h>
 #include <ipxe/acpi.h>
 #include <ipxe/http.h>
+#include <config/general.h>
 
 FEATURE ( FEATURE_PROTOCOL, "HTTP", DHCP_EB_FEATURE_HTTP, 1 );
 
 /** Block size used for HTTP block device request */
 #define HTTP_BLKSIZE 512
 
+/** Minimum length of file to be downloaded using parallel connections */
+#define HTTP_PARALLEL_MIN_LEN ( 4 * 1024 * 1024 )
+
 /** HTTP flags */
 enum http_flags {
 	/** Request is waiting to be transmitted */
@@ -61,6 +65,10 @@ enum http_flags {
 	HTTP_HEAD_ONLY = 0x0002,
 	/** Keep connection alive */
 	HTTP_KEEPALIVE = 0x0004,
+	/** Server accepts byte range requests */
+	HTTP_ACCEPT_RANGES = 0x0008,
+	/** Request is the primary part of a parallel download */
+	HTTP_PARALLEL_PRIMARY = 0x0010,
 };
 
 /** HTTP receive state */
@@ -88,6 +96,11 @@ struct http_request {
 
 	/** URI being fetched */
 	struct uri *uri;
+	/** Default port number */
+	unsigned int default_port;
+	/** Filter to apply to socket, or NULL */
+	int ( * filter ) ( struct interface *xfer, const char *name,
+			   struct interface **next );
 	/** Transport layer interface */
 	struct interface socket;
 
@@ -115,8 +128,20 @@ struct http_request {
 	struct line_buffer linebuf;
 	/** Receive data buffer (if applicable) */
 	userptr_t rx_buffer;
+
+	/** Parent request (if this is part of a parallel download) */
+	struct http_request *parent;
+	/** List of parts of a parallel download */
+	struct list_head list;
+	/** Outstanding parts of a parallel download (if primary) */
+	struct list_head parts;
+	/** Number of incomplete parts of a parallel download (if primary) */
+	unsigned int pending;
 };
 
+static void http_parallel_done ( struct http_request *http, int rc );
+static void http_parallel ( struct http_request *http );
+
 /**
  * Free HTTP request
  *
@@ -138,6 +163,8 @@ static void http_free ( struct refcnt *refcnt ) {
  * @v rc		Return status code
  */
 static void http_close ( struct http_request *http, int rc ) {
+	struct http_request *parent;
+	struct http_request *part;
 
 	/* Prevent further processing of any current packet */
 	http->rx_state = HTTP_RX_DEAD;
@@ -155,10 +182,52 @@ static void http_close ( struct http_request *http, int rc ) {
 	/* Remove process */
 	process_del ( &http->process );
 
+	/* Close any outstanding parts of a parallel download */
+	while ( ( part = list_first_entry ( &http->parts, struct http_request,
+					    list ) ) ) {
+		list_del ( &part->list );
+		part->parent = NULL;
+		ref_put ( &http->refcnt );
+		http_close ( part, rc );
+	}
+
 	/* Close all data transfer interfaces */
 	intf_shutdown ( &http->socket, rc );
 	intf_shutdown ( &http->partial, rc );
 	intf_shutdown ( &http->xfer, rc );
+
+	/* Notify parent request, if this is part of a parallel download */
+	if ( ( parent = http->parent ) != NULL ) {
+		list_del ( &http->list );
+		http->parent = NULL;
+		http_parallel_done ( parent, rc );
+		ref_put ( &parent->refcnt );
+	}
+}
+
+/**
+ * Record completion of one part of a parallel download
+ *
+ * @v http		Primary HTTP request
+ * @v rc		Return status code for this part
+ *
+ * The download is complete once all parts have completed
+ * successfully, and is aborted if any part fails.
+ */
+static void http_parallel_done ( struct http_request *http, int rc ) {
+
+	/* Abort the whole download on any error */
+	if ( rc != 0 ) {
+		http_close ( http, rc );
+		return;
+	}
+
+	/* Complete the download once all parts are complete */
+	assert ( http->pending > 0 );
+	if ( --http->pending == 0 ) {
+		DBGC ( http, "HTTP %p parallel download complete\n", http );
+		http_close ( http, 0 );
+	}
 }
 
 /**
@@ -176,6 +245,18 @@ static void http_done ( struct http_request *http ) {
 		return;
 	}
 
+	/* If this is the primary part of a parallel download, then
+	 * the server is still sending the remainder of the file.
+	 * Stop receiving, and wait for the other parts to complete.
+	 */
+	if ( http->flags & HTTP_PARALLEL_PRIMARY ) {
+		DBGC ( http, "HTTP %p primary part complete\n", http );
+		http->rx_state = HTTP_RX_DEAD;
+		intf_restart ( &http->socket, 0 );
+		http_parallel_done ( http, 0 );
+		return;
+	}
+
 	/* Enter idle state */
 	http->rx_state = HTTP_RX_IDLE;
 	http->rx_len = 0;
@@ -241,6 +322,12 @@ static int http_rx_response ( struct http_request *http, char *response ) {
 	if ( ( rc = http_response_to_rc ( code ) ) != 0 )
 		return rc;
 
+	/* Part of a parallel download must receive only its own range */
+	if ( http->parent && ( code != 206 ) ) {
+		DBGC ( http, "HTTP %p range request not honoured\n", http );
+		return -EIO;
+	}
+
 	/* Move to received headers */
 	http->rx_state = HTTP_RX_HEADER;
 	return 0;
@@ -332,6 +419,24 @@ static int http_rx_transfer_encoding ( struct http_request *http,
 	return 0;
 }
 
+/**
+ * Handle HTTP Accept-Ranges header
+ *
+ * @v http		HTTP request
+ * @v value		HTTP header value
+ * @ret rc		Return status code
+ */
+static int http_rx_accept_ranges ( struct http_request *http,
+				   const char *value ) {
+
+	if ( strcasecmp ( value, "bytes" ) == 0 ) {
+		/* Mark server as accepting byte range requests */
+		http->flags |= HTTP_ACCEPT_RANGES;
+	}
+
+	return 0;
+}
+
 /** An HTTP header handler */
 struct http_header_handler {
 	/** Name (e.g. "Content-Length") */
@@ -361,6 +466,10 @@ static struct http_header_handler http_header_handlers[] = {
 		.header = "Transfer-Encoding",
 		.rx = http_rx_transfer_encoding,
 	},
+	{
+		.header = "Accept-Ranges",
+		.rx = http_rx_accept_ranges,
+	},
 	{ NULL, NULL }
 };
 
@@ -383,6 +492,7 @@ static int http_rx_header ( struct http_request *http, char *header ) {
 		if ( ( http->rx_state == HTTP_RX_HEADER ) &&
 		     ( ! ( http->flags & HTTP_HEAD_ONLY ) ) ) {
 			DBGC ( http, "HTTP %p start of data\n", http );
+			http_parallel ( http );
 			http->rx_state = ( http->chunked ?
 					   HTTP_RX_CHUNK_LEN : HTTP_RX_DATA );
 			return 0;
@@ -476,6 +586,60 @@ static struct http_line_handler http_line_handlers[] = {
 	[HTTP_RX_TRAILER]	= { .rx = http_rx_header },
 };
 
+/**
+ * Identify recipient of received data
+ *
+ * @v http		HTTP request
+ * @ret xfer		Data transfer interface
+ */
+static inline struct interface * http_data_xfer ( struct http_request *http ) {
+
+	/* Parts of a parallel download deliver via the primary request */
+	return ( http->parent ? &http->parent->xfer : &http->xfer );
+}
+
+/**
+ * Construct metadata for received data
+ *
+ * @v http		HTTP request
+ * @v meta		Data transfer metadata to fill in
+ */
+static void http_data_meta ( struct http_request *http,
+			     struct xfer_metadata *meta ) {
+
+	memset ( meta, 0, sizeof ( *meta ) );
+	if ( http->parent || ( http->flags & HTTP_PARALLEL_PRIMARY ) ) {
+		/* Parts of a parallel download may be interleaved
+		 * arbitrarily
+		 */
+		meta->flags = XFER_FL_ABS_OFFSET;
+		meta->offset = ( http->partial_start + http->rx_len );
+	}
+}
+
+/**
+ * Record progress of received data
+ *
+ * @v http		HTTP request
+ * @v len		Length of data received
+ */
+static void http_rx_data_progress ( struct http_request *http, size_t len ) {
+
+	http->rx_len += len;
+	if ( http->chunk_remaining ) {
+		http->chunk_remaining -= len;
+		if ( http->chunk_remaining == 0 )
+			http->rx_state = HTTP_RX_CHUNK_LEN;
+	}
+	if ( http->remaining ) {
+		http->remaining -= len;
+		if ( ( http->remaining == 0 ) &&
+		     ( http->rx_state == HTTP_RX_DATA ) ) {
+			http_done ( http );
+		}
+	}
+}
+
 /**
  * Handle new data arriving via HTTP connection
  *
@@ -487,6 +651,8 @@ static struct http_line_handler http_line_handlers[] = {
 static int http_socket_deliver ( struct http_request *http,
 				 struct io_buffer *iobuf,
 				 struct xfer_metadata *meta __unused ) {
+	struct interface *xfer = http_data_xfer ( http );
+	struct xfer_metadata data_meta;
 	struct http_line_handler *lh;
 	char *line;
 	size_t data_len;
@@ -518,6 +684,7 @@ static int http_socket_deliver ( struct http_request *http,
 			     ( http->remaining < data_len ) ) {
 				data_len = http->remaining;
 			}
+			http_data_meta ( http, &data_meta );
 			if ( http->rx_buffer != UNULL ) {
 				/* Copy to partial transfer buffer */
 				copy_to_user ( http->rx_buffer, http->rx_len,
@@ -525,30 +692,20 @@ static int http_socket_deliver ( struct http_request *http,
 				iob_pull ( iobuf, data_len );
 			} else if ( data_len < iob_len ( iobuf ) ) {
 				/* Deliver partial buffer as raw data */
-				rc = xfer_deliver_raw ( &http->xfer,
-							iobuf->data, data_len );
+				rc = xfer_deliver_raw_meta ( xfer, iobuf->data,
+							     data_len,
+							     &data_meta );
 				iob_pull ( iobuf, data_len );
 				if ( rc != 0 )
 					goto done;
 			} else {
 				/* Deliver whole I/O buffer */
-				if ( ( rc = xfer_deliver_iob ( &http->xfer,
-						 iob_disown ( iobuf ) ) ) != 0 )
+				if ( ( rc = xfer_deliver ( xfer,
+							   iob_disown ( iobuf ),
+							   &data_meta ) ) != 0 )
 					goto done;
 			}
-			http->rx_len += data_len;
-			if ( http->chunk_remaining ) {
-				http->chunk_remaining -= data_len;
-				if ( http->chunk_remaining == 0 )
-					http->rx_state = HTTP_RX_CHUNK_LEN;
-			}
-			if ( http->remaining ) {
-				http->remaining -= data_len;
-				if ( ( http->remaining == 0 ) &&
-				     ( http->rx_state == HTTP_RX_DATA ) ) {
-					http_done ( http );
-				}
-			}
+			http_rx_data_progress ( http, data_len );
 			break;
 		case HTTP_RX_RESPONSE:
 		case HTTP_RX_HEADER:
@@ -586,6 +743,87 @@ static int http_socket_deliver ( struct http_request *http,
 	return rc;
 }
 
+/**
+ * Get buffer for direct placement of data arriving via HTTP connection
+ *
+ * @v http		HTTP request
+ * @v len		Length of data to be placed
+ * @v meta		Data transfer metadata
+ * @ret data		Buffer, or NULL
+ *
+ * Data can be placed directly only while receiving an unchunked
+ * response body, since chunk headers must otherwise be stripped.
+ */
+static void * http_socket_buffer ( struct http_request *http, size_t len,
+				   struct xfer_metadata *meta __unused ) {
+	struct xfer_metadata data_meta;
+
+	/* Refuse unless we are receiving unchunked data */
+	if ( ( http->rx_state != HTTP_RX_DATA ) || http->chunked )
+		return NULL;
+
+	/* Refuse if the data may extend beyond the end of the
+	 * response body, since the sender will already have written
+	 * the excess into the buffer by the time we could reject it.
+	 */
+	if ( http->remaining && ( len > http->remaining ) )
+		return NULL;
+
+	/* Refuse for parallel downloads, where any such excess would
+	 * overwrite data belonging to another part.
+	 */
+	if ( http->parent || ( http->flags & HTTP_PARALLEL_PRIMARY ) )
+		return NULL;
+
+	/* Use partial transfer buffer, if applicable */
+	if ( http->rx_buffer != UNULL ) {
+		if ( ( http->rx_len + len ) > http->partial_len )
+			return NULL;
+		return user_to_virt ( http->rx_buffer, http->rx_len );
+	}
+
+	/* Otherwise, use the recipient's buffer */
+	http_data_meta ( http, &data_meta );
+	return xfer_buffer ( http_data_xfer ( http ), len, &data_meta );
+}
+
+/**
+ * Handle data placed directly via HTTP connection
+ *
+ * @v http		HTTP request
+ * @v len		Length of data placed
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_socket_deliver_into ( struct http_request *http, size_t len,
+				      struct xfer_metadata *meta __unused ) {
+	struct xfer_metadata data_meta;
+	int rc;
+
+	/* Refuse data beyond the end of the response body */
+	if ( http->remaining && ( len > http->remaining ) ) {
+		DBGC ( http, "HTTP %p received %zd bytes beyond end of "
+		       "response\n", http, ( len - http->remaining ) );
+		rc = -EPROTO;
+		goto err;
+	}
+
+	/* Pass data to caller, unless already in partial transfer buffer */
+	if ( http->rx_buffer == UNULL ) {
+		http_data_meta ( http, &data_meta );
+		if ( ( rc = xfer_deliver_into ( http_data_xfer ( http ), len,
+						&data_meta ) ) != 0 )
+			goto err;
+	}
+	http_rx_data_progress ( http, len );
+
+	return 0;
+
+ err:
+	http_close ( http, rc );
+	return rc;
+}
+
 /**
  * Check HTTP socket flow control window
  *
@@ -646,7 +884,7 @@ static void http_step ( struct http_request *http ) {
 
 	/* Force a HEAD request if we have nowhere to send any received data */
 	if ( ( xfer_window ( &http->xfer ) == 0 ) &&
-	     ( http->rx_buffer == UNULL ) ) {
+	     ( http->rx_buffer == UNULL ) && ( ! http->parent ) ) {
 		http->flags |= ( HTTP_HEAD_ONLY | HTTP_KEEPALIVE );
 	}
 
@@ -791,6 +1029,9 @@ static int http_acpi_describe ( struct http_request *http,
 static struct interface_operation http_socket_operations[] = {
 	INTF_OP ( xfer_window, struct http_request *, http_socket_window ),
 	INTF_OP ( xfer_deliver, struct http_request *, http_socket_deliver ),
+	INTF_OP ( xfer_buffer, struct http_request *, http_socket_buffer ),
+	INTF_OP ( xfer_deliver_into, struct http_request *,
+		  http_socket_deliver_into ),
 	INTF_OP ( xfer_window_changed, struct http_request *, http_step ),
 	INTF_OP ( intf_close, struct http_request *, http_close ),
 };
@@ -828,6 +1069,154 @@ static struct interface_descriptor http_xfer_desc =
 static struct process_descriptor http_process_desc =
 	PROC_DESC_ONCE ( struct http_request, process, http_step );
 
+/**
+ * Allocate HTTP request
+ *
+ * @v uri		Uniform Resource Identifier
+ * @v default_port	Default port number
+ * @v filter		Filter to apply to socket, or NULL
+ * @ret http		HTTP request, or NULL
+ */
+static struct http_request *
+http_alloc ( struct uri *uri, unsigned int default_port,
+	     int ( * filter ) ( struct interface *xfer, const char *name,
+				struct interface **next ) ) {
+	struct http_request *http;
+
+	/* Allocate and populate HTTP structure */
+	http = zalloc ( sizeof ( *http ) );
+	if ( ! http )
+		return NULL;
+	ref_init ( &http->refcnt, http_free );
+	intf_init ( &http->xfer, &http_xfer_desc, &http->refcnt );
+	intf_init ( &http->partial, &http_partial_desc, &http->refcnt );
+	http->uri = uri_get ( uri );
+	http->default_port = default_port;
+	http->filter = filter;
+	intf_init ( &http->socket, &http_socket_desc, &http->refcnt );
+	process_init ( &http->process, &http_process_desc, &http->refcnt );
+	INIT_LIST_HEAD ( &http->parts );
+	http->flags = HTTP_TX_PENDING;
+
+	return http;
+}
+
+/**
+ * Open HTTP socket
+ *
+ * @v http		HTTP request
+ * @ret rc		Return status code
+ */
+static int http_connect ( struct http_request *http ) {
+	struct sockaddr_tcpip server;
+	struct interface *socket;
+	int rc;
+
+	/* Open socket */
+	memset ( &server, 0, sizeof ( server ) );
+	server.st_port = htons ( uri_port ( http->uri, http->default_port ) );
+	socket = &http->socket;
+	if ( http->filter ) {
+		if ( ( rc = http->filter ( socket, http->uri->host,
+					   &socket ) ) != 0 )
+			return rc;
+	}
+	if ( ( rc = xfer_open_named_socket ( socket, SOCK_STREAM,
+					     ( struct sockaddr * ) &server,
+					     http->uri->host, NULL ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/**
+ * Open part of a parallel download
+ *
+ * @v http		Primary HTTP request
+ * @v start		Starting offset of part
+ * @v len		Length of part
+ * @ret rc		Return status code
+ */
+static int http_open_part ( struct http_request *http, size_t start,
+			    size_t len ) {
+	struct http_request *part;
+	int rc;
+
+	/* Allocate and populate HTTP structure */
+	part = http_alloc ( http->uri, http->default_port, http->filter );
+	if ( ! part )
+		return -ENOMEM;
+	part->partial_start = start;
+	part->partial_len = len;
+	part->remaining = len;
+
+	/* Open socket */
+	if ( ( rc = http_connect ( part ) ) != 0 )
+		goto err;
+
+	/* Attach to primary request, mortalise self, and return */
+	DBGC ( http, "HTTP %p part %p fetching [%zd,%zd)\n",
+	       http, part, start, ( start + len ) );
+	part->parent = http;
+	ref_get ( &http->refcnt );
+	list_add_tail ( &part->list, &http->parts );
+	http->pending++;
+	ref_put ( &part->refcnt );
+	return 0;
+
+ err:
+	DBGC ( http, "HTTP %p could not open part [%zd,%zd): %s\n",
+	       http, start, ( start + len ), strerror ( rc ) );
+	http_close ( part, rc );
+	ref_put ( &part->refcnt );
+	return rc;
+}
+
+/**
+ * Split large download into parallel range requests
+ *
+ * @v http		HTTP request
+ *
+ * A sufficiently large file from a server that accepts byte range
+ * requests is split into up to @c HTTP_PARALLEL parts, each fetched
+ * over its own connection.  This request continues to receive the
+ * first part; the remainder of its response is discarded.  Failure
+ * to open a part is not an error: the preceding part simply extends
+ * to cover it.
+ */
+static void http_parallel ( struct http_request *http ) {
+	size_t total = http->remaining;
+	size_t part_len = ( total / HTTP_PARALLEL );
+	size_t start;
+	size_t end;
+	unsigned int i;
+
+	/* Do nothing unless this is a large, ordinary download */
+	if ( ( HTTP_PARALLEL < 2 ) || http->parent || http->chunked ||
+	     ( http->partial.dest != &null_intf ) ||
+	     ( ! ( http->flags & HTTP_ACCEPT_RANGES ) ) ||
+	     ( total < HTTP_PARALLEL_MIN_LEN ) )
+		return;
+
+	/* Open parts, starting from the end of the file */
+	DBGC ( http, "HTTP %p splitting %zd bytes across %d connections\n",
+	       http, total, HTTP_PARALLEL );
+	end = total;
+	for ( i = ( HTTP_PARALLEL - 1 ) ; i > 0 ; i-- ) {
+		start = ( i * part_len );
+		if ( http_open_part ( http, start, ( end - start ) ) != 0 )
+			break;
+		end = start;
+	}
+
+	/* Receive only the first part via this request */
+	if ( end < total ) {
+		http->flags |= HTTP_PARALLEL_PRIMARY;
+		http->remaining = end;
+		http->pending++;
+	}
+}
+
 /**
  * Initiate an HTTP connection, with optional filter
  *
@@ -840,10 +1229,9 @@ static struct process_descriptor http_process_desc =
 int http_open_filter ( struct interface *xfer, struct uri *uri,
 		       unsigned int default_port,
 		       int ( * filter ) ( struct interface *xfer,
+					  const char *name,
 					  struct interface **next ) ) {
 	struct http_request *http;
-	struct sockaddr_tcpip server;
-	struct interface *socket;
 	int rc;
 
 	/* Sanity checks */
@@ -851,28 +1239,12 @@ int http_open_filter ( struct interface *xfer, struct uri *uri,
 		return -EINVAL;
 
 	/* Allocate and populate HTTP structure */
-	http = zalloc ( sizeof ( *http ) );
+	http = http_alloc ( uri, default_port, filter );
 	if ( ! http )
 		return -ENOMEM;
-	ref_init ( &http->refcnt, http_free );
-	intf_init ( &http->xfer, &http_xfer_desc, &http->refcnt );
-	intf_init ( &http->partial, &http_partial_desc, &http->refcnt );
-       	http->uri = uri_get ( uri );
-	intf_init ( &http->socket, &http_socket_desc, &http->refcnt );
-	process_init ( &http->process, &http_process_desc, &http->refcnt );
-	http->flags = HTTP_TX_PENDING;
 
 	/* Open socket */
-	memset ( &server, 0, sizeof ( server ) );
-	server.st_port = htons ( uri_port ( http->uri, default_port ) );
-	socket = &http->socket;
-	if ( filter ) {
-		if ( ( rc = filter ( socket, &socket ) ) != 0 )
-			goto err;
-	}
-	if ( ( rc = xfer_open_named_socket ( socket, SOCK_STREAM,
-					     ( struct sockaddr * ) &server,
-					     uri->host, NULL ) ) != 0 )
+	if ( ( rc = http_connect ( http ) ) != 0 )
 		goto err;
 
 	/* Attach to parent interface, mortalise self, and return */
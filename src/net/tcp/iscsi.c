@@ -132,10 +132,16 @@ FEATURE ( FEATURE_PROTOCOL, "iSCSI", DHCP_EB_FEATURE_ISCSI, 1 );
 #define EINFO_EPROTO_INVALID_CHAP_RESPONSE \
 	__einfo_uniqify ( EINFO_EPROTO, 0x04, "Invalid CHAP response" )
 
-static void iscsi_start_tx ( struct iscsi_session *iscsi );
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task );
+static void iscsi_tx_abort ( struct iscsi_session *iscsi );
+static void iscsi_task_done ( struct iscsi_task *task, int rc,
+			      struct scsi_rsp *rsp );
 static void iscsi_start_login ( struct iscsi_session *iscsi );
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
+				   struct iscsi_task *task,
 				   unsigned int datasn );
+static void iscsi_tx_schedule ( struct iscsi_session *iscsi );
 
 /**
  * Finish receiving PDU data into buffer
@@ -195,7 +201,8 @@ static void iscsi_free ( struct refcnt *refcnt ) {
 	free ( iscsi->target_password );
 	chap_finish ( &iscsi->chap );
 	iscsi_rx_buffered_data_done ( iscsi );
-	free ( iscsi->command );
+	assert ( list_empty ( &iscsi->tasks ) );
+	assert ( iscsi->tx_task == NULL );
 	free ( iscsi );
 }
 
@@ -206,6 +213,8 @@ static void iscsi_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for close
  */
 static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
+	struct iscsi_task *task;
+	struct iscsi_task *tmp;
 
 	/* A TCP graceful close is still an error from our point of view */
 	if ( rc == 0 )
@@ -215,22 +224,26 @@ static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
 
 	/* Stop transmission process */
 	process_del ( &iscsi->process );
+	iscsi_tx_abort ( iscsi );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &iscsi->socket, rc );
 	intf_shutdown ( &iscsi->control, rc );
-	intf_shutdown ( &iscsi->data, rc );
+
+	/* Fail any outstanding tasks */
+	list_for_each_entry_safe ( task, tmp, &iscsi->tasks, list )
+		iscsi_task_done ( task, rc, NULL );
 }
 
 /**
  * Assign new iSCSI initiator task tag
  *
- * @v iscsi		iSCSI session
+ * @ret itt		Initiator task tag
  */
-static void iscsi_new_itt ( struct iscsi_session *iscsi ) {
+static uint32_t iscsi_new_itt ( void ) {
 	static uint16_t itt_idx;
 
-	iscsi->itt = ( ISCSI_TAG_MAGIC | (++itt_idx) );
+	return ( ISCSI_TAG_MAGIC | (++itt_idx) );
 }
 
 /**
@@ -269,7 +282,13 @@ static int iscsi_open_connection ( struct iscsi_session *iscsi ) {
 	iscsi->isid_iana_qual = ( random() & 0xffff );
 
 	/* Assign fresh initiator task tag */
-	iscsi_new_itt ( iscsi );
+	iscsi->itt = iscsi_new_itt();
+
+	/* Assume default operational parameters until negotiated */
+	iscsi->max_send_len = ISCSI_DEFAULT_MAX_RECV_DATA_SEG_LEN;
+	iscsi->first_burst_len = ISCSI_DEFAULT_FIRST_BURST_LEN;
+	iscsi->max_burst_len = ISCSI_DEFAULT_MAX_BURST_LEN;
+	iscsi->max_r2t = 1;
 
 	/* Initiate login */
 	iscsi_start_login ( iscsi );
@@ -295,7 +314,7 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
 	iscsi->status = 0;
 
 	/* Reset TX and RX state machines */
-	iscsi->tx_state = ISCSI_TX_IDLE;
+	iscsi_tx_abort ( iscsi );
 	iscsi->rx_state = ISCSI_RX_BHS;
 	iscsi->rx_offset = 0;
 
@@ -305,38 +324,138 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
 }
 
 /**
- * Mark iSCSI SCSI operation as complete
+ * Get reference to iSCSI task
+ *
+ * @v task		iSCSI task
+ * @ret task		iSCSI task
+ */
+static inline __attribute__ (( always_inline )) struct iscsi_task *
+iscsi_task_get ( struct iscsi_task *task ) {
+	ref_get ( &task->refcnt );
+	return task;
+}
+
+/**
+ * Drop reference to iSCSI task
+ *
+ * @v task		iSCSI task
+ */
+static inline __attribute__ (( always_inline )) void
+iscsi_task_put ( struct iscsi_task *task ) {
+	ref_put ( &task->refcnt );
+}
+
+/**
+ * Free iSCSI task
+ *
+ * @v refcnt		Reference counter
+ */
+static void iscsi_task_free ( struct refcnt *refcnt ) {
+	struct iscsi_task *task =
+		container_of ( refcnt, struct iscsi_task, refcnt );
+
+	assert ( list_empty ( &task->list ) );
+	ref_put ( &task->iscsi->refcnt );
+	free ( task );
+}
+
+/**
+ * Identify iSCSI task by initiator task tag
  *
  * @v iscsi		iSCSI session
+ * @v itt		Initiator task tag
+ * @ret task		iSCSI task, or NULL
+ */
+static struct iscsi_task * iscsi_find_task ( struct iscsi_session *iscsi,
+					     uint32_t itt ) {
+	struct iscsi_task *task;
+
+	list_for_each_entry ( task, &iscsi->tasks, list ) {
+		if ( task->itt == itt )
+			return task;
+	}
+	DBGC ( iscsi, "iSCSI %p received PDU for unknown ITT %08x\n",
+	       iscsi, itt );
+	return NULL;
+}
+
+/**
+ * Mark iSCSI task as complete
+ *
+ * @v task		iSCSI task
  * @v rc		Return status code
  * @v rsp		SCSI response, if any
  *
- * Note that iscsi_scsi_done() will not close the connection, and must
- * therefore be called only when the internal state machines are in an
- * appropriate state, otherwise bad things may happen on the next call
- * to iscsi_scsi_command().  The general rule is to call
- * iscsi_scsi_done() only at the end of receiving a PDU; at this point
- * the TX and RX engines should both be idle.
+ * Note that iscsi_task_done() will not close the connection.  Any
+ * data-out PDU for this task that is already in transit will be
+ * completed, but no further data-out PDUs will be started.
  */
-static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
+static void iscsi_task_done ( struct iscsi_task *task, int rc,
 			      struct scsi_rsp *rsp ) {
-	uint32_t itt = iscsi->itt;
+	struct iscsi_session *iscsi = task->iscsi;
 
-	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
+	/* Do nothing if task is already complete */
+	if ( list_empty ( &task->list ) )
+		return;
 
-	/* Clear command */
-	free ( iscsi->command );
-	iscsi->command = NULL;
+	/* Remove from list of tasks.  The list's reference is
+	 * transferred to this function.
+	 */
+	list_del ( &task->list );
+	INIT_LIST_HEAD ( &task->list );
+	iscsi->num_tasks--;
 
 	/* Send SCSI response, if any */
-	scsi_response ( &iscsi->data, rsp );
+	scsi_response ( &task->data, rsp );
 
-	/* Close SCSI command, if this is still the same command.  (It
-	 * is possible that the command interface has already been
-	 * closed as a result of the SCSI response we sent.)
-	 */
-	if ( iscsi->itt == itt )
-		intf_restart ( &iscsi->data, rc );
+	/* Close SCSI command */
+	intf_shutdown ( &task->data, rc );
+	iscsi_task_put ( task );
+
+	/* Notify SCSI layer of window change */
+	xfer_window_changed ( &iscsi->control );
+}
+
+/**
+ * Queue iSCSI data-out transfer
+ *
+ * @v task		iSCSI task
+ * @v ttt		Target transfer tag
+ * @v offset		Buffer offset
+ * @v len		Length
+ * @ret rc		Return status code
+ */
+static int iscsi_queue_data_out ( struct iscsi_task *task, uint32_t ttt,
+				  uint32_t offset, uint32_t len ) {
+	struct iscsi_session *iscsi = task->iscsi;
+	struct iscsi_transfer *transfer;
+
+	/* Sanity checks */
+	if ( ! task->command.data_out ) {
+		DBGC ( iscsi, "iSCSI %p ITT %08x has no data-out buffer\n",
+		       iscsi, task->itt );
+		return -EPROTO;
+	}
+	if ( ( offset + len ) > task->command.data_out_len ) {
+		DBGC ( iscsi, "iSCSI %p ITT %08x transfer [%#x,%#x) exceeds "
+		       "data-out length %#zx\n", iscsi, task->itt, offset,
+		       ( offset + len ), task->command.data_out_len );
+		return -EPROTO;
+	}
+	if ( task->num_transfers >= ( iscsi->max_r2t + 1 ) ) {
+		DBGC ( iscsi, "iSCSI %p ITT %08x has too many outstanding "
+		       "R2Ts\n", iscsi, task->itt );
+		return -EPROTO;
+	}
+
+	/* Record transfer and schedule transmission */
+	transfer = &task->transfer[ task->num_transfers++ ];
+	transfer->ttt = ttt;
+	transfer->offset = offset;
+	transfer->len = len;
+	iscsi_tx_schedule ( iscsi );
+
+	return 0;
 }
 
 /****************************************************************************
@@ -349,41 +468,121 @@ static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
  * Build iSCSI SCSI command BHS
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  *
  * We don't currently support bidirectional commands (i.e. with both
  * Data-In and Data-Out segments); these would require providing code
  * to generate an AHS, and there doesn't seem to be any need for it at
  * the moment.
+ *
+ * If the target has agreed to ImmediateData=Yes, then as much of the
+ * data-out buffer as permitted is sent as immediate data within the
+ * command PDU.
  */
-static void iscsi_start_command ( struct iscsi_session *iscsi ) {
+static void iscsi_start_command ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_scsi_command *command = &iscsi->tx_bhs.scsi_command;
-
-	assert ( ! ( iscsi->command->data_in && iscsi->command->data_out ) );
+	struct scsi_cmd *scsi = &task->command;
+	uint32_t first_burst_len;
+	uint32_t unsolicited_len = 0;
+
+	assert ( ! ( scsi->data_in && scsi->data_out ) );
+
+	/* Calculate length of unsolicited data, if any */
+	first_burst_len = iscsi->first_burst_len;
+	if ( first_burst_len > iscsi->max_burst_len )
+		first_burst_len = iscsi->max_burst_len;
+	if ( first_burst_len > scsi->data_out_len )
+		first_burst_len = scsi->data_out_len;
+	task->immediate_len = 0;
+	if ( iscsi->status & ISCSI_STATUS_IMMEDIATE_DATA ) {
+		task->immediate_len = first_burst_len;
+		if ( task->immediate_len > iscsi->max_send_len )
+			task->immediate_len = iscsi->max_send_len;
+		unsolicited_len = task->immediate_len;
+	}
+	if ( iscsi->status & ISCSI_STATUS_NO_INITIAL_R2T )
+		unsolicited_len = first_burst_len;
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	command->opcode = ISCSI_OPCODE_SCSI_COMMAND;
-	command->flags = ( ISCSI_FLAG_FINAL |
-			   ISCSI_COMMAND_ATTR_SIMPLE );
-	if ( iscsi->command->data_in )
+	command->flags = ISCSI_COMMAND_ATTR_SIMPLE;
+	if ( unsolicited_len == task->immediate_len )
+		command->flags |= ISCSI_FLAG_FINAL;
+	if ( scsi->data_in )
 		command->flags |= ISCSI_COMMAND_FLAG_READ;
-	if ( iscsi->command->data_out )
+	if ( scsi->data_out )
 		command->flags |= ISCSI_COMMAND_FLAG_WRITE;
-	/* lengths left as zero */
-	memcpy ( &command->lun, &iscsi->command->lun,
-		 sizeof ( command->lun ) );
-	command->itt = htonl ( iscsi->itt );
-	command->exp_len = htonl ( iscsi->command->data_in_len |
-				   iscsi->command->data_out_len );
-	command->cmdsn = htonl ( iscsi->cmdsn );
+	ISCSI_SET_LENGTHS ( command->lengths, 0, task->immediate_len );
+	memcpy ( &command->lun, &scsi->lun, sizeof ( command->lun ) );
+	command->itt = htonl ( task->itt );
+	command->exp_len = htonl ( scsi->data_in_len | scsi->data_out_len );
+	command->cmdsn = htonl ( task->cmdsn );
 	command->expstatsn = htonl ( iscsi->statsn + 1 );
-	memcpy ( &command->cdb, &iscsi->command->cdb, sizeof ( command->cdb ));
-	DBGC2 ( iscsi, "iSCSI %p start " SCSI_CDB_FORMAT " %s %#zx\n",
-		iscsi, SCSI_CDB_DATA ( command->cdb ),
-		( iscsi->command->data_in ? "in" : "out" ),
-		( iscsi->command->data_in ?
-		  iscsi->command->data_in_len :
-		  iscsi->command->data_out_len ) );
+	memcpy ( &command->cdb, &scsi->cdb, sizeof ( command->cdb ) );
+
+	/* Queue any unsolicited data-out PDUs, to be sent after the
+	 * command PDU.  This cannot fail, since the task can have no
+	 * other transfers at this point.
+	 */
+	if ( unsolicited_len > task->immediate_len ) {
+		iscsi_queue_data_out ( task, ISCSI_TAG_RESERVED,
+				       task->immediate_len,
+				       ( unsolicited_len -
+					 task->immediate_len ) );
+	}
+
+	DBGC2 ( iscsi, "iSCSI %p start ITT %08x " SCSI_CDB_FORMAT " %s %#zx"
+		" (immediate %#x)\n", iscsi, task->itt,
+		SCSI_CDB_DATA ( command->cdb ),
+		( scsi->data_in ? "in" : "out" ),
+		( scsi->data_in ? scsi->data_in_len : scsi->data_out_len ),
+		task->immediate_len );
+}
+
+/**
+ * Send iSCSI data-out data segment
+ *
+ * @v iscsi		iSCSI session
+ * @v offset		Buffer offset
+ * @v len		Length
+ * @ret rc		Return status code
+ *
+ * This is used for both data-out PDUs and immediate data within a
+ * SCSI command PDU.
+ */
+static int iscsi_tx_data_out_segment ( struct iscsi_session *iscsi,
+				       unsigned long offset, size_t len ) {
+	struct iscsi_task *task = iscsi->tx_task;
+	struct io_buffer *iobuf;
+
+	assert ( task != NULL );
+	assert ( task->command.data_out );
+	assert ( ( offset + len ) <= task->command.data_out_len );
+	assert ( len <= ISCSI_MAX_SEND_DATA_SEG_LEN );
+
+	iobuf = xfer_alloc_iob ( &iscsi->socket, len );
+	if ( ! iobuf )
+		return -ENOMEM;
+
+	copy_from_user ( iob_put ( iobuf, len ),
+			 task->command.data_out, offset, len );
+
+	return xfer_deliver_iob ( &iscsi->socket, iobuf );
+}
+
+/**
+ * Send iSCSI SCSI command immediate data
+ *
+ * @v iscsi		iSCSI session
+ * @ret rc		Return status code
+ */
+static int iscsi_tx_command ( struct iscsi_session *iscsi ) {
+	struct iscsi_bhs_scsi_command *command = &iscsi->tx_bhs.scsi_command;
+
+	return iscsi_tx_data_out_segment ( iscsi, 0,
+					   ISCSI_DATA_LEN ( command->lengths ) );
 }
 
 /**
@@ -400,6 +599,7 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 				    size_t remaining ) {
 	struct iscsi_bhs_scsi_response *response
 		= &iscsi->rx_bhs.scsi_response;
+	struct iscsi_task *task;
 	struct scsi_rsp rsp;
 	uint32_t residual_count;
 	int rc;
@@ -427,12 +627,17 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 			 sizeof ( rsp.sense ) );
 	iscsi_rx_buffered_data_done ( iscsi );
 
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( response->itt ) );
+	if ( ! task )
+		return -EPROTO;
+
 	/* Check for errors */
 	if ( response->response != ISCSI_RESPONSE_COMMAND_COMPLETE )
 		return -EIO;
 
 	/* Mark as completed */
-	iscsi_scsi_done ( iscsi, 0, &rsp );
+	iscsi_task_done ( task, 0, &rsp );
 	return 0;
 }
 
@@ -449,14 +654,19 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 			      const void *data, size_t len,
 			      size_t remaining ) {
 	struct iscsi_bhs_data_in *data_in = &iscsi->rx_bhs.data_in;
+	struct iscsi_task *task;
 	unsigned long offset;
 
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( data_in->itt ) );
+	if ( ! task )
+		return -EPROTO;
+
 	/* Copy data to data-in buffer */
 	offset = ntohl ( data_in->offset ) + iscsi->rx_offset;
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_in );
-	assert ( ( offset + len ) <= iscsi->command->data_in_len );
-	copy_to_user ( iscsi->command->data_in, offset, data, len );
+	assert ( task->command.data_in );
+	assert ( ( offset + len ) <= task->command.data_in_len );
+	copy_to_user ( task->command.data_in, offset, data, len );
 
 	/* Wait for whole SCSI response to arrive */
 	if ( remaining )
@@ -464,10 +674,10 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 
 	/* Mark as completed if status is present */
 	if ( data_in->flags & ISCSI_DATA_FLAG_STATUS ) {
-		assert ( ( offset + len ) == iscsi->command->data_in_len );
+		assert ( ( offset + len ) == task->command.data_in_len );
 		assert ( data_in->flags & ISCSI_FLAG_FINAL );
 		/* iSCSI cannot return an error status via a data-in */
-		iscsi_scsi_done ( iscsi, 0, NULL );
+		iscsi_task_done ( task, 0, NULL );
 	}
 
 	return 0;
@@ -486,69 +696,90 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
 			  const void *data __unused, size_t len __unused,
 			  size_t remaining __unused ) {
 	struct iscsi_bhs_r2t *r2t = &iscsi->rx_bhs.r2t;
+	struct iscsi_task *task;
 
-	/* Record transfer parameters and trigger first data-out */
-	iscsi->ttt = ntohl ( r2t->ttt );
-	iscsi->transfer_offset = ntohl ( r2t->offset );
-	iscsi->transfer_len = ntohl ( r2t->len );
-	iscsi_start_data_out ( iscsi, 0 );
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( r2t->itt ) );
+	if ( ! task )
+		return -EPROTO;
 
-	return 0;
+	/* Queue transfer */
+	return iscsi_queue_data_out ( task, ntohl ( r2t->ttt ),
+				      ntohl ( r2t->offset ),
+				      ntohl ( r2t->len ) );
 }
 
 /**
  * Build iSCSI data-out BHS
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  * @v datasn		Data sequence number within the transfer
  *
+ * This sends the next PDU of the task's first pending transfer.
  */
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
+				   struct iscsi_task *task,
 				   unsigned int datasn ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
+	struct iscsi_transfer *transfer = &task->transfer[0];
 	unsigned long offset;
 	unsigned long remaining;
 	unsigned long len;
 
-	/* We always send 512-byte Data-Out PDUs; this removes the
-	 * need to worry about the target's MaxRecvDataSegmentLength.
-	 */
-	offset = datasn * 512;
-	remaining = iscsi->transfer_len - offset;
+	assert ( task->num_transfers > 0 );
+
+	/* Send PDUs as large as permitted */
+	offset = datasn * iscsi->max_send_len;
+	remaining = transfer->len - offset;
 	len = remaining;
-	if ( len > 512 )
-		len = 512;
+	if ( len > iscsi->max_send_len )
+		len = iscsi->max_send_len;
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	data_out->opcode = ISCSI_OPCODE_DATA_OUT;
 	if ( len == remaining )
 		data_out->flags = ( ISCSI_FLAG_FINAL );
 	ISCSI_SET_LENGTHS ( data_out->lengths, 0, len );
-	data_out->lun = iscsi->command->lun;
-	data_out->itt = htonl ( iscsi->itt );
-	data_out->ttt = htonl ( iscsi->ttt );
+	data_out->lun = task->command.lun;
+	data_out->itt = htonl ( task->itt );
+	data_out->ttt = htonl ( transfer->ttt );
 	data_out->expstatsn = htonl ( iscsi->statsn + 1 );
 	data_out->datasn = htonl ( datasn );
-	data_out->offset = htonl ( iscsi->transfer_offset + offset );
-	DBGC ( iscsi, "iSCSI %p start data out DataSN %#x len %#lx\n",
-	       iscsi, datasn, len );
+	data_out->offset = htonl ( transfer->offset + offset );
+	DBGC ( iscsi, "iSCSI %p ITT %08x start data out DataSN %#x len "
+	       "%#lx\n", iscsi, task->itt, datasn, len );
 }
 
 /**
  * Complete iSCSI data-out PDU transmission
  *
  * @v iscsi		iSCSI session
- *
+ * @v task		iSCSI task
  */
-static void iscsi_data_out_done ( struct iscsi_session *iscsi ) {
+static void iscsi_data_out_done ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
 
+	/* Do nothing further if the task has already completed */
+	if ( list_empty ( &task->list ) )
+		return;
+
 	/* If we haven't reached the end of the sequence, start
 	 * sending the next data-out PDU.
 	 */
-	if ( ! ( data_out->flags & ISCSI_FLAG_FINAL ) )
-		iscsi_start_data_out ( iscsi, ntohl ( data_out->datasn ) + 1 );
+	if ( ! ( data_out->flags & ISCSI_FLAG_FINAL ) ) {
+		iscsi_start_data_out ( iscsi, task,
+				       ntohl ( data_out->datasn ) + 1 );
+		return;
+	}
+
+	/* Otherwise, remove the completed transfer */
+	assert ( task->num_transfers > 0 );
+	task->num_transfers--;
+	memmove ( &task->transfer[0], &task->transfer[1],
+		  ( task->num_transfers * sizeof ( task->transfer[0] ) ) );
 }
 
 /**
@@ -559,25 +790,9 @@ static void iscsi_data_out_done ( struct iscsi_session *iscsi ) {
  */
 static int iscsi_tx_data_out ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
-	struct io_buffer *iobuf;
-	unsigned long offset;
-	size_t len;
-
-	offset = ntohl ( data_out->offset );
-	len = ISCSI_DATA_LEN ( data_out->lengths );
 
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_out );
-	assert ( ( offset + len ) <= iscsi->command->data_out_len );
-
-	iobuf = xfer_alloc_iob ( &iscsi->socket, len );
-	if ( ! iobuf )
-		return -ENOMEM;
-	
-	copy_from_user ( iob_put ( iobuf, len ),
-			 iscsi->command->data_out, offset, len );
-
-	return xfer_deliver_iob ( &iscsi->socket, iobuf );
+	return iscsi_tx_data_out_segment ( iscsi, ntohl ( data_out->offset ),
+					   ISCSI_DATA_LEN ( data_out->lengths ) );
 }
 
 /**
@@ -606,6 +821,9 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
 		return -ENOTSUP_NOP_IN;
 	}
 
+	/* A NOP-In may have opened the target's command window */
+	xfer_window_changed ( &iscsi->control );
+
 	return 0;
 }
 
@@ -626,30 +844,31 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
  *     HeaderDigest=None
  *     DataDigest=None
  *     MaxConnections is irrelevant; we make only one connection anyway [4]
- *     InitialR2T=Yes [1]
- *     ImmediateData is irrelevant; we never send immediate data [4]
- *     MaxRecvDataSegmentLength=8192 (default; we don't care) [3]
- *     MaxBurstLength=262144 (default; we don't care) [3]
- *     FirstBurstLength=262144 (default; we don't care)
+ *     InitialR2T=No [1]
+ *     ImmediateData=Yes [1]
+ *     MaxRecvDataSegmentLength=262144 [3]
+ *     MaxBurstLength=1048576 [3]
+ *     FirstBurstLength=262144 [3]
  *     DefaultTime2Wait=0 [2]
  *     DefaultTime2Retain=0 [2]
- *     MaxOutstandingR2T=1
+ *     MaxOutstandingR2T=4 [1]
  *     DataPDUInOrder=Yes
  *     DataSequenceInOrder=Yes
  *     ErrorRecoveryLevel=0
  *
- * [1] InitialR2T has an OR resolution function, so the target may
- * force us to use it.  We therefore simplify our logic by always
- * using it.
+ * [1] These allow writes to proceed without waiting for an R2T, and
+ * large writes to proceed without waiting for each R2T in turn.
+ * The target may force more conservative values (InitialR2T has an
+ * OR resolution function, ImmediateData has an AND resolution
+ * function, and MaxOutstandingR2T has a minimum resolution
+ * function), so we use only the values returned by the target.
  *
  * [2] These ensure that we can safely start a new task once we have
  * reconnected after a failure, without having to manually tidy up
  * after the old one.
  *
- * [3] We are quite happy to use the RFC-defined default values for
- * these parameters, but some targets (notably OpenSolaris)
- * incorrectly assume a default value of zero, so we explicitly
- * specify the default values.
+ * [3] Some targets (notably OpenSolaris) incorrectly assume a default
+ * value of zero, so we must always specify these values explicitly.
  *
  * [4] We are quite happy to use the RFC-defined default values for
  * these parameters, but some targets (notably a QNAP TS-639Pro) fail
@@ -709,17 +928,22 @@ static int iscsi_build_login_request_strings ( struct iscsi_session *iscsi,
 				    "HeaderDigest=None%c"
 				    "DataDigest=None%c"
 				    "MaxConnections=1%c"
-				    "InitialR2T=Yes%c"
-				    "ImmediateData=No%c"
-				    "MaxRecvDataSegmentLength=8192%c"
-				    "MaxBurstLength=262144%c"
+				    "InitialR2T=No%c"
+				    "ImmediateData=Yes%c"
+				    "MaxRecvDataSegmentLength=%d%c"
+				    "MaxBurstLength=%d%c"
+				    "FirstBurstLength=%d%c"
 				    "DefaultTime2Wait=0%c"
 				    "DefaultTime2Retain=0%c"
-				    "MaxOutstandingR2T=1%c"
+				    "MaxOutstandingR2T=%d%c"
 				    "DataPDUInOrder=Yes%c"
 				    "DataSequenceInOrder=Yes%c"
 				    "ErrorRecoveryLevel=0%c",
-				    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 );
+				    0, 0, 0, 0, 0,
+				    ISCSI_MAX_RECV_DATA_SEG_LEN, 0,
+				    ISCSI_MAX_BURST_LEN, 0,
+				    ISCSI_FIRST_BURST_LEN, 0, 0, 0,
+				    ISCSI_MAX_R2T, 0, 0, 0, 0 );
 	}
 
 	return used;
@@ -748,7 +972,7 @@ static void iscsi_start_login ( struct iscsi_session *iscsi ) {
 	}
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, NULL );
 	request->opcode = ( ISCSI_OPCODE_LOGIN_REQUEST |
 			    ISCSI_FLAG_IMMEDIATE );
 	request->flags = ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) |
@@ -1079,6 +1303,145 @@ static int iscsi_handle_chap_r_value ( struct iscsi_session *iscsi,
 	return 0;
 }
 
+/**
+ * Parse iSCSI numerical text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		Text value
+ * @ret number		Numerical value, or zero if invalid
+ */
+static unsigned long iscsi_number_value ( struct iscsi_session *iscsi,
+					  const char *value ) {
+	unsigned long number;
+	char *end;
+
+	number = strtoul ( value, &end, 0 );
+	if ( *end || ( end == value ) ) {
+		DBGC ( iscsi, "iSCSI %p invalid numerical value \"%s\"\n",
+		       iscsi, value );
+		return 0;
+	}
+	return number;
+}
+
+/**
+ * Handle iSCSI MaxRecvDataSegmentLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		MaxRecvDataSegmentLength value
+ * @ret rc		Return status code
+ *
+ * This is a declarative value specifying the largest data segment
+ * that the target is prepared to receive.  We never send data
+ * segments larger than ISCSI_MAX_SEND_DATA_SEG_LEN, whatever the
+ * target declares.
+ */
+static int iscsi_handle_maxrecvdatasegmentlength_value ( struct iscsi_session
+							 *iscsi,
+							 const char *value ) {
+	unsigned long len = iscsi_number_value ( iscsi, value );
+
+	if ( ! len )
+		return -EPROTO;
+	iscsi->max_send_len = len;
+	if ( iscsi->max_send_len > ISCSI_MAX_SEND_DATA_SEG_LEN )
+		iscsi->max_send_len = ISCSI_MAX_SEND_DATA_SEG_LEN;
+	return 0;
+}
+
+/**
+ * Handle iSCSI MaxBurstLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		MaxBurstLength value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_maxburstlength_value ( struct iscsi_session *iscsi,
+					       const char *value ) {
+	unsigned long len = iscsi_number_value ( iscsi, value );
+
+	if ( ! len )
+		return -EPROTO;
+	iscsi->max_burst_len = len;
+	if ( iscsi->max_burst_len > ISCSI_MAX_BURST_LEN )
+		iscsi->max_burst_len = ISCSI_MAX_BURST_LEN;
+	return 0;
+}
+
+/**
+ * Handle iSCSI FirstBurstLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		FirstBurstLength value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_firstburstlength_value ( struct iscsi_session *iscsi,
+						 const char *value ) {
+	unsigned long len = iscsi_number_value ( iscsi, value );
+
+	if ( ! len )
+		return -EPROTO;
+	iscsi->first_burst_len = len;
+	if ( iscsi->first_burst_len > ISCSI_FIRST_BURST_LEN )
+		iscsi->first_burst_len = ISCSI_FIRST_BURST_LEN;
+	return 0;
+}
+
+/**
+ * Handle iSCSI MaxOutstandingR2T text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		MaxOutstandingR2T value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_maxoutstandingr2t_value ( struct iscsi_session *iscsi,
+						  const char *value ) {
+	unsigned long max_r2t = iscsi_number_value ( iscsi, value );
+
+	if ( ! max_r2t )
+		return -EPROTO;
+	iscsi->max_r2t = max_r2t;
+	if ( iscsi->max_r2t > ISCSI_MAX_R2T )
+		iscsi->max_r2t = ISCSI_MAX_R2T;
+	return 0;
+}
+
+/**
+ * Handle iSCSI InitialR2T text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		InitialR2T value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_initialr2t_value ( struct iscsi_session *iscsi,
+					   const char *value ) {
+
+	if ( strcmp ( value, "No" ) == 0 ) {
+		iscsi->status |= ISCSI_STATUS_NO_INITIAL_R2T;
+	} else {
+		iscsi->status &= ~ISCSI_STATUS_NO_INITIAL_R2T;
+	}
+	return 0;
+}
+
+/**
+ * Handle iSCSI ImmediateData text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		ImmediateData value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_immediatedata_value ( struct iscsi_session *iscsi,
+					      const char *value ) {
+
+	if ( strcmp ( value, "Yes" ) == 0 ) {
+		iscsi->status |= ISCSI_STATUS_IMMEDIATE_DATA;
+	} else {
+		iscsi->status &= ~ISCSI_STATUS_IMMEDIATE_DATA;
+	}
+	return 0;
+}
+
 /** An iSCSI text string that we want to handle */
 struct iscsi_string_type {
 	/** String key
@@ -1105,6 +1468,13 @@ static struct iscsi_string_type iscsi_string_types[] = {
 	{ "CHAP_C=", iscsi_handle_chap_c_value },
 	{ "CHAP_N=", iscsi_handle_chap_n_value },
 	{ "CHAP_R=", iscsi_handle_chap_r_value },
+	{ "MaxRecvDataSegmentLength=",
+	  iscsi_handle_maxrecvdatasegmentlength_value },
+	{ "MaxBurstLength=", iscsi_handle_maxburstlength_value },
+	{ "FirstBurstLength=", iscsi_handle_firstburstlength_value },
+	{ "MaxOutstandingR2T=", iscsi_handle_maxoutstandingr2t_value },
+	{ "InitialR2T=", iscsi_handle_initialr2t_value },
+	{ "ImmediateData=", iscsi_handle_immediatedata_value },
 	{ NULL, NULL }
 };
 
@@ -1293,6 +1663,15 @@ static int iscsi_rx_login_response ( struct iscsi_session *iscsi,
 
 	/* Notify SCSI layer of window change */
 	DBGC ( iscsi, "iSCSI %p entering full feature phase\n", iscsi );
+	DBGC ( iscsi, "iSCSI %p using MaxRecvDataSegmentLength=%d "
+	       "FirstBurstLength=%d MaxBurstLength=%d MaxOutstandingR2T=%d "
+	       "InitialR2T=%s ImmediateData=%s\n", iscsi,
+	       iscsi->max_send_len, iscsi->first_burst_len,
+	       iscsi->max_burst_len, iscsi->max_r2t,
+	       ( ( iscsi->status & ISCSI_STATUS_NO_INITIAL_R2T ) ?
+		 "No" : "Yes" ),
+	       ( ( iscsi->status & ISCSI_STATUS_IMMEDIATE_DATA ) ?
+		 "Yes" : "No" ) );
 	xfer_window_changed ( &iscsi->control );
 
 	return 0;
@@ -1326,17 +1705,24 @@ static void iscsi_tx_resume ( struct iscsi_session *iscsi ) {
  * Start up a new TX PDU
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task owning the PDU, or NULL
  *
  * This initiates the process of sending a new PDU.  Only one PDU may
  * be in transit at any one time.
  */
-static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task ) {
 
 	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
+	assert ( iscsi->tx_task == NULL );
 
 	/* Initialise TX BHS */
 	memset ( &iscsi->tx_bhs, 0, sizeof ( iscsi->tx_bhs ) );
 
+	/* Record owning task, if any */
+	if ( task )
+		iscsi->tx_task = iscsi_task_get ( task );
+
 	/* Flag TX engine to start transmitting */
 	iscsi->tx_state = ISCSI_TX_BHS;
 
@@ -1344,6 +1730,58 @@ static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
 	iscsi_tx_resume ( iscsi );
 }
 
+/**
+ * Abort any TX PDU in progress
+ *
+ * @v iscsi		iSCSI session
+ */
+static void iscsi_tx_abort ( struct iscsi_session *iscsi ) {
+
+	/* Reset TX state machine */
+	iscsi->tx_state = ISCSI_TX_IDLE;
+
+	/* Release owning task, if any */
+	if ( iscsi->tx_task ) {
+		iscsi_task_put ( iscsi->tx_task );
+		iscsi->tx_task = NULL;
+	}
+}
+
+/**
+ * Schedule next TX PDU
+ *
+ * @v iscsi		iSCSI session
+ *
+ * If the TX engine is idle, start sending the next pending command
+ * PDU or, failing that, the next pending data-out PDU.  Commands are
+ * sent in the order in which they were issued, to preserve CmdSN
+ * ordering.
+ */
+static void iscsi_tx_schedule ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+
+	/* Do nothing unless TX engine is idle */
+	if ( iscsi->tx_state != ISCSI_TX_IDLE )
+		return;
+
+	/* Send next pending command PDU, if any */
+	list_for_each_entry ( task, &iscsi->tasks, list ) {
+		if ( task->tx_pending ) {
+			task->tx_pending = 0;
+			iscsi_start_command ( iscsi, task );
+			return;
+		}
+	}
+
+	/* Send next pending data-out PDU, if any */
+	list_for_each_entry ( task, &iscsi->tasks, list ) {
+		if ( task->num_transfers ) {
+			iscsi_start_data_out ( iscsi, task, 0 );
+			return;
+		}
+	}
+}
+
 /**
  * Transmit nothing
  *
@@ -1378,6 +1816,8 @@ static int iscsi_tx_data ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
 
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
+	case ISCSI_OPCODE_SCSI_COMMAND:
+		return iscsi_tx_command ( iscsi );
 	case ISCSI_OPCODE_DATA_OUT:
 		return iscsi_tx_data_out ( iscsi );
 	case ISCSI_OPCODE_LOGIN_REQUEST:
@@ -1420,19 +1860,32 @@ static int iscsi_tx_data_padding ( struct iscsi_session *iscsi ) {
  */
 static void iscsi_tx_done ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
+	struct iscsi_task *task = iscsi->tx_task;
 
 	/* Stop transmission process */
 	iscsi_tx_pause ( iscsi );
 
+	/* Release owning task.  (We retain our own reference until
+	 * we have finished with it.)
+	 */
+	iscsi->tx_task = NULL;
+
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
 	case ISCSI_OPCODE_DATA_OUT:
-		iscsi_data_out_done ( iscsi );
+		iscsi_data_out_done ( iscsi, task );
+		break;
 	case ISCSI_OPCODE_LOGIN_REQUEST:
 		iscsi_login_request_done ( iscsi );
+		break;
 	default:
 		/* No action */
 		break;
 	}
+	if ( task )
+		iscsi_task_put ( task );
+
+	/* Start next PDU, if any */
+	iscsi_tx_schedule ( iscsi );
 }
 
 /**
@@ -1574,9 +2027,26 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
 	struct iscsi_bhs_common_response *response
 		= &iscsi->rx_bhs.common_response;
 
-	/* Update cmdsn and statsn */
-	iscsi->cmdsn = ntohl ( response->expcmdsn );
-	iscsi->statsn = ntohl ( response->statsn );
+	/* Update sequence numbers.  Commands are numbered from the
+	 * ExpCmdSN returned at login; thereafter we track only the
+	 * target's command window.  The StatSN field is valid only
+	 * for PDUs that carry status.
+	 */
+	if ( ( response->opcode & ISCSI_OPCODE_MASK ) ==
+	     ISCSI_OPCODE_LOGIN_RESPONSE ) {
+		iscsi->cmdsn = ntohl ( response->expcmdsn );
+		iscsi->maxcmdsn = ntohl ( response->maxcmdsn );
+	} else if ( ( ( int32_t ) ( ntohl ( response->maxcmdsn ) -
+				    iscsi->maxcmdsn ) ) > 0 ) {
+		iscsi->maxcmdsn = ntohl ( response->maxcmdsn );
+	}
+	if ( ! ( ( ( response->opcode & ISCSI_OPCODE_MASK ) ==
+		   ISCSI_OPCODE_R2T ) ||
+		 ( ( ( response->opcode & ISCSI_OPCODE_MASK ) ==
+		     ISCSI_OPCODE_DATA_IN ) &&
+		   ! ( response->flags & ISCSI_DATA_FLAG_STATUS ) ) ) ) {
+		iscsi->statsn = ntohl ( response->statsn );
+	}
 
 	switch ( response->opcode & ISCSI_OPCODE_MASK ) {
 	case ISCSI_OPCODE_LOGIN_RESPONSE:
@@ -1738,22 +2208,67 @@ static struct interface_descriptor iscsi_socket_desc =
  *
  */
 
+/**
+ * Close iSCSI command
+ *
+ * @v task		iSCSI task
+ * @v rc		Reason for close
+ */
+static void iscsi_command_close ( struct iscsi_task *task, int rc ) {
+
+	/* Restart interface */
+	intf_restart ( &task->data, rc );
+
+	/* Treat unsolicited command closures mid-command as fatal,
+	 * because we have no code to abort an individual task.
+	 */
+	if ( ! list_empty ( &task->list ) ) {
+		iscsi_close ( task->iscsi,
+			      ( ( rc == 0 ) ? -ECANCELED : rc ) );
+	}
+}
+
+/** iSCSI SCSI command interface operations */
+static struct interface_operation iscsi_data_op[] = {
+	INTF_OP ( intf_close, struct iscsi_task *, iscsi_command_close ),
+};
+
+/** iSCSI SCSI command interface descriptor */
+static struct interface_descriptor iscsi_data_desc =
+	INTF_DESC ( struct iscsi_task, data, iscsi_data_op );
+
 /**
  * Check iSCSI flow-control window
  *
  * @v iscsi		iSCSI session
  * @ret len		Length of window
+ *
+ * The window is the number of further commands that may be issued,
+ * limited both by the number of concurrent tasks we support and by
+ * the target's command window (MaxCmdSN).
  */
 static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
+	int32_t cmd_window;
+	size_t window;
 
-	if ( ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) ==
-	       ISCSI_STATUS_FULL_FEATURE_PHASE ) &&
-	     ( iscsi->command == NULL ) ) {
-		/* We cannot handle concurrent commands */
-		return 1;
-	} else {
+	/* No commands may be issued until login is complete */
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
 		return 0;
-	}
+
+	/* Limit to number of concurrent tasks supported */
+	if ( iscsi->num_tasks >= ISCSI_MAX_TASKS )
+		return 0;
+	window = ( ISCSI_MAX_TASKS - iscsi->num_tasks );
+
+	/* Limit to target's command window */
+	cmd_window = ( iscsi->maxcmdsn - iscsi->cmdsn + 1 );
+	if ( cmd_window <= 0 )
+		return 0;
+	if ( window > ( size_t ) cmd_window )
+		window = cmd_window;
+
+	return window;
 }
 
 /**
@@ -1767,31 +2282,41 @@ static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
 static int iscsi_scsi_command ( struct iscsi_session *iscsi,
 				struct interface *parent,
 				struct scsi_cmd *command ) {
+	struct iscsi_task *task;
 
-	/* This iSCSI implementation cannot handle multiple concurrent
-	 * commands or commands arriving before login is complete.
+	/* This iSCSI implementation cannot handle commands beyond the
+	 * flow-control window, or commands arriving before login is
+	 * complete.
 	 */
 	if ( iscsi_scsi_window ( iscsi ) == 0 ) {
-		DBGC ( iscsi, "iSCSI %p cannot handle concurrent commands\n",
-		       iscsi );
+		DBGC ( iscsi, "iSCSI %p cannot handle further concurrent "
+		       "commands\n", iscsi );
 		return -EOPNOTSUPP;
 	}
 
-	/* Store command */
-	iscsi->command = malloc ( sizeof ( *command ) );
-	if ( ! iscsi->command )
+	/* Allocate and initialise task */
+	task = zalloc ( sizeof ( *task ) );
+	if ( ! task )
 		return -ENOMEM;
-	memcpy ( iscsi->command, command, sizeof ( *command ) );
-
-	/* Assign new ITT */
-	iscsi_new_itt ( iscsi );
-
-	/* Start sending command */
-	iscsi_start_command ( iscsi );
+	ref_init ( &task->refcnt, iscsi_task_free );
+	intf_init ( &task->data, &iscsi_data_desc, &task->refcnt );
+	ref_get ( &iscsi->refcnt );
+	task->iscsi = iscsi;
+	memcpy ( &task->command, command, sizeof ( task->command ) );
+	task->itt = iscsi_new_itt();
+	task->cmdsn = iscsi->cmdsn++;
+	task->tx_pending = 1;
+
+	/* Add to list of tasks (which takes ownership of our
+	 * reference) and schedule transmission.
+	 */
+	list_add_tail ( &task->list, &iscsi->tasks );
+	iscsi->num_tasks++;
+	iscsi_tx_schedule ( iscsi );
 
 	/* Attach to parent interface and return */
-	intf_plug_plug ( &iscsi->data, parent );
-	return iscsi->itt;
+	intf_plug_plug ( &task->data, parent );
+	return task->itt;
 }
 
 /** iSCSI SCSI command-issuing interface operations */
@@ -1806,32 +2331,6 @@ static struct interface_operation iscsi_control_op[] = {
 static struct interface_descriptor iscsi_control_desc =
 	INTF_DESC ( struct iscsi_session, control, iscsi_control_op );
 
-/**
- * Close iSCSI command
- *
- * @v iscsi		iSCSI session
- * @v rc		Reason for close
- */
-static void iscsi_command_close ( struct iscsi_session *iscsi, int rc ) {
-
-	/* Restart interface */
-	intf_restart ( &iscsi->data, rc );
-
-	/* Treat unsolicited command closures mid-command as fatal,
-	 * because we have no code to handle partially-completed PDUs.
-	 */
-	if ( iscsi->command != NULL )
-		iscsi_close ( iscsi, ( ( rc == 0 ) ? -ECANCELED : rc ) );
-}
-
-/** iSCSI SCSI command interface operations */
-static struct interface_operation iscsi_data_op[] = {
-	INTF_OP ( intf_close, struct iscsi_session *, iscsi_command_close ),
-};
-
-/** iSCSI SCSI command interface descriptor */
-static struct interface_descriptor iscsi_data_desc =
-	INTF_DESC ( struct iscsi_session, data, iscsi_data_op );
 
 /****************************************************************************
  *
@@ -2062,8 +2561,8 @@ static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	}
 	ref_init ( &iscsi->refcnt, iscsi_free );
 	intf_init ( &iscsi->control, &iscsi_control_desc, &iscsi->refcnt );
-	intf_init ( &iscsi->data, &iscsi_data_desc, &iscsi->refcnt );
 	intf_init ( &iscsi->socket, &iscsi_socket_desc, &iscsi->refcnt );
+	INIT_LIST_HEAD ( &iscsi->tasks );
 	process_init_stopped ( &iscsi->process, &iscsi_process_desc,
 			       &iscsi->refcnt );
 
@@ -96,28 +96,80 @@ int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip_protocol,
  * byte-swap either the input partial checksum, the output checksum,
  * or both.  Deciding which to swap is left as an exercise for the
  * interested reader.
+ *
+ * The data buffer itself may have any alignment.  The sum is
+ * accumulated a dword at a time into a 64-bit accumulator, with all
+ * carries being folded back in only once the whole buffer has been
+ * summed, as described in RFC 1071.  If the buffer starts at an odd
+ * address, we sum byte-swapped words and swap the result back at the
+ * end.
  */
-uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
-				 size_t len ) {
-	unsigned int cksum = ( ( ~partial ) & 0xffff );
-	unsigned int value;
-	unsigned int i;
-	
-	for ( i = 0 ; i < len ; i++ ) {
-		value = * ( ( uint8_t * ) data + i );
-		if ( i & 1 ) {
-			/* Odd bytes: swap on little-endian systems */
-			value = be16_to_cpu ( value );
-		} else {
-			/* Even bytes: swap on big-endian systems */
-			value = le16_to_cpu ( value );
-		}
-		cksum += value;
-		if ( cksum > 0xffff )
-			cksum -= 0xffff;
+uint16_t generic_tcpip_continue_chksum ( uint16_t partial, const void *data,
+					 size_t len ) {
+	const uint8_t *bytes = data;
+	const uint32_t *dwords;
+	uint64_t sum = ( ( ~partial ) & 0xffff );
+	union {
+		uint8_t bytes[2];
+		uint16_t word;
+	} pair;
+	int odd = 0;
+
+	/* If data starts on an odd address, sum the first byte as
+	 * the second half of a (byte-swapped) word, and swap the
+	 * partial checksum to match.
+	 */
+	if ( ( ( ( intptr_t ) bytes ) & 1 ) && len ) {
+		odd = 1;
+		sum = bswap_16 ( sum );
+		pair.bytes[0] = 0;
+		pair.bytes[1] = *(bytes++);
+		sum += pair.word;
+		len--;
 	}
-	
-	return ( ~cksum );
+
+	/* Sum one word, if needed to reach dword alignment */
+	if ( ( ( ( intptr_t ) bytes ) & 2 ) && ( len >= 2 ) ) {
+		sum += *( ( const uint16_t * ) bytes );
+		bytes += 2;
+		len -= 2;
+	}
+
+	/* Sum whole dwords, four at a time where possible */
+	dwords = ( ( const uint32_t * ) bytes );
+	for ( ; len >= 16 ; len -= 16, dwords += 4 ) {
+		sum += dwords[0];
+		sum += dwords[1];
+		sum += dwords[2];
+		sum += dwords[3];
+	}
+	for ( ; len >= 4 ; len -= 4 )
+		sum += *(dwords++);
+	bytes = ( ( const uint8_t * ) dwords );
+
+	/* Sum any trailing word and byte */
+	if ( len >= 2 ) {
+		sum += *( ( const uint16_t * ) bytes );
+		bytes += 2;
+		len -= 2;
+	}
+	if ( len ) {
+		pair.bytes[0] = *bytes;
+		pair.bytes[1] = 0;
+		sum += pair.word;
+	}
+
+	/* Fold carries back into a 16-bit sum */
+	sum = ( ( sum & 0xffffffffUL ) + ( sum >> 32 ) );
+	sum = ( ( sum & 0xffffffffUL ) + ( sum >> 32 ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+
+	/* Undo byte swap if data started on an odd address */
+	if ( odd )
+		sum = bswap_16 ( sum );
+
+	return ( ~sum );
 }
 
 /**
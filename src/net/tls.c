@@ -30,9 +30,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <string.h>
 #include <errno.h>
 #include <byteswap.h>
+#include <ipxe/list.h>
 #include <ipxe/hmac.h>
 #include <ipxe/md5.h>
 #include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
 #include <ipxe/aes.h>
 #include <ipxe/rsa.h>
 #include <ipxe/iobuf.h>
@@ -41,12 +43,21 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/asn1.h>
 #include <ipxe/x509.h>
 #include <ipxe/tls.h>
+#include <ipxe/profile.h>
 
 static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 				const void *data, size_t len );
 static void tls_clear_cipher ( struct tls_session *tls,
 			       struct tls_cipherspec *cipherspec );
 
+/** Record encryption profiler */
+static struct profiler tls_encrypt_profiler __profiler =
+	{ .name = "tls.encrypt" };
+
+/** Record decryption profiler */
+static struct profiler tls_decrypt_profiler __profiler =
+	{ .name = "tls.decrypt" };
+
 /******************************************************************************
  *
  * Utility functions
@@ -67,6 +78,156 @@ static unsigned long tls_uint24 ( uint8_t field24[3] ) {
 	return ( ( field24[0] << 16 ) + ( field24[1] << 8 ) + field24[2] );
 }
 
+/******************************************************************************
+ *
+ * Session cache
+ *
+ ******************************************************************************
+ */
+
+/** A cached TLS session */
+struct tls_cached_session {
+	/** List of cached sessions */
+	struct list_head list;
+	/** Session ID */
+	uint8_t id[TLS_MAX_SESSION_ID_LEN];
+	/** Length of session ID */
+	size_t id_len;
+	/** Cipher suite (in network byte order) */
+	uint16_t cipher_suite;
+	/** Master secret */
+	uint8_t master_secret[48];
+	/** Server name */
+	char name[0];
+};
+
+/** List of cached TLS sessions, most recently used first */
+static LIST_HEAD ( tls_cached_sessions );
+
+/** Number of cached TLS sessions */
+static unsigned int tls_num_cached_sessions;
+
+/**
+ * Find cached TLS session
+ *
+ * @v name		Server name
+ * @ret cached		Cached session, or NULL
+ */
+static struct tls_cached_session * tls_find_cached ( const char *name ) {
+	struct tls_cached_session *cached;
+
+	list_for_each_entry ( cached, &tls_cached_sessions, list ) {
+		if ( strcmp ( cached->name, name ) == 0 )
+			return cached;
+	}
+	return NULL;
+}
+
+/**
+ * Discard cached TLS session
+ *
+ * @v cached		Cached session
+ */
+static void tls_discard_cached ( struct tls_cached_session *cached ) {
+
+	list_del ( &cached->list );
+	tls_num_cached_sessions--;
+	memset ( cached->master_secret, 0, sizeof ( cached->master_secret ) );
+	free ( cached );
+}
+
+/**
+ * Load cached TLS session, if any
+ *
+ * @v tls		TLS session
+ *
+ * If a session for this server is cached, its session ID, cipher
+ * suite and master secret are copied into the TLS session, ready to
+ * be offered in the Client Hello.
+ */
+static void tls_load_cached ( struct tls_session *tls ) {
+	struct tls_cached_session *cached;
+
+	/* Find cached session, if any */
+	tls->session_id_len = 0;
+	if ( ! tls->name )
+		return;
+	cached = tls_find_cached ( tls->name );
+	if ( ! cached )
+		return;
+
+	/* Copy out session parameters */
+	memcpy ( tls->session_id, cached->id, cached->id_len );
+	tls->session_id_len = cached->id_len;
+	tls->cipher_suite = cached->cipher_suite;
+	memcpy ( tls->master_secret, cached->master_secret,
+		 sizeof ( tls->master_secret ) );
+	DBGC ( tls, "TLS %p offering cached session for %s\n",
+	       tls, tls->name );
+}
+
+/**
+ * Store TLS session in cache
+ *
+ * @v tls		TLS session
+ *
+ * Any existing cached session for this server is replaced.  The
+ * least recently used session is evicted if the cache is full.
+ */
+static void tls_store_cached ( struct tls_session *tls ) {
+	struct tls_cached_session *cached;
+
+	/* Do nothing unless the server issued a session ID */
+	if ( ! ( tls->name && tls->session_id_len ) )
+		return;
+
+	/* Reuse existing entry for this server, if any */
+	cached = tls_find_cached ( tls->name );
+	if ( cached ) {
+		list_del ( &cached->list );
+	} else {
+		/* Evict least recently used session if cache is full */
+		if ( tls_num_cached_sessions >= TLS_MAX_CACHED_SESSIONS ) {
+			cached = list_entry ( tls_cached_sessions.prev,
+					      struct tls_cached_session, list );
+			tls_discard_cached ( cached );
+		}
+		cached = zalloc ( sizeof ( *cached ) +
+				  strlen ( tls->name ) + 1 /* NUL */ );
+		if ( ! cached )
+			return;
+		strcpy ( cached->name, tls->name );
+		tls_num_cached_sessions++;
+	}
+
+	/* Record session parameters */
+	memcpy ( cached->id, tls->session_id, tls->session_id_len );
+	cached->id_len = tls->session_id_len;
+	cached->cipher_suite = tls->cipher_suite;
+	memcpy ( cached->master_secret, tls->master_secret,
+		 sizeof ( cached->master_secret ) );
+	list_add ( &cached->list, &tls_cached_sessions );
+	DBGC ( tls, "TLS %p cached session for %s\n", tls, tls->name );
+}
+
+/**
+ * Forget cached TLS session
+ *
+ * @v tls		TLS session
+ */
+static void tls_forget_cached ( struct tls_session *tls ) {
+	struct tls_cached_session *cached;
+
+	if ( ! tls->name )
+		return;
+	cached = tls_find_cached ( tls->name );
+	if ( ! cached )
+		return;
+	DBGC ( tls, "TLS %p discarding cached session for %s\n",
+	       tls, tls->name );
+	tls_discard_cached ( cached );
+}
+
 /******************************************************************************
  *
  * Cleanup functions
@@ -90,6 +251,7 @@ static void free_tls ( struct refcnt *refcnt ) {
 	tls_clear_cipher ( tls, &tls->rx_cipherspec_pending );
 	x509_free_rsa_public_key ( &tls->rsa );
 	free ( tls->rx_data );
+	free ( tls->name );
 
 	/* Free TLS structure itself */
 	free ( tls );	
@@ -103,6 +265,10 @@ static void free_tls ( struct refcnt *refcnt ) {
  */
 static void tls_close ( struct tls_session *tls, int rc ) {
 
+	/* Do not offer a session that failed to complete a handshake */
+	if ( ( rc != 0 ) && ( tls->tx_state != TLS_TX_DATA ) )
+		tls_forget_cached ( tls );
+
 	/* Remove process */
 	process_del ( &tls->process );
 	
@@ -239,6 +405,13 @@ static void tls_prf ( struct tls_session *tls, void *secret, size_t secret_len,
 
 	va_start ( seeds, out_len );
 
+	/* TLSv1.2 uses P_SHA256 over the whole secret */
+	if ( tls->version >= TLS_VERSION_TLS_1_2 ) {
+		tls_p_hash_va ( tls, &sha256_algorithm, secret, secret_len,
+				out, out_len, seeds );
+		goto done;
+	}
+
 	/* Split secret into two, with an overlap of up to one byte */
 	subsecret_len = ( ( secret_len + 1 ) / 2 );
 	md5_secret = secret;
@@ -261,6 +434,7 @@ static void tls_prf ( struct tls_session *tls, void *secret, size_t secret_len,
 		*( ( uint8_t * ) out + i ) = ( out_md5[i] ^ out_sha1[i] );
 	}
 
+ done:
 	va_end ( seeds );
 }
 
@@ -313,6 +487,45 @@ static void tls_generate_master_secret ( struct tls_session *tls ) {
 	DBGC_HD ( tls, &tls->master_secret, sizeof ( tls->master_secret ) );
 }
 
+/**
+ * Calculate length of initialisation vector within key block
+ *
+ * @v tls		TLS session
+ * @v cipherspec	Cipher specification
+ * @ret iv_len		Length of initialisation vector
+ *
+ * Authenticated ciphers take only the implicit part of the nonce
+ * from the key block.  From TLSv1.1 onwards, block ciphers use an
+ * explicit IV in each record instead.
+ */
+static size_t tls_iv_len ( struct tls_session *tls,
+			   struct tls_cipherspec *cipherspec ) {
+
+	if ( is_auth_cipher ( cipherspec->cipher ) )
+		return sizeof ( cipherspec->fixed_iv );
+	if ( tls->version >= TLS_VERSION_TLS_1_1 )
+		return 0;
+	return cipherspec->cipher->blocksize;
+}
+
+/**
+ * Set initialisation vector from key block
+ *
+ * @v cipherspec	Cipher specification
+ * @v iv		Initialisation vector
+ * @v iv_size		Length of initialisation vector
+ */
+static void tls_set_iv ( struct tls_cipherspec *cipherspec,
+			 const void *iv, size_t iv_size ) {
+
+	if ( is_auth_cipher ( cipherspec->cipher ) ) {
+		assert ( iv_size == sizeof ( cipherspec->fixed_iv ) );
+		memcpy ( cipherspec->fixed_iv, iv, iv_size );
+	} else if ( iv_size ) {
+		cipher_setiv ( cipherspec->cipher, cipherspec->cipher_ctx, iv );
+	}
+}
+
 /**
  * Generate key material
  *
@@ -325,7 +538,7 @@ static int tls_generate_keys ( struct tls_session *tls ) {
 	struct tls_cipherspec *rx_cipherspec = &tls->rx_cipherspec_pending;
 	size_t hash_size = tx_cipherspec->digest->digestsize;
 	size_t key_size = tx_cipherspec->key_len;
-	size_t iv_size = tx_cipherspec->cipher->blocksize;
+	size_t iv_size = tls_iv_len ( tls, tx_cipherspec );
 	size_t total = ( 2 * ( hash_size + key_size + iv_size ) );
 	uint8_t key_block[total];
 	uint8_t *key;
@@ -377,13 +590,13 @@ static int tls_generate_keys ( struct tls_session *tls ) {
 	key += key_size;
 
 	/* TX initialisation vector */
-	cipher_setiv ( tx_cipherspec->cipher, tx_cipherspec->cipher_ctx, key );
+	tls_set_iv ( tx_cipherspec, key, iv_size );
 	DBGC ( tls, "TLS %p TX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
 
 	/* RX initialisation vector */
-	cipher_setiv ( rx_cipherspec->cipher, rx_cipherspec->cipher_ctx, key );
+	tls_set_iv ( rx_cipherspec, key, iv_size );
 	DBGC ( tls, "TLS %p RX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
@@ -490,12 +703,24 @@ static int tls_select_cipher ( struct tls_session *tls,
 		cipher = &aes_cbc_algorithm;
 		digest = &sha1_algorithm;
 		break;
+	case htons ( TLS_RSA_WITH_AES_128_GCM_SHA256 ):
+		key_len = ( 128 / 8 );
+		cipher = &aes_gcm_algorithm;
+		break;
 	default:
 		DBGC ( tls, "TLS %p does not support cipher %04x\n",
 		       tls, ntohs ( cipher_suite ) );
 		return -ENOTSUP;
 	}
 
+	/* Authenticated ciphers are defined only for TLSv1.2 */
+	if ( is_auth_cipher ( cipher ) &&
+	     ( tls->version < TLS_VERSION_TLS_1_2 ) ) {
+		DBGC ( tls, "TLS %p cannot use cipher %04x with version "
+		       "%04x\n", tls, ntohs ( cipher_suite ), tls->version );
+		return -ENOTSUP;
+	}
+
 	/* Set ciphers */
 	if ( ( rc = tls_set_cipher ( tls, &tls->tx_cipherspec_pending, pubkey,
 				     cipher, digest, key_len ) ) != 0 )
@@ -526,7 +751,8 @@ static int tls_change_cipher ( struct tls_session *tls,
 	if ( /* FIXME (when pubkey is not hard-coded to RSA):
 	      * ( pending->pubkey == &pubkey_null ) || */
 	     ( pending->cipher == &cipher_null ) ||
-	     ( pending->digest == &digest_null ) ) {
+	     ( ( pending->digest == &digest_null ) &&
+	       ! is_auth_cipher ( pending->cipher ) ) ) {
 		DBGC ( tls, "TLS %p refusing to use null cipher\n", tls );
 		return -ENOTSUP;
 	}
@@ -555,6 +781,8 @@ static void tls_add_handshake ( struct tls_session *tls,
 
 	digest_update ( &md5_algorithm, tls->handshake_md5_ctx, data, len );
 	digest_update ( &sha1_algorithm, tls->handshake_sha1_ctx, data, len );
+	digest_update ( &sha256_algorithm, tls->handshake_sha256_ctx,
+			data, len );
 }
 
 /**
@@ -562,22 +790,34 @@ static void tls_add_handshake ( struct tls_session *tls,
  *
  * @v tls		TLS session
  * @v out		Output buffer
+ * @ret len		Length of verification hash
  *
- * Calculates the MD5+SHA1 digest over all handshake messages seen so
- * far.
+ * Calculates the MD5+SHA1 digest (or, for TLSv1.2, the SHA-256
+ * digest) over all handshake messages seen so far.  The output
+ * buffer must have room for TLS_MAX_VERIFY_HANDSHAKE_LEN bytes.
  */
-static void tls_verify_handshake ( struct tls_session *tls, void *out ) {
+static size_t tls_verify_handshake ( struct tls_session *tls, void *out ) {
 	struct digest_algorithm *md5 = &md5_algorithm;
 	struct digest_algorithm *sha1 = &sha1_algorithm;
+	struct digest_algorithm *sha256 = &sha256_algorithm;
 	uint8_t md5_ctx[md5->ctxsize];
 	uint8_t sha1_ctx[sha1->ctxsize];
+	uint8_t sha256_ctx[sha256->ctxsize];
 	void *md5_digest = out;
 	void *sha1_digest = ( out + md5->digestsize );
 
+	if ( tls->version >= TLS_VERSION_TLS_1_2 ) {
+		memcpy ( sha256_ctx, tls->handshake_sha256_ctx,
+			 sizeof ( sha256_ctx ) );
+		digest_final ( sha256, sha256_ctx, out );
+		return sha256->digestsize;
+	}
+
 	memcpy ( md5_ctx, tls->handshake_md5_ctx, sizeof ( md5_ctx ) );
 	memcpy ( sha1_ctx, tls->handshake_sha1_ctx, sizeof ( sha1_ctx ) );
 	digest_final ( md5, md5_ctx, md5_digest );
 	digest_final ( sha1, sha1_ctx, sha1_digest );
+	return ( md5->digestsize + sha1->digestsize );
 }
 
 /******************************************************************************
@@ -673,8 +913,9 @@ static int tls_send_client_hello ( struct tls_session *tls ) {
 		uint16_t version;
 		uint8_t random[32];
 		uint8_t session_id_len;
+		uint8_t session_id[tls->session_id_len];
 		uint16_t cipher_suite_len;
-		uint16_t cipher_suites[2];
+		uint16_t cipher_suites[3];
 		uint8_t compression_methods_len;
 		uint8_t compression_methods[1];
 	} __attribute__ (( packed )) hello;
@@ -683,11 +924,15 @@ static int tls_send_client_hello ( struct tls_session *tls ) {
 	hello.type_length = ( cpu_to_le32 ( TLS_CLIENT_HELLO ) |
 			      htonl ( sizeof ( hello ) -
 				      sizeof ( hello.type_length ) ) );
-	hello.version = htons ( TLS_VERSION_TLS_1_0 );
+	hello.version = htons ( tls->version );
 	memcpy ( &hello.random, &tls->client_random, sizeof ( hello.random ) );
+	hello.session_id_len = sizeof ( hello.session_id );
+	memcpy ( hello.session_id, tls->session_id,
+		 sizeof ( hello.session_id ) );
 	hello.cipher_suite_len = htons ( sizeof ( hello.cipher_suites ) );
-	hello.cipher_suites[0] = htons ( TLS_RSA_WITH_AES_128_CBC_SHA );
-	hello.cipher_suites[1] = htons ( TLS_RSA_WITH_AES_256_CBC_SHA );
+	hello.cipher_suites[0] = htons ( TLS_RSA_WITH_AES_128_GCM_SHA256 );
+	hello.cipher_suites[1] = htons ( TLS_RSA_WITH_AES_128_CBC_SHA );
+	hello.cipher_suites[2] = htons ( TLS_RSA_WITH_AES_256_CBC_SHA );
 	hello.compression_methods_len = sizeof ( hello.compression_methods );
 
 	return tls_send_handshake ( tls, &hello, sizeof ( hello ) );
@@ -758,16 +1003,17 @@ static int tls_send_finished ( struct tls_session *tls ) {
 		uint32_t type_length;
 		uint8_t verify_data[12];
 	} __attribute__ (( packed )) finished;
-	uint8_t digest[MD5_DIGEST_SIZE + SHA1_DIGEST_SIZE];
+	uint8_t digest[TLS_MAX_VERIFY_HANDSHAKE_LEN];
+	size_t digest_len;
 
 	memset ( &finished, 0, sizeof ( finished ) );
 	finished.type_length = ( cpu_to_le32 ( TLS_FINISHED ) |
 				 htonl ( sizeof ( finished ) -
 					 sizeof ( finished.type_length ) ) );
-	tls_verify_handshake ( tls, digest );
+	digest_len = tls_verify_handshake ( tls, digest );
 	tls_prf_label ( tls, &tls->master_secret, sizeof ( tls->master_secret ),
 			finished.verify_data, sizeof ( finished.verify_data ),
-			"client finished", digest, sizeof ( digest ) );
+			"client finished", digest, digest_len );
 
 	return tls_send_handshake ( tls, &finished, sizeof ( finished ) );
 }
@@ -863,6 +1109,7 @@ static int tls_new_server_hello ( struct tls_session *tls,
 		char next[0];
 	} __attribute__ (( packed )) *hello_b = ( void * ) &hello_a->next;
 	void *end = hello_b->next;
+	uint16_t version;
 	int rc;
 
 	/* Sanity check */
@@ -872,24 +1119,56 @@ static int tls_new_server_hello ( struct tls_session *tls,
 		return -EINVAL;
 	}
 
-	/* Check protocol version */
-	if ( ntohs ( hello_a->version ) < TLS_VERSION_TLS_1_0 ) {
+	/* Check and record protocol version */
+	version = ntohs ( hello_a->version );
+	if ( ( version < TLS_VERSION_TLS_1_0 ) || ( version > tls->version ) ){
 		DBGC ( tls, "TLS %p does not support protocol version %d.%d\n",
-		       tls, ( ntohs ( hello_a->version ) >> 8 ),
-		       ( ntohs ( hello_a->version ) & 0xff ) );
+		       tls, ( version >> 8 ), ( version & 0xff ) );
 		return -ENOTSUP;
 	}
+	tls->version = version;
+	DBGC ( tls, "TLS %p using protocol version %d.%d\n",
+	       tls, ( version >> 8 ), ( version & 0xff ) );
 
 	/* Copy out server random bytes */
 	memcpy ( &tls->server_random, &hello_a->random,
 		 sizeof ( tls->server_random ) );
 
+	/* Check whether or not the server is resuming our offered session */
+	if ( hello_a->session_id_len > sizeof ( tls->session_id ) ) {
+		DBGC ( tls, "TLS %p received overlength session ID\n", tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL;
+	}
+	tls->resumed = ( tls->session_id_len &&
+			 ( hello_a->session_id_len == tls->session_id_len ) &&
+			 ( memcmp ( hello_b->session_id, tls->session_id,
+				    tls->session_id_len ) == 0 ) );
+	if ( tls->resumed ) {
+		if ( hello_b->cipher_suite != tls->cipher_suite ) {
+			DBGC ( tls, "TLS %p resumed session changed cipher "
+			       "%04x to %04x\n", tls,
+			       ntohs ( tls->cipher_suite ),
+			       ntohs ( hello_b->cipher_suite ) );
+			return -EINVAL;
+		}
+		DBGC ( tls, "TLS %p resuming cached session\n", tls );
+	} else {
+		memcpy ( tls->session_id, hello_b->session_id,
+			 hello_a->session_id_len );
+		tls->session_id_len = hello_a->session_id_len;
+		tls->cipher_suite = hello_b->cipher_suite;
+	}
+
 	/* Select cipher suite */
 	if ( ( rc = tls_select_cipher ( tls, hello_b->cipher_suite ) ) != 0 )
 		return rc;
 
-	/* Generate secrets */
-	tls_generate_master_secret ( tls );
+	/* Generate secrets.  A resumed session reuses the cached
+	 * master secret, and so needs no key exchange.
+	 */
+	if ( ! tls->resumed )
+		tls_generate_master_secret ( tls );
 	if ( ( rc = tls_generate_keys ( tls ) ) != 0 )
 		return rc;
 
@@ -978,7 +1257,7 @@ static int tls_new_server_hello_done ( struct tls_session *tls,
 	}
 
 	/* Check that we are ready to send the Client Key Exchange */
-	if ( tls->tx_state != TLS_TX_NONE ) {
+	if ( tls->resumed || ( tls->tx_state != TLS_TX_NONE ) ) {
 		DBGC ( tls, "TLS %p received Server Hello Done while in "
 		       "TX state %d\n", tls, tls->tx_state );
 		return -EIO;
@@ -1000,11 +1279,51 @@ static int tls_new_server_hello_done ( struct tls_session *tls,
  */
 static int tls_new_finished ( struct tls_session *tls,
 			      void *data, size_t len ) {
+	struct {
+		uint8_t verify_data[12];
+		char next[0];
+	} __attribute__ (( packed )) *finished = data;
+	void *end = finished->next;
+	uint8_t digest[TLS_MAX_VERIFY_HANDSHAKE_LEN];
+	size_t digest_len;
+	uint8_t verify_data[ sizeof ( finished->verify_data ) ];
 
-	/* FIXME: Handle this properly */
-	tls_tx_data ( tls );
-	( void ) data;
-	( void ) len;
+	/* Sanity check */
+	if ( end != ( data + len ) ) {
+		DBGC ( tls, "TLS %p received overlength Finished\n", tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL;
+	}
+
+	/* Check that we are not still sending our own handshake */
+	if ( tls->tx_state != TLS_TX_NONE ) {
+		DBGC ( tls, "TLS %p received Finished while in TX state %d\n",
+		       tls, tls->tx_state );
+		return -EIO;
+	}
+
+	/* Verify data */
+	digest_len = tls_verify_handshake ( tls, digest );
+	tls_prf_label ( tls, &tls->master_secret, sizeof ( tls->master_secret ),
+			verify_data, sizeof ( verify_data ), "server finished",
+			digest, digest_len );
+	if ( memcmp ( verify_data, finished->verify_data,
+		      sizeof ( verify_data ) ) != 0 ) {
+		DBGC ( tls, "TLS %p verification failed\n", tls );
+		return -EPERM;
+	}
+
+	/* Record session for future resumption */
+	tls_store_cached ( tls );
+
+	/* In an abbreviated handshake, the server finishes first and
+	 * we must now send our own Change Cipher and Finished.
+	 */
+	if ( tls->resumed ) {
+		tls_tx_start ( tls, TLS_TX_CHANGE_CIPHER );
+	} else {
+		tls_tx_data ( tls );
+	}
 
 	return 0;
 }
@@ -1145,6 +1464,44 @@ static void tls_hmac ( struct tls_session *tls __unused,
 		     &digest->digestsize, hmac );
 }
 
+/**
+ * Start authenticated encryption or decryption of a record
+ *
+ * @v cipherspec	Cipher specification
+ * @v seq		Sequence number
+ * @v tlshdr		TLS header (with plaintext length)
+ * @v explicit_iv	Explicit part of nonce
+ *
+ * The nonce is formed from the implicit part (taken from the key
+ * block) and the explicit part (carried in the record).  The
+ * sequence number and header are authenticated as additional data,
+ * which is processed identically for encryption and decryption.
+ */
+static void tls_auth_start ( struct tls_cipherspec *cipherspec,
+			     uint64_t seq, struct tls_header *tlshdr,
+			     const void *explicit_iv ) {
+	struct cipher_algorithm *cipher = cipherspec->cipher;
+	struct {
+		uint8_t fixed[TLS_FIXED_IV_LEN];
+		uint8_t explicit[TLS_EXPLICIT_IV_LEN];
+	} __attribute__ (( packed )) iv;
+	struct {
+		uint64_t seq;
+		struct tls_header tlshdr;
+	} __attribute__ (( packed )) aad;
+
+	/* Construct nonce */
+	memcpy ( iv.fixed, cipherspec->fixed_iv, sizeof ( iv.fixed ) );
+	memcpy ( iv.explicit, explicit_iv, sizeof ( iv.explicit ) );
+	cipher_setiv ( cipher, cipherspec->cipher_ctx, &iv );
+
+	/* Authenticate additional data */
+	aad.seq = cpu_to_be64 ( seq );
+	aad.tlshdr = *tlshdr;
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, &aad, NULL,
+			 sizeof ( aad ) );
+}
+
 /**
  * Allocate and assemble stream-ciphered record from data and MAC portions
  *
@@ -1203,8 +1560,13 @@ static void * tls_assemble_block ( struct tls_session *tls,
 	void *mac;
 	void *padding;
 
-	/* FIXME: TLSv1.1 has an explicit IV */
-	iv_len = 0;
+	/* TLSv1.0 uses an implicit IV, carried over from the previous
+	 * record.  From TLSv1.1 onwards, we prepend a random block
+	 * which, once encrypted with the carried-over CBC state,
+	 * serves as the explicit IV for the remainder of the record.
+	 */
+	if ( tls->version < TLS_VERSION_TLS_1_1 )
+		iv_len = 0;
 
 	/* Calculate block-ciphered struct length */
 	padding_len = ( ( blocksize - 1 ) & -( iv_len + len + mac_len + 1 ) );
@@ -1220,7 +1582,7 @@ static void * tls_assemble_block ( struct tls_session *tls,
 	padding = ( mac + mac_len );
 
 	/* Fill in block-ciphered struct */
-	memset ( iv, 0, iv_len );
+	tls_generate_random ( iv, iv_len );
 	memcpy ( content, data, len );
 	memcpy ( mac, digest, mac_len );
 	memset ( padding, padding_len, ( padding_len + 1 ) );
@@ -1228,6 +1590,72 @@ static void * tls_assemble_block ( struct tls_session *tls,
 	return plaintext;
 }
 
+/**
+ * Send record using an authenticated cipher
+ *
+ * @v tls		TLS session
+ * @v plaintext_tlshdr	Plaintext record header
+ * @v data		Plaintext record
+ * @v len		Length of plaintext record
+ * @ret rc		Return status code
+ *
+ * Authenticated ciphers need no separate MAC or padding, and can
+ * encrypt directly from the caller's buffer.
+ */
+static int tls_send_auth ( struct tls_session *tls,
+			   struct tls_header *plaintext_tlshdr,
+			   const void *data, size_t len ) {
+	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec;
+	struct cipher_algorithm *cipher = cipherspec->cipher;
+	struct tls_header *tlshdr;
+	struct io_buffer *ciphertext;
+	size_t ciphertext_len;
+	uint64_t explicit_iv;
+	int rc;
+
+	/* Allocate ciphertext */
+	ciphertext_len = ( sizeof ( *tlshdr ) + sizeof ( explicit_iv ) +
+			   len + cipher->authsize );
+	ciphertext = xfer_alloc_iob ( &tls->cipherstream, ciphertext_len );
+	if ( ! ciphertext ) {
+		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
+		       "ciphertext\n", tls, ciphertext_len );
+		return -ENOMEM;
+	}
+
+	/* Assemble ciphertext.  The sequence number is never reused
+	 * with the same key, and so serves as the explicit nonce.
+	 */
+	tlshdr = iob_put ( ciphertext, sizeof ( *tlshdr ) );
+	tlshdr->type = plaintext_tlshdr->type;
+	tlshdr->version = plaintext_tlshdr->version;
+	tlshdr->length = htons ( ciphertext_len - sizeof ( *tlshdr ) );
+	explicit_iv = cpu_to_be64 ( tls->tx_seq );
+	memcpy ( iob_put ( ciphertext, sizeof ( explicit_iv ) ),
+		 &explicit_iv, sizeof ( explicit_iv ) );
+	profile_start ( &tls_encrypt_profiler );
+	tls_auth_start ( cipherspec, tls->tx_seq, plaintext_tlshdr,
+			 &explicit_iv );
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, data,
+			 iob_put ( ciphertext, len ), len );
+	cipher_auth ( cipher, cipherspec->cipher_ctx,
+		      iob_put ( ciphertext, cipher->authsize ) );
+	profile_stop ( &tls_encrypt_profiler );
+
+	/* Send ciphertext */
+	if ( ( rc = xfer_deliver_iob ( &tls->cipherstream,
+				       ciphertext ) ) != 0 ) {
+		DBGC ( tls, "TLS %p could not deliver ciphertext: %s\n",
+		       tls, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Update TX state machine to next record */
+	tls->tx_seq += 1;
+
+	return 0;
+}
+
 /**
  * Send plaintext record
  *
@@ -1252,9 +1680,13 @@ static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 
 	/* Construct header */
 	plaintext_tlshdr.type = type;
-	plaintext_tlshdr.version = htons ( TLS_VERSION_TLS_1_0 );
+	plaintext_tlshdr.version = htons ( tls->version );
 	plaintext_tlshdr.length = htons ( len );
 
+	/* Use authenticated cipher, if applicable */
+	if ( is_auth_cipher ( cipherspec->cipher ) )
+		return tls_send_auth ( tls, &plaintext_tlshdr, data, len );
+
 	/* Calculate MAC */
 	tls_hmac ( tls, cipherspec, tls->tx_seq, &plaintext_tlshdr,
 		   data, len, mac );
@@ -1290,13 +1722,15 @@ static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 	/* Assemble ciphertext */
 	tlshdr = iob_put ( ciphertext, sizeof ( *tlshdr ) );
 	tlshdr->type = type;
-	tlshdr->version = htons ( TLS_VERSION_TLS_1_0 );
+	tlshdr->version = htons ( tls->version );
 	tlshdr->length = htons ( plaintext_len );
 	memcpy ( cipherspec->cipher_next_ctx, cipherspec->cipher_ctx,
 		 cipherspec->cipher->ctxsize );
+	profile_start ( &tls_encrypt_profiler );
 	cipher_encrypt ( cipherspec->cipher, cipherspec->cipher_next_ctx,
 			 plaintext, iob_put ( ciphertext, plaintext_len ),
 			 plaintext_len );
+	profile_stop ( &tls_encrypt_profiler );
 
 	/* Free plaintext as soon as possible to conserve memory */
 	free ( plaintext );
@@ -1393,8 +1827,12 @@ static int tls_split_block ( struct tls_session *tls,
 	}
 	iv_len = tls->rx_cipherspec.cipher->blocksize;
 
-	/* FIXME: TLSv1.1 uses an explicit IV */
-	iv_len = 0;
+	/* From TLSv1.1 onwards, the first block is an explicit IV.
+	 * Since the whole record has been decrypted in CBC mode, this
+	 * block has served its purpose and can simply be discarded.
+	 */
+	if ( tls->version < TLS_VERSION_TLS_1_1 )
+		iv_len = 0;
 
 	mac_len = tls->rx_cipherspec.digest->digestsize;
 	padding_len = *( ( uint8_t * ) ( plaintext + plaintext_len - 1 ) );
@@ -1438,8 +1876,15 @@ static int tls_new_ciphertext ( struct tls_session *tls,
 				struct tls_header *tlshdr, void *ciphertext ) {
 	struct tls_header plaintext_tlshdr;
 	struct tls_cipherspec *cipherspec = &tls->rx_cipherspec;
+	struct cipher_algorithm *cipher = cipherspec->cipher;
 	size_t record_len = ntohs ( tlshdr->length );
+	size_t plaintext_len = record_len;
+	struct xfer_metadata meta;
 	void *plaintext = NULL;
+	int placed = 0;
+	void *explicit_iv = NULL;
+	void *auth = NULL;
+	uint8_t verify_auth[cipher->authsize];
 	void *data;
 	size_t len;
 	void *mac;
@@ -1447,52 +1892,116 @@ static int tls_new_ciphertext ( struct tls_session *tls,
 	uint8_t verify_mac[mac_len];
 	int rc;
 
-	/* Allocate buffer for plaintext */
-	plaintext = malloc ( record_len );
+	/* Split authenticated record into explicit nonce, encrypted
+	 * content and authentication tag
+	 */
+	if ( is_auth_cipher ( cipher ) ) {
+		if ( record_len < ( TLS_EXPLICIT_IV_LEN + cipher->authsize ) ){
+			DBGC ( tls, "TLS %p received underlength record\n",
+			       tls );
+			DBGC_HD ( tls, ciphertext, record_len );
+			rc = -EINVAL;
+			goto done;
+		}
+		explicit_iv = ciphertext;
+		ciphertext += TLS_EXPLICIT_IV_LEN;
+		plaintext_len = ( record_len - TLS_EXPLICIT_IV_LEN -
+				  cipher->authsize );
+		auth = ( ciphertext + plaintext_len );
+	}
+
+	/* Decrypt application data directly into the recipient's
+	 * buffer if possible, otherwise allocate buffer for plaintext.
+	 * Only an authenticated cipher's plaintext consists solely of
+	 * content; for other ciphers the MAC and any padding are
+	 * decrypted along with the content, and must not reach the
+	 * recipient.
+	 */
+	memset ( &meta, 0, sizeof ( meta ) );
+	if ( auth && ( tlshdr->type == TLS_TYPE_DATA ) ) {
+		plaintext = xfer_buffer ( &tls->plainstream, plaintext_len,
+					  &meta );
+		placed = ( plaintext != NULL );
+	}
+	if ( ! plaintext )
+		plaintext = malloc ( plaintext_len );
 	if ( ! plaintext ) {
 		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "decryption buffer\n", tls, record_len );
+		       "decryption buffer\n", tls, plaintext_len );
 		rc = -ENOMEM;
 		goto done;
 	}
 
 	/* Decrypt the record */
-	cipher_decrypt ( cipherspec->cipher, cipherspec->cipher_ctx,
-			 ciphertext, plaintext, record_len );
-
-	/* Split record into content and MAC */
-	if ( is_stream_cipher ( cipherspec->cipher ) ) {
-		if ( ( rc = tls_split_stream ( tls, plaintext, record_len,
-					       &data, &len, &mac ) ) != 0 )
+	plaintext_tlshdr.type = tlshdr->type;
+	plaintext_tlshdr.version = tlshdr->version;
+	plaintext_tlshdr.length = htons ( plaintext_len );
+	profile_start ( &tls_decrypt_profiler );
+	if ( auth ) {
+		tls_auth_start ( cipherspec, tls->rx_seq, &plaintext_tlshdr,
+				 explicit_iv );
+	}
+	cipher_decrypt ( cipher, cipherspec->cipher_ctx,
+			 ciphertext, plaintext, plaintext_len );
+	profile_stop ( &tls_decrypt_profiler );
+
+	if ( auth ) {
+		/* Verify authentication tag */
+		cipher_auth ( cipher, cipherspec->cipher_ctx, verify_auth );
+		if ( memcmp ( auth, verify_auth,
+			      sizeof ( verify_auth ) ) != 0 ) {
+			DBGC ( tls, "TLS %p failed authentication\n", tls );
+			rc = -EINVAL;
 			goto done;
+		}
+		data = plaintext;
+		len = plaintext_len;
 	} else {
-		if ( ( rc = tls_split_block ( tls, plaintext, record_len,
-					      &data, &len, &mac ) ) != 0 )
+		/* Split record into content and MAC */
+		if ( is_stream_cipher ( cipher ) ) {
+			rc = tls_split_stream ( tls, plaintext, record_len,
+						&data, &len, &mac );
+		} else {
+			rc = tls_split_block ( tls, plaintext, record_len,
+					       &data, &len, &mac );
+		}
+		if ( rc != 0 )
 			goto done;
-	}
 
-	/* Verify MAC */
-	plaintext_tlshdr.type = tlshdr->type;
-	plaintext_tlshdr.version = tlshdr->version;
-	plaintext_tlshdr.length = htons ( len );
-	tls_hmac ( tls, cipherspec, tls->rx_seq, &plaintext_tlshdr,
-		   data, len, verify_mac);
-	if ( memcmp ( mac, verify_mac, mac_len ) != 0 ) {
-		DBGC ( tls, "TLS %p failed MAC verification\n", tls );
-		DBGC_HD ( tls, plaintext, record_len );
-		goto done;
+		/* Verify MAC */
+		plaintext_tlshdr.length = htons ( len );
+		tls_hmac ( tls, cipherspec, tls->rx_seq, &plaintext_tlshdr,
+			   data, len, verify_mac);
+		if ( memcmp ( mac, verify_mac, mac_len ) != 0 ) {
+			DBGC ( tls, "TLS %p failed MAC verification\n", tls );
+			DBGC_HD ( tls, plaintext, record_len );
+			rc = -EINVAL;
+			goto done;
+		}
 	}
 
 	DBGC2 ( tls, "Received plaintext data:\n" );
 	DBGC2_HD ( tls, data, len );
 
 	/* Process plaintext record */
+	if ( placed ) {
+		rc = xfer_deliver_into ( &tls->plainstream, len, &meta );
+		goto done_placed;
+	}
 	if ( ( rc = tls_new_record ( tls, tlshdr->type, data, len ) ) != 0 )
 		goto done;
 
 	rc = 0;
  done:
-	free ( plaintext );
+	if ( placed ) {
+		/* Complete the placement without delivering any of
+		 * the unverified plaintext
+		 */
+		xfer_deliver_into ( &tls->plainstream, 0, &meta );
+	} else {
+		free ( plaintext );
+	}
+ done_placed:
 	return rc;
 }
 
@@ -1754,7 +2263,15 @@ static void tls_tx_step ( struct tls_session *tls ) {
 			       tls, strerror ( rc ) );
 			goto err;
 		}
-		tls_tx_none ( tls );
+		/* An abbreviated handshake is complete once we have
+		 * sent our Finished; a full handshake must wait for
+		 * the server's Finished.
+		 */
+		if ( tls->resumed ) {
+			tls_tx_data ( tls );
+		} else {
+			tls_tx_none ( tls );
+		}
 		break;
 	case TLS_TX_DATA:
 		/* Nothing to do */
@@ -1780,7 +2297,19 @@ static struct process_descriptor tls_process_desc =
  ******************************************************************************
  */
 
-int add_tls ( struct interface *xfer, struct interface **next ) {
+/**
+ * Add TLS filter
+ *
+ * @v xfer		Plaintext data transfer interface
+ * @v name		Server name, or NULL
+ * @v next		Ciphertext data transfer interface to fill in
+ * @ret rc		Return status code
+ *
+ * If a server name is provided, it is used as the key for session
+ * resumption.
+ */
+int add_tls ( struct interface *xfer, const char *name,
+	      struct interface **next ) {
 	struct tls_session *tls;
 
 	/* Allocate and initialise TLS structure */
@@ -1789,20 +2318,30 @@ int add_tls ( struct interface *xfer, struct interface **next ) {
 		return -ENOMEM;
 	memset ( tls, 0, sizeof ( *tls ) );
 	ref_init ( &tls->refcnt, free_tls );
+	if ( name ) {
+		tls->name = strdup ( name );
+		if ( ! tls->name ) {
+			free ( tls );
+			return -ENOMEM;
+		}
+	}
 	intf_init ( &tls->plainstream, &tls_plainstream_desc, &tls->refcnt );
 	intf_init ( &tls->cipherstream, &tls_cipherstream_desc, &tls->refcnt );
 	tls_clear_cipher ( tls, &tls->tx_cipherspec );
 	tls_clear_cipher ( tls, &tls->tx_cipherspec_pending );
 	tls_clear_cipher ( tls, &tls->rx_cipherspec );
 	tls_clear_cipher ( tls, &tls->rx_cipherspec_pending );
+	tls->version = TLS_VERSION_TLS_1_2;
 	tls->client_random.gmt_unix_time = 0;
 	tls_generate_random ( &tls->client_random.random,
 			      ( sizeof ( tls->client_random.random ) ) );
-	tls->pre_master_secret.version = htons ( TLS_VERSION_TLS_1_0 );
+	tls->pre_master_secret.version = htons ( tls->version );
 	tls_generate_random ( &tls->pre_master_secret.random,
 			      ( sizeof ( tls->pre_master_secret.random ) ) );
 	digest_init ( &md5_algorithm, tls->handshake_md5_ctx );
 	digest_init ( &sha1_algorithm, tls->handshake_sha1_ctx );
+	digest_init ( &sha256_algorithm, tls->handshake_sha256_ctx );
+	tls_load_cached ( tls );
 	process_init_stopped ( &tls->process, &tls_process_desc, &tls->refcnt );
 	tls_tx_start ( tls, TLS_TX_CLIENT_HELLO );
 
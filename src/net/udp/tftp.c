@@ -70,6 +70,9 @@ FEATURE ( FEATURE_PROTOCOL, "TFTP", DHCP_EB_FEATURE_TFTP, 1 );
 #define EINVAL_MC_INVALID_PORT __einfo_error ( EINFO_EINVAL_MC_INVALID_PORT )
 #define EINFO_EINVAL_MC_INVALID_PORT __einfo_uniqify \
 	( EINFO_EINVAL, 0x07, "Invalid multicast port" )
+#define EINVAL_WINDOWSIZE __einfo_error ( EINFO_EINVAL_WINDOWSIZE )
+#define EINFO_EINVAL_WINDOWSIZE __einfo_uniqify \
+	( EINFO_EINVAL, 0x08, "Invalid windowsize" )
 
 /**
  * A TFTP request
@@ -96,6 +99,21 @@ struct tftp_request {
 	 * this will default to 512).
 	 */
 	unsigned int blksize;
+	/** Window size
+	 *
+	 * This is the "windowsize" option (RFC 7440) negotiated with
+	 * the TFTP server, i.e. the number of data blocks that the
+	 * server will send before waiting for an ACK.  (If the TFTP
+	 * server does not support the option, this will default to
+	 * 1).
+	 */
+	unsigned int windowsize;
+	/** Last acknowledged block number
+	 *
+	 * This is the block number (as a count of contiguous blocks
+	 * received) contained in the most recently transmitted ACK.
+	 */
+	unsigned int ack_block;
 	/** File size
 	 *
 	 * This is the value returned in the "tsize" option from the
@@ -142,7 +160,7 @@ struct tftp_request {
 enum {
 	/** Send ACK packets */
 	TFTP_FL_SEND_ACK = 0x0001,
-	/** Request blksize and tsize options */
+	/** Request blksize, tsize and windowsize options */
 	TFTP_FL_RRQ_SIZES = 0x0002,
 	/** Request multicast option */
 	TFTP_FL_RRQ_MULTICAST = 0x0004,
@@ -304,6 +322,24 @@ void tftp_set_request_blksize ( unsigned int blksize ) {
 	tftp_request_blksize = blksize;
 }
 
+/**
+ * TFTP requested window size
+ *
+ * This is treated as a global configuration parameter.
+ */
+static unsigned int tftp_request_windowsize = TFTP_MAX_WINDOWSIZE;
+
+/**
+ * Set TFTP request window size
+ *
+ * @v windowsize	Requested window size
+ */
+void tftp_set_request_windowsize ( unsigned int windowsize ) {
+	if ( windowsize < TFTP_DEFAULT_WINDOWSIZE )
+		windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp_request_windowsize = windowsize;
+}
+
 /**
  * MTFTP multicast receive address
  *
@@ -364,6 +400,7 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 		+ 5 + 1 /* "octet" + NUL */
 		+ 7 + 1 + 5 + 1 /* "blksize" + NUL + ddddd + NUL */
 		+ 5 + 1 + 1 + 1 /* "tsize" + NUL + "0" + NUL */ 
+		+ 10 + 1 + 5 + 1 /* "windowsize" + NUL + ddddd + NUL */
 		+ 9 + 1 + 1 /* "multicast" + NUL + NUL */ );
 	iobuf = xfer_alloc_iob ( &tftp->socket, len );
 	if ( ! iobuf )
@@ -379,6 +416,24 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 					    iob_tailroom ( iobuf ),
 					    "blksize%c%d%ctsize%c0", 0,
 					    tftp_request_blksize, 0, 0 ) + 1 );
+		/* Window size is not meaningful for multicast
+		 * transfers, and must not be requested unless it
+		 * would change the default behaviour.  Some
+		 * recipients (e.g. the PXE TFTP API) can accept only
+		 * a single block at a time, and so a window is also
+		 * requested only if the recipient's flow control
+		 * window could hold an entire window of blocks.
+		 */
+		if ( ( ! ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) ) &&
+		     ( tftp_request_windowsize != TFTP_DEFAULT_WINDOWSIZE ) &&
+		     ( xfer_window ( &tftp->xfer ) >=
+		       ( tftp_request_windowsize * tftp_request_blksize ) ) ){
+			iob_put ( iobuf, snprintf ( iobuf->tail,
+						    iob_tailroom ( iobuf ),
+						    "windowsize%c%d", 0,
+						    tftp_request_windowsize )
+				  + 1 );
+		}
 	}
 	if ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) {
 		iob_put ( iobuf, snprintf ( iobuf->tail,
@@ -420,6 +475,9 @@ static int tftp_send_ack ( struct tftp_request *tftp ) {
 	ack->opcode = htons ( TFTP_ACK );
 	ack->block = htons ( block );
 
+	/* Record acknowledged block */
+	tftp->ack_block = block;
+
 	/* ACK always goes to the peer recorded from the RRQ response */
 	return xfer_deliver ( &tftp->socket, iobuf, &meta );
 }
@@ -579,6 +637,28 @@ static int tftp_process_blksize ( struct tftp_request *tftp,
 	return 0;
 }
 
+/**
+ * Process TFTP "windowsize" option
+ *
+ * @v tftp		TFTP connection
+ * @v value		Option value
+ * @ret rc		Return status code
+ */
+static int tftp_process_windowsize ( struct tftp_request *tftp,
+				     const char *value ) {
+	char *end;
+
+	tftp->windowsize = strtoul ( value, &end, 10 );
+	if ( *end || ( tftp->windowsize == 0 ) ) {
+		DBGC ( tftp, "TFTP %p got invalid windowsize \"%s\"\n",
+		       tftp, value );
+		return -EINVAL_WINDOWSIZE;
+	}
+	DBGC ( tftp, "TFTP %p windowsize=%d\n", tftp, tftp->windowsize );
+
+	return 0;
+}
+
 /**
  * Process TFTP "tsize" option
  *
@@ -689,6 +769,7 @@ static struct tftp_option tftp_options[] = {
 	{ "blksize", tftp_process_blksize },
 	{ "tsize", tftp_process_tsize },
 	{ "multicast", tftp_process_multicast },
+	{ "windowsize", tftp_process_windowsize },
 	{ NULL, NULL }
 };
 
@@ -812,6 +893,8 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 			  struct io_buffer *iobuf ) {
 	struct tftp_data *data = iobuf->data;
 	struct xfer_metadata meta;
+	unsigned int expected;
+	unsigned int received;
 	unsigned int block;
 	off_t offset;
 	size_t data_len;
@@ -833,7 +916,8 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 	}
 
 	/* Calculate block number */
-	block = ( ( bitmap_first_gap ( &tftp->bitmap ) + 1 ) & ~0xffff );
+	expected = bitmap_first_gap ( &tftp->bitmap );
+	block = ( ( expected + 1 ) & ~0xffff );
 	if ( data->block == 0 && block == 0 ) {
 		DBGC ( tftp, "TFTP %p received data block 0\n", tftp );
 		rc = -EINVAL;
@@ -869,9 +953,26 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 
 	/* Mark block as received */
 	bitmap_set ( &tftp->bitmap, block );
-
-	/* Acknowledge block */
-	tftp_send_packet ( tftp );
+	received = bitmap_first_gap ( &tftp->bitmap );
+
+	/* Acknowledge block(s).  With a window size greater than one,
+	 * send a cumulative ACK only when a complete window has been
+	 * received, when the final block has been received, or when
+	 * an out-of-order block indicates that a block has been lost
+	 * (in which case the server will restart transmission from
+	 * the block following the acknowledged block).  Otherwise,
+	 * just restart the retransmission timer; if no further data
+	 * arrives, the timer will resend the ACK.
+	 */
+	if ( ( tftp->windowsize <= 1 ) ||
+	     ( ( received - tftp->ack_block ) >= tftp->windowsize ) ||
+	     ( data_len < tftp->blksize ) ||
+	     ( ( block != expected ) && ( received != tftp->ack_block ) ) ) {
+		tftp_send_packet ( tftp );
+	} else {
+		stop_timer ( &tftp->timer );
+		start_timer ( &tftp->timer );
+	}
 
 	/* If all blocks have been received, finish. */
 	if ( bitmap_full ( &tftp->bitmap ) )
@@ -1100,6 +1201,7 @@ static int tftp_core_open ( struct interface *xfer, struct uri *uri,
 	timer_init ( &tftp->timer, tftp_timer_expired, &tftp->refcnt );
 	tftp->uri = uri_get ( uri );
 	tftp->blksize = TFTP_DEFAULT_BLKSIZE;
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
 	tftp->flags = flags;
 
 	/* Open socket */
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * AES-GCM self-tests
+ *
+ * The AES-GCM implementation (using whichever of the software or
+ * hardware-accelerated implementations is selected for this CPU) is
+ * tested against the test vectors from the original GCM
+ * specification.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/crypto.h>
+#include <ipxe/aes.h>
+#include <ipxe/gcm.h>
+#include <ipxe/test.h>
+
+REQUIRE_OBJECT ( test );
+
+/** Maximum test vector data length */
+#define AES_GCM_TEST_MAX_LEN 64
+
+/** An AES-GCM test vector (all fields as hex strings) */
+struct aes_gcm_test {
+	/** Key */
+	const char *key;
+	/** Initialisation vector */
+	const char *iv;
+	/** Plaintext */
+	const char *plaintext;
+	/** Additional authenticated data */
+	const char *aad;
+	/** Ciphertext */
+	const char *ciphertext;
+	/** Authentication tag */
+	const char *tag;
+};
+
+/** AES-GCM test vectors */
+static struct aes_gcm_test aes_gcm_tests[] = {
+	/* Test case 1 */
+	{ "00000000000000000000000000000000", "000000000000000000000000",
+	  "", "", "", "58e2fccefa7e3061367f1d57a4e7455a" },
+	/* Test case 2 */
+	{ "00000000000000000000000000000000", "000000000000000000000000",
+	  "00000000000000000000000000000000", "",
+	  "0388dace60b6a392f328c2b971b2fe78",
+	  "ab6e47d42cec13bdf53a67b21257bddf" },
+	/* Test case 4 */
+	{ "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+	  "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+	  "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657"
+	  "ba637b39", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+	  "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e23"
+	  "29aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac97"
+	  "3d58e091", "5bc94fbc3221a5db94fae95ae7121a47" },
+	/* Test case 16 */
+	{ "feffe9928665731c6d6a8f9467308308"
+	  "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+	  "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+	  "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657"
+	  "ba637b39", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+	  "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd"
+	  "2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0a"
+	  "bcc9f662", "76fc6ece0f4e1768cddf8853bb2d551b" },
+};
+
+/**
+ * Convert hex string to raw bytes
+ *
+ * @v hex	Hex string
+ * @v data	Buffer to fill in
+ * @ret len	Length of data
+ */
+static size_t aes_gcm_test_unhex ( const char *hex, uint8_t *data ) {
+	char byte[3] = { 0 };
+	size_t len = 0;
+
+	while ( hex[0] && hex[1] ) {
+		byte[0] = hex[0];
+		byte[1] = hex[1];
+		data[len++] = strtoul ( byte, NULL, 16 );
+		hex += 2;
+	}
+	return len;
+}
+
+/**
+ * Perform AES-GCM self-tests
+ *
+ */
+static void aes_gcm_test_exec ( void ) {
+	struct cipher_algorithm *cipher = &aes_gcm_algorithm;
+	uint8_t ctx[cipher->ctxsize];
+	uint8_t key[32];
+	uint8_t iv[GCM_IV_LEN];
+	uint8_t plaintext[AES_GCM_TEST_MAX_LEN];
+	uint8_t aad[AES_GCM_TEST_MAX_LEN];
+	uint8_t ciphertext[AES_GCM_TEST_MAX_LEN];
+	uint8_t tag[GCM_AUTH_LEN];
+	uint8_t out[AES_GCM_TEST_MAX_LEN];
+	uint8_t out_tag[GCM_AUTH_LEN];
+	struct aes_gcm_test *test;
+	size_t key_len;
+	size_t len;
+	size_t aad_len;
+	unsigned int i;
+
+	for ( i = 0 ; i < ( sizeof ( aes_gcm_tests ) /
+			    sizeof ( aes_gcm_tests[0] ) ) ; i++ ) {
+		test = &aes_gcm_tests[i];
+		key_len = aes_gcm_test_unhex ( test->key, key );
+		aes_gcm_test_unhex ( test->iv, iv );
+		len = aes_gcm_test_unhex ( test->plaintext, plaintext );
+		aad_len = aes_gcm_test_unhex ( test->aad, aad );
+		aes_gcm_test_unhex ( test->ciphertext, ciphertext );
+		aes_gcm_test_unhex ( test->tag, tag );
+		ok ( cipher_setkey ( cipher, ctx, key, key_len ) == 0 );
+
+		/* Encrypt */
+		cipher_setiv ( cipher, ctx, iv );
+		cipher_encrypt ( cipher, ctx, aad, NULL, aad_len );
+		cipher_encrypt ( cipher, ctx, plaintext, out, len );
+		cipher_auth ( cipher, ctx, out_tag );
+		ok ( memcmp ( out, ciphertext, len ) == 0 );
+		ok ( memcmp ( out_tag, tag, sizeof ( tag ) ) == 0 );
+
+		/* Decrypt */
+		cipher_setiv ( cipher, ctx, iv );
+		cipher_encrypt ( cipher, ctx, aad, NULL, aad_len );
+		cipher_decrypt ( cipher, ctx, ciphertext, out, len );
+		cipher_auth ( cipher, ctx, out_tag );
+		ok ( memcmp ( out, plaintext, len ) == 0 );
+		ok ( memcmp ( out_tag, tag, sizeof ( tag ) ) == 0 );
+	}
+}
+
+/** AES-GCM self-test */
+struct self_test aes_gcm_test __self_test = {
+	.name = "aes-gcm",
+	.exec = aes_gcm_test_exec,
+};
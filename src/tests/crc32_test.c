@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * CRC32 self-tests
+ *
+ * The CRC32 implementation (including any accelerator selected for
+ * this CPU) is tested against known test vectors and against a
+ * simple bit-serial reference implementation.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/crc32.h>
+#include <ipxe/test.h>
+
+REQUIRE_OBJECT ( test );
+
+/** Maximum buffer alignment offset to test */
+#define CRC32_TEST_MAX_ALIGN 8
+
+/** Maximum buffer length to test */
+#define CRC32_TEST_MAX_LEN 256
+
+/** A CRC32 test vector */
+struct crc32_test {
+	/** Data */
+	const char *data;
+	/** Expected CRC (with all-ones seed and final inversion) */
+	u32 crc;
+};
+
+/** CRC32 test vectors */
+static struct crc32_test crc32_tests[] = {
+	{ "", 0x00000000 },
+	{ "a", 0xe8b7be43 },
+	{ "abc", 0x352441c2 },
+	{ "123456789", 0xcbf43926 },
+	{ "The quick brown fox jumps over the lazy dog", 0x414fa339 },
+};
+
+/** Test buffer */
+static uint8_t crc32_test_buf[ CRC32_TEST_MAX_ALIGN + CRC32_TEST_MAX_LEN ];
+
+/**
+ * Calculate 32-bit little-endian CRC checksum (reference implementation)
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ */
+static u32 crc32_test_le ( u32 seed, const void *data, size_t len ) {
+	u32 crc = seed;
+	const u8 *src = data;
+	int i;
+
+	while ( len-- ) {
+		crc ^= *src++;
+		for ( i = 0; i < 8; i++ )
+			crc = ( crc >> 1 ) ^ ( ( crc & 1 ) ? 0xedb88320 : 0 );
+	}
+	return crc;
+}
+
+/**
+ * Perform CRC32 self-tests
+ *
+ */
+static void crc32_test_exec ( void ) {
+	struct crc32_test *test;
+	unsigned int align;
+	unsigned int len;
+	unsigned int i;
+	u32 seed;
+
+	/* Check known test vectors */
+	for ( i = 0 ; i < ( sizeof ( crc32_tests ) /
+			    sizeof ( crc32_tests[0] ) ) ; i++ ) {
+		test = &crc32_tests[i];
+		ok ( ~crc32_le ( ~0, test->data, strlen ( test->data ) ) ==
+		     test->crc );
+	}
+
+	/* Check against reference implementation */
+	for ( i = 0 ; i < sizeof ( crc32_test_buf ) ; i++ )
+		crc32_test_buf[i] = random();
+	for ( align = 0 ; align < CRC32_TEST_MAX_ALIGN ; align++ ) {
+		for ( len = 0 ; len <= CRC32_TEST_MAX_LEN ; len++ ) {
+			seed = random();
+			ok ( crc32_le ( seed, &crc32_test_buf[align], len ) ==
+			     crc32_test_le ( seed, &crc32_test_buf[align],
+					     len ) );
+		}
+	}
+}
+
+/** CRC32 self-test */
+struct self_test crc32_test __self_test = {
+	.name = "crc32",
+	.exec = crc32_test_exec,
+};
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * TCP/IP checksum self-tests
+ *
+ * The optimised TCP/IP checksum calculation is tested against a
+ * simple (and obviously correct) reference implementation.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <byteswap.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/test.h>
+
+REQUIRE_OBJECT ( test );
+
+/** Maximum buffer alignment offset to test */
+#define TCPIP_TEST_MAX_ALIGN 16
+
+/** Maximum buffer length to test */
+#define TCPIP_TEST_MAX_LEN 1600
+
+/** Test buffer */
+static uint8_t tcpip_test_buf[ TCPIP_TEST_MAX_ALIGN + TCPIP_TEST_MAX_LEN ]
+	__attribute__ (( aligned ( 16 ) ));
+
+/**
+ * Calculate continued TCP/IP checkum (reference implementation)
+ *
+ * @v partial		Checksum of already-summed data, in network byte order
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @ret cksum		Updated checksum, in network byte order
+ */
+static uint16_t tcpip_test_chksum ( uint16_t partial, const void *data,
+				    size_t len ) {
+	unsigned int cksum = ( ( ~partial ) & 0xffff );
+	unsigned int value;
+	unsigned int i;
+
+	for ( i = 0 ; i < len ; i++ ) {
+		value = * ( ( uint8_t * ) data + i );
+		if ( i & 1 ) {
+			/* Odd bytes: swap on little-endian systems */
+			value = be16_to_cpu ( value );
+		} else {
+			/* Even bytes: swap on big-endian systems */
+			value = le16_to_cpu ( value );
+		}
+		cksum += value;
+		if ( cksum > 0xffff )
+			cksum -= 0xffff;
+	}
+
+	return ( ~cksum );
+}
+
+/**
+ * Fill test buffer
+ *
+ * @v pattern		Fill pattern (0=random, 1=all zeros, 2=all ones)
+ */
+static void tcpip_test_fill ( unsigned int pattern ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < sizeof ( tcpip_test_buf ) ; i++ ) {
+		switch ( pattern ) {
+		case 0:		tcpip_test_buf[i] = random();	break;
+		case 1:		tcpip_test_buf[i] = 0x00;	break;
+		default:	tcpip_test_buf[i] = 0xff;	break;
+		}
+	}
+}
+
+/**
+ * Perform TCP/IP checksum self-tests
+ *
+ */
+static void tcpip_test_exec ( void ) {
+	unsigned int pattern;
+	unsigned int align;
+	unsigned int len;
+	uint16_t partial;
+	uint16_t expected;
+	uint16_t actual;
+
+	for ( pattern = 0 ; pattern < 3 ; pattern++ ) {
+		tcpip_test_fill ( pattern );
+		for ( align = 0 ; align < TCPIP_TEST_MAX_ALIGN ; align++ ) {
+			for ( len = 0 ; len <= TCPIP_TEST_MAX_LEN ; len++ ) {
+				partial = ( ( pattern == 0 ) ? random() :
+					    TCPIP_EMPTY_CSUM );
+				expected = tcpip_test_chksum ( partial,
+						&tcpip_test_buf[align], len );
+				actual = tcpip_continue_chksum ( partial,
+						&tcpip_test_buf[align], len );
+				ok ( actual == expected );
+			}
+		}
+	}
+}
+
+/** TCP/IP checksum self-test */
+struct self_test tcpip_test __self_test = {
+	.name = "tcpip",
+	.exec = tcpip_test_exec,
+};
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Self-test infrastructure
+ *
+ * Self-tests are linked in by naming them as target elements, in
+ * the same way as drivers.  For example, "make bin/crc32_test.lkrn"
+ * builds an image which runs the CRC32 self-tests during
+ * initialisation and reports the result before continuing to boot.
+ * Any number of self-tests may be combined, as in
+ * "bin/tcpip_test--crc32_test.lkrn".
+ *
+ */
+
+#include <stdio.h>
+#include <ipxe/init.h>
+#include <ipxe/test.h>
+
+/** Number of tests run in the current self-test set */
+static unsigned int test_total;
+
+/** Number of failed tests in the current self-test set */
+static unsigned int test_failures;
+
+/**
+ * Report test result
+ *
+ * @v success		Test succeeded
+ * @v file		Test code file
+ * @v line		Test code line
+ * @v test		Test code
+ */
+void test_ok ( int success, const char *file, unsigned int line,
+	       const char *test ) {
+
+	test_total++;
+	if ( ! success ) {
+		test_failures++;
+		printf ( "FAILURE: \"%s\" test failed at %s line %d\n",
+			 test, file, line );
+	}
+}
+
+/**
+ * Run all linked-in self-tests
+ *
+ */
+static void test_init ( void ) {
+	struct self_test *tests;
+
+	for_each_table_entry ( tests, SELF_TESTS ) {
+		test_total = test_failures = 0;
+		tests->exec();
+		if ( test_failures ) {
+			printf ( "%s self-tests: %d of %d tests failed\n",
+				 tests->name, test_failures, test_total );
+		} else {
+			printf ( "%s self-tests: all %d tests passed\n",
+				 tests->name, test_total );
+		}
+	}
+}
+
+/** Self-test initialisation function */
+struct init_fn test_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = test_init,
+};
@@ -0,0 +1,678 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/timer.h>
+#include <ipxe/process.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/image.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/blockdev.h>
+#include <ipxe/blkcache.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/crc32.h>
+#include <ipxe/crypto.h>
+#include <ipxe/sha1.h>
+#include <ipxe/aes.h>
+#include <ipxe/gcm.h>
+#include <ipxe/rsa.h>
+#include <usr/imgmgmt.h>
+#include <usr/bench.h>
+
+/** @file
+ *
+ * Benchmarks
+ *
+ * Since iPXE runs to completion in a single polling loop, elapsed
+ * time is also the CPU time consumed by each benchmark.
+ *
+ */
+
+/** Length of data processed by each microbenchmark operation */
+#define BENCH_LEN 4096
+
+/** Number of microbenchmark operations between timer checks */
+#define BENCH_BATCH 16
+
+/** Maximum length of a single block device benchmark transfer */
+#define BENCH_BLOCK_CHUNK ( 64 * 1024 )
+
+/** Block device benchmark command timeout */
+#define BENCH_BLOCK_TIMEOUT ( 15 * TICKS_PER_SEC )
+
+/** Length of RSA modulus used for the modular exponentiation benchmark */
+#define BENCH_RSA_LEN 256
+
+/** Microbenchmark source buffer */
+static uint8_t bench_src[BENCH_LEN];
+
+/** Microbenchmark destination buffer */
+static uint8_t bench_dst[BENCH_LEN];
+
+/** A microbenchmark */
+struct bench_test {
+	/** Name */
+	const char *name;
+	/** Length of data processed by each operation, or zero */
+	size_t len;
+	/** Prepare benchmark (optional)
+	 *
+	 * @ret rc		Return status code
+	 */
+	int ( * init ) ( void );
+	/** Perform one operation */
+	void ( * exec ) ( void );
+	/** Clean up benchmark (optional) */
+	void ( * fini ) ( void );
+};
+
+/**
+ * Print elapsed time and throughput
+ *
+ * @v len		Number of bytes transferred
+ * @v elapsed		Elapsed time (in ticks)
+ */
+static void bench_print_rate ( uint64_t len, unsigned long elapsed ) {
+	unsigned long ms;
+	unsigned long rate;
+
+	if ( ! elapsed )
+		elapsed = 1;
+	ms = ( ( elapsed * 1000ULL ) / TICKS_PER_SEC );
+	rate = ( ( len * 100 * TICKS_PER_SEC ) / ( elapsed * 1000000ULL ) );
+	printf ( "%lld bytes in %ld.%03lds (%ld.%02ld MB/s)",
+		 ( ( unsigned long long ) len ), ( ms / 1000 ), ( ms % 1000 ),
+		 ( rate / 100 ), ( rate % 100 ) );
+}
+
+/******************************************************************************
+ *
+ * Microbenchmarks
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Perform TCP/IP checksum operation
+ *
+ */
+static void bench_chksum_exec ( void ) {
+	tcpip_chksum ( bench_src, sizeof ( bench_src ) );
+}
+
+/**
+ * Perform CRC32 operation
+ *
+ */
+static void bench_crc32_exec ( void ) {
+	crc32_le ( ~0, bench_src, sizeof ( bench_src ) );
+}
+
+/**
+ * Perform memcpy() operation
+ *
+ */
+static void bench_memcpy_exec ( void ) {
+	memcpy ( bench_dst, bench_src, sizeof ( bench_dst ) );
+}
+
+/**
+ * Perform SHA-1 operation
+ *
+ */
+static void bench_sha1_exec ( void ) {
+	uint8_t ctx[SHA1_CTX_SIZE];
+
+	digest_init ( &sha1_algorithm, ctx );
+	digest_update ( &sha1_algorithm, ctx, bench_src,
+			sizeof ( bench_src ) );
+	digest_final ( &sha1_algorithm, ctx, bench_dst );
+}
+
+/** AES benchmark cipher context */
+static void *bench_aes_ctx;
+
+/**
+ * Prepare cipher benchmark
+ *
+ * @v cipher		Cipher algorithm
+ * @ret rc		Return status code
+ */
+static int bench_cipher_init ( struct cipher_algorithm *cipher ) {
+	static const uint8_t key[16];
+	static const uint8_t iv[AES_BLOCKSIZE];
+	int rc;
+
+	bench_aes_ctx = malloc ( cipher->ctxsize );
+	if ( ! bench_aes_ctx )
+		return -ENOMEM;
+	if ( ( rc = cipher_setkey ( cipher, bench_aes_ctx, key,
+				    sizeof ( key ) ) ) != 0 ) {
+		free ( bench_aes_ctx );
+		return rc;
+	}
+	cipher_setiv ( cipher, bench_aes_ctx, iv );
+	return 0;
+}
+
+/**
+ * Prepare AES-128-CBC benchmark
+ *
+ * @ret rc		Return status code
+ */
+static int bench_aes_init ( void ) {
+	return bench_cipher_init ( &aes_cbc_algorithm );
+}
+
+/**
+ * Perform AES-128-CBC encryption operation
+ *
+ */
+static void bench_aes_exec ( void ) {
+	cipher_encrypt ( &aes_cbc_algorithm, bench_aes_ctx, bench_src,
+			 bench_dst, sizeof ( bench_dst ) );
+}
+
+/**
+ * Prepare AES-128-GCM benchmark
+ *
+ * @ret rc		Return status code
+ */
+static int bench_aes_gcm_init ( void ) {
+	return bench_cipher_init ( &aes_gcm_algorithm );
+}
+
+/**
+ * Perform AES-128-GCM encryption operation
+ *
+ * Each operation encrypts and authenticates a complete record, as
+ * for a TLS record.
+ */
+static void bench_aes_gcm_exec ( void ) {
+	static const uint8_t iv[GCM_IV_LEN];
+	uint8_t tag[GCM_AUTH_LEN];
+
+	cipher_setiv ( &aes_gcm_algorithm, bench_aes_ctx, iv );
+	cipher_encrypt ( &aes_gcm_algorithm, bench_aes_ctx, bench_src,
+			 bench_dst, sizeof ( bench_dst ) );
+	cipher_auth ( &aes_gcm_algorithm, bench_aes_ctx, tag );
+}
+
+/**
+ * Clean up AES benchmark
+ *
+ */
+static void bench_aes_fini ( void ) {
+	free ( bench_aes_ctx );
+}
+
+/** RSA benchmark context */
+static RSA_CTX *bench_rsa_ctx;
+
+/**
+ * Prepare RSA benchmark
+ *
+ * @ret rc		Return status code
+ */
+static int bench_rsa_init ( void ) {
+	static const uint8_t exponent[] = { 0x01, 0x00, 0x01 };
+	uint8_t modulus[BENCH_RSA_LEN];
+	unsigned int i;
+
+	/* Construct an arbitrary odd full-length modulus */
+	for ( i = 0 ; i < sizeof ( modulus ) ; i++ )
+		modulus[i] = ( ( i * 0x9d ) + 0x3b );
+	modulus[0] |= 0x80;
+	modulus[ sizeof ( modulus ) - 1 ] |= 0x01;
+
+	RSA_pub_key_new ( &bench_rsa_ctx, modulus, sizeof ( modulus ),
+			  exponent, sizeof ( exponent ) );
+	if ( ! bench_rsa_ctx )
+		return -ENOMEM;
+	return 0;
+}
+
+/**
+ * Perform RSA public-key operation
+ *
+ * This exercises the bigint modular exponentiation path used when
+ * encrypting the TLS pre-master secret.
+ */
+static void bench_rsa_exec ( void ) {
+	RSA_encrypt ( bench_rsa_ctx, bench_src, 48, bench_dst, 0 );
+}
+
+/**
+ * Clean up RSA benchmark
+ *
+ */
+static void bench_rsa_fini ( void ) {
+	RSA_free ( bench_rsa_ctx );
+}
+
+/**
+ * Perform malloc() and free() operation
+ *
+ */
+static void bench_malloc_exec ( void ) {
+	static const size_t sizes[] = { 64, 256, 1536, 2048 };
+	void *ptr[ sizeof ( sizes ) / sizeof ( sizes[0] ) ];
+	unsigned int i;
+
+	for ( i = 0 ; i < ( sizeof ( sizes ) / sizeof ( sizes[0] ) ) ; i++ )
+		ptr[i] = malloc ( sizes[i] );
+	for ( i = 0 ; i < ( sizeof ( sizes ) / sizeof ( sizes[0] ) ) ; i++ )
+		free ( ptr[i] );
+}
+
+/** Microbenchmarks */
+static struct bench_test bench_tests[] = {
+	{
+		.name = "chksum",
+		.len = BENCH_LEN,
+		.exec = bench_chksum_exec,
+	},
+	{
+		.name = "crc32",
+		.len = BENCH_LEN,
+		.exec = bench_crc32_exec,
+	},
+	{
+		.name = "memcpy",
+		.len = BENCH_LEN,
+		.exec = bench_memcpy_exec,
+	},
+	{
+		.name = "sha1",
+		.len = BENCH_LEN,
+		.exec = bench_sha1_exec,
+	},
+	{
+		.name = "aes-cbc",
+		.len = BENCH_LEN,
+		.init = bench_aes_init,
+		.exec = bench_aes_exec,
+		.fini = bench_aes_fini,
+	},
+	{
+		.name = "aes-gcm",
+		.len = BENCH_LEN,
+		.init = bench_aes_gcm_init,
+		.exec = bench_aes_gcm_exec,
+		.fini = bench_aes_fini,
+	},
+	{
+		.name = "rsa-2048",
+		.init = bench_rsa_init,
+		.exec = bench_rsa_exec,
+		.fini = bench_rsa_fini,
+	},
+	{
+		.name = "malloc",
+		.exec = bench_malloc_exec,
+	},
+};
+
+/**
+ * Run microbenchmark
+ *
+ * @v test		Microbenchmark
+ * @v duration		Duration (in ticks)
+ * @ret rc		Return status code
+ */
+static int bench_test_run ( struct bench_test *test,
+			    unsigned long duration ) {
+	unsigned long start;
+	unsigned long elapsed;
+	unsigned long ops = 0;
+	unsigned int i;
+	int rc;
+
+	/* Prepare benchmark */
+	if ( test->init && ( ( rc = test->init() ) != 0 ) ) {
+		printf ( "%-10s could not start: %s\n",
+			 test->name, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Run benchmark */
+	start = currticks();
+	do {
+		for ( i = 0 ; i < BENCH_BATCH ; i++ )
+			test->exec();
+		ops += BENCH_BATCH;
+		elapsed = ( currticks() - start );
+	} while ( elapsed < duration );
+	if ( ! elapsed )
+		elapsed = 1;
+
+	/* Clean up benchmark */
+	if ( test->fini )
+		test->fini();
+
+	/* Report results */
+	printf ( "%-10s %ld ops/s", test->name,
+		 ( unsigned long ) ( ( ops * ( uint64_t ) TICKS_PER_SEC ) /
+				     elapsed ) );
+	if ( test->len ) {
+		printf ( ", " );
+		bench_print_rate ( ( ( uint64_t ) ops * test->len ), elapsed );
+	}
+	printf ( "\n" );
+
+	return 0;
+}
+
+/**
+ * Run all microbenchmarks
+ *
+ * @v duration		Duration of each microbenchmark (in ticks)
+ * @ret rc		Return status code
+ */
+int bench_micro ( unsigned long duration ) {
+	unsigned int i;
+	int rc = 0;
+
+	/* Use a non-trivial data pattern */
+	for ( i = 0 ; i < sizeof ( bench_src ) ; i++ )
+		bench_src[i] = ( i * 0x35 );
+
+	for ( i = 0 ; i < ( sizeof ( bench_tests ) /
+			    sizeof ( bench_tests[0] ) ) ; i++ ) {
+		if ( bench_test_run ( &bench_tests[i], duration ) != 0 )
+			rc = -EIO;
+	}
+	return rc;
+}
+
+/******************************************************************************
+ *
+ * Download benchmark
+ *
+ ******************************************************************************
+ */
+
+/** Length of most recently benchmarked download */
+static size_t bench_download_len;
+
+/**
+ * Record and discard downloaded image
+ *
+ * @v image		Image
+ * @ret rc		Return status code
+ */
+static int bench_download_discard ( struct image *image ) {
+	bench_download_len = image->len;
+	image_put ( image );
+	return 0;
+}
+
+/**
+ * Benchmark a download
+ *
+ * @v uri_string	URI string
+ * @ret rc		Return status code
+ */
+int bench_download ( const char *uri_string ) {
+	unsigned long start;
+	unsigned long elapsed;
+	int rc;
+
+	start = currticks();
+	if ( ( rc = imgdownload_string ( uri_string, NULL, NULL,
+					 bench_download_discard ) ) != 0 ) {
+		printf ( "Could not download %s: %s\n",
+			 uri_string, strerror ( rc ) );
+		return rc;
+	}
+	elapsed = ( currticks() - start );
+
+	printf ( "%s: ", uri_string );
+	bench_print_rate ( bench_download_len, elapsed );
+	printf ( "\n" );
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Block device benchmark
+ *
+ ******************************************************************************
+ */
+
+/** A block device benchmark */
+struct bench_block {
+	/** Underlying block device interface */
+	struct interface block;
+	/** Block device status */
+	int block_rc;
+	/** Command interface */
+	struct interface command;
+	/** Command status */
+	int rc;
+	/** Block device capacity */
+	struct block_device_capacity capacity;
+};
+
+/**
+ * Close block device benchmark underlying block device
+ *
+ * @v bench		Block device benchmark
+ * @v rc		Reason for close
+ */
+static void bench_block_close ( struct bench_block *bench, int rc ) {
+	blkcache_flush ( &bench->block );
+	intf_restart ( &bench->block, rc );
+	bench->block_rc = rc;
+}
+
+/**
+ * Close block device benchmark command
+ *
+ * @v bench		Block device benchmark
+ * @v rc		Reason for close
+ */
+static void bench_block_command_close ( struct bench_block *bench, int rc ) {
+	intf_restart ( &bench->command, rc );
+	bench->rc = rc;
+}
+
+/**
+ * Record block device capacity
+ *
+ * @v bench		Block device benchmark
+ * @v capacity		Block device capacity
+ */
+static void bench_block_capacity ( struct bench_block *bench,
+				   struct block_device_capacity *capacity ) {
+	memcpy ( &bench->capacity, capacity, sizeof ( bench->capacity ) );
+}
+
+/** Block device benchmark block interface operations */
+static struct interface_operation bench_block_op[] = {
+	INTF_OP ( intf_close, struct bench_block *, bench_block_close ),
+};
+
+/** Block device benchmark block interface descriptor */
+static struct interface_descriptor bench_block_desc =
+	INTF_DESC ( struct bench_block, block, bench_block_op );
+
+/** Block device benchmark command interface operations */
+static struct interface_operation bench_block_command_op[] = {
+	INTF_OP ( intf_close, struct bench_block *, bench_block_command_close ),
+	INTF_OP ( block_capacity, struct bench_block *, bench_block_capacity ),
+};
+
+/** Block device benchmark command interface descriptor */
+static struct interface_descriptor bench_block_command_desc =
+	INTF_DESC ( struct bench_block, command, bench_block_command_op );
+
+/** The block device benchmark */
+static struct bench_block bench_block_dev = {
+	.block = INTF_INIT ( bench_block_desc ),
+	.command = INTF_INIT ( bench_block_command_desc ),
+};
+
+/**
+ * Prepare to issue block device command
+ *
+ * @v bench		Block device benchmark
+ * @ret rc		Return status code
+ */
+static int bench_block_start ( struct bench_block *bench ) {
+	unsigned long start = currticks();
+
+	/* Wait for block control interface to become ready */
+	while ( ( bench->block_rc == 0 ) &&
+		( xfer_window ( &bench->block ) == 0 ) ) {
+		if ( ( currticks() - start ) > BENCH_BLOCK_TIMEOUT )
+			return -ETIMEDOUT;
+		step();
+	}
+
+	bench->rc = -EINPROGRESS;
+	return bench->block_rc;
+}
+
+/**
+ * Wait for block device command to complete
+ *
+ * @v bench		Block device benchmark
+ * @ret rc		Return status code
+ */
+static int bench_block_wait ( struct bench_block *bench ) {
+	unsigned long start = currticks();
+
+	while ( bench->rc == -EINPROGRESS ) {
+		if ( ( currticks() - start ) > BENCH_BLOCK_TIMEOUT ) {
+			bench_block_command_close ( bench, -ETIMEDOUT );
+			break;
+		}
+		step();
+	}
+	return bench->rc;
+}
+
+/**
+ * Benchmark sequential reads from a block device
+ *
+ * @v uri_string	URI string
+ * @v max_len		Maximum length to read, or zero to read entire device
+ * @ret rc		Return status code
+ */
+int bench_block ( const char *uri_string, unsigned long max_len ) {
+	struct bench_block *bench = &bench_block_dev;
+	struct uri *uri;
+	userptr_t buffer;
+	uint64_t lba = 0;
+	uint64_t blocks;
+	uint64_t len = 0;
+	unsigned int max_count;
+	unsigned int count;
+	unsigned long start;
+	unsigned long elapsed;
+	int rc;
+
+	/* Open block device */
+	uri = parse_uri ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse_uri;
+	}
+	bench->block_rc = 0;
+	if ( ( rc = xfer_open_uri ( &bench->block, uri ) ) != 0 )
+		goto err_open;
+
+	/* Read device capacity */
+	if ( ( rc = bench_block_start ( bench ) ) != 0 )
+		goto err_capacity;
+	if ( ( rc = block_read_capacity ( &bench->block,
+					  &bench->command ) ) != 0 )
+		goto err_capacity;
+	if ( ( rc = bench_block_wait ( bench ) ) != 0 )
+		goto err_capacity;
+	if ( ! bench->capacity.blksize ) {
+		rc = -EIO;
+		goto err_capacity;
+	}
+
+	/* Determine number of blocks to read */
+	blocks = bench->capacity.blocks;
+	if ( max_len && ( blocks > ( max_len / bench->capacity.blksize ) ) )
+		blocks = ( max_len / bench->capacity.blksize );
+	max_count = ( BENCH_BLOCK_CHUNK / bench->capacity.blksize );
+	if ( max_count > bench->capacity.max_count )
+		max_count = bench->capacity.max_count;
+	if ( ! max_count )
+		max_count = 1;
+
+	/* Allocate buffer */
+	buffer = umalloc ( max_count * bench->capacity.blksize );
+	if ( ! buffer ) {
+		rc = -ENOMEM;
+		goto err_umalloc;
+	}
+
+	/* Read blocks sequentially */
+	start = currticks();
+	while ( lba < blocks ) {
+		count = max_count;
+		if ( count > ( blocks - lba ) )
+			count = ( blocks - lba );
+		if ( ( rc = bench_block_start ( bench ) ) != 0 )
+			goto err_read;
+		if ( ( rc = block_read ( &bench->block, &bench->command, lba,
+					 count, buffer,
+					 ( count * bench->capacity.blksize )
+					 ) ) != 0 )
+			goto err_read;
+		if ( ( rc = bench_block_wait ( bench ) ) != 0 )
+			goto err_read;
+		lba += count;
+		len += ( count * bench->capacity.blksize );
+	}
+	elapsed = ( currticks() - start );
+
+	printf ( "%s: ", uri_string );
+	bench_print_rate ( len, elapsed );
+	printf ( "\n" );
+
+ err_read:
+	ufree ( buffer );
+ err_umalloc:
+ err_capacity:
+	bench_block_close ( bench, rc );
+ err_open:
+	uri_put ( uri );
+ err_parse_uri:
+	if ( rc != 0 ) {
+		printf ( "Could not read %s: %s\n",
+			 uri_string, strerror ( rc ) );
+	}
+	return rc;
+}
@@ -22,7 +22,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <byteswap.h>
 #include <ipxe/console.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/timer.h>
+#include <ipxe/profile.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/device.h>
 #include <ipxe/process.h>
@@ -99,10 +103,159 @@ void ifstat ( struct net_device *netdev ) {
 		printf ( "  [Link status: %s]\n",
 			 strerror ( netdev->link_rc ) );
 	}
+	if ( netdev->rxq_stats.batches ) {
+		printf ( "  [RXQ:%d max:%d, batches:%d avg:%d max:%d]\n",
+			 netdev->rxq_stats.depth, netdev->rxq_stats.max_depth,
+			 netdev->rxq_stats.batches,
+			 ( netdev->rxq_stats.packets /
+			   netdev->rxq_stats.batches ),
+			 netdev->rxq_stats.max_batch );
+	}
+	ifstat_errors ( &netdev->tx_stats, "TXE" );
+	ifstat_errors ( &netdev->rx_stats, "RXE" );
+}
+
+/**
+ * Print time interval
+ *
+ * @v cycles		Time interval (in CPU cycles)
+ */
+static void netstat_time ( uint64_t cycles ) {
+	uint64_t ns;
+
+	ns = ( ( cycles * 1000 ) / profile_rate() );
+	if ( ns < 1000 ) {
+		printf ( "%lldns", ( ( unsigned long long ) ns ) );
+	} else if ( ns < 1000000 ) {
+		printf ( "%lldus", ( ( unsigned long long ) ( ns / 1000 ) ) );
+	} else {
+		printf ( "%lldms",
+			 ( ( unsigned long long ) ( ns / 1000000 ) ) );
+	}
+}
+
+/**
+ * Print network device receive latency histogram
+ *
+ * @v netdev		Network device
+ */
+static void netstat_latency ( struct net_device *netdev ) {
+	struct net_device_rx_queue_stats *stats = &netdev->rxq_stats;
+	unsigned int last = ( NETDEV_RX_LATENCY_BUCKETS - 1 );
+	unsigned int count = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < NETDEV_RX_LATENCY_BUCKETS ; i++ )
+		count += stats->latency_hist[i];
+	if ( ! count )
+		return;
+
+	printf ( "  [RX latency avg:" );
+	netstat_time ( stats->latency / count );
+	for ( i = 0 ; i < NETDEV_RX_LATENCY_BUCKETS ; i++ ) {
+		if ( ! stats->latency_hist[i] )
+			continue;
+		if ( i == last ) {
+			printf ( " >=" );
+			netstat_time ( 1ULL << ( last - 1 ) );
+		} else {
+			printf ( " <" );
+			netstat_time ( 1ULL << i );
+		}
+		printf ( ":%d", stats->latency_hist[i] );
+	}
+	printf ( "]\n" );
+}
+
+/**
+ * Print network device per-protocol statistics
+ *
+ * @v netdev		Network device
+ */
+static void netstat_protocols ( struct net_device *netdev ) {
+	struct net_device_protocol_stats *stats;
+	struct net_protocol *net_protocol;
+	const char *name;
+	unsigned int i;
+
+	for ( i = 0 ; i < ( sizeof ( netdev->proto_stats ) /
+			    sizeof ( netdev->proto_stats[0] ) ) ; i++ ) {
+		stats = &netdev->proto_stats[i];
+		if ( ! stats->net_proto )
+			break;
+		name = NULL;
+		for_each_table_entry ( net_protocol, NET_PROTOCOLS ) {
+			if ( net_protocol->net_proto == stats->net_proto ) {
+				name = net_protocol->name;
+				break;
+			}
+		}
+		if ( name ) {
+			printf ( "  [%s", name );
+		} else {
+			printf ( "  [%04x", ntohs ( stats->net_proto ) );
+		}
+		printf ( " RX:%d bytes:%ld TX:%d bytes:%ld]\n",
+			 stats->rx, stats->rx_bytes,
+			 stats->tx, stats->tx_bytes );
+	}
+}
+
+/**
+ * Print detailed statistics for network device
+ *
+ * @v netdev		Network device
+ */
+void netstat ( struct net_device *netdev ) {
+	struct net_device_rx_queue_stats *rxq_stats = &netdev->rxq_stats;
+	unsigned int per_poll;
+
+	printf ( "%s: %s using %s on %s (%s)\n",
+		 netdev->name, netdev_addr ( netdev ),
+		 netdev->dev->driver_name, netdev->dev->name,
+		 ( netdev_is_open ( netdev ) ? "open" : "closed" ) );
+	printf ( "  [TX:%d TXE:%d bytes:%ld, TXQ:%d max:%d]\n",
+		 netdev->tx_stats.good, netdev->tx_stats.bad,
+		 netdev->tx_stats.bytes, netdev->txq_stats.depth,
+		 netdev->txq_stats.max_depth );
+	printf ( "  [RX:%d RXE:%d bytes:%ld, RXQ:%d max:%d overruns:%d]\n",
+		 netdev->rx_stats.good, netdev->rx_stats.bad,
+		 netdev->rx_stats.bytes, rxq_stats->depth,
+		 rxq_stats->max_depth, rxq_stats->overruns );
+	if ( rxq_stats->polls ) {
+		/* Packets per poll, in hundredths */
+		per_poll = ( ( netdev->rx_stats.good * 100ULL ) /
+			     rxq_stats->polls );
+		printf ( "  [Polls:%d RX/poll:%d.%02d", rxq_stats->polls,
+			 ( per_poll / 100 ), ( per_poll % 100 ) );
+		if ( rxq_stats->batches ) {
+			printf ( ", batches:%d avg:%d max:%d",
+				 rxq_stats->batches,
+				 ( rxq_stats->packets / rxq_stats->batches ),
+				 rxq_stats->max_batch );
+		}
+		printf ( "]\n" );
+	}
+	if ( netdev->caps & NETDEV_CAP_RX_CSUM ) {
+		printf ( "  [RX checksums verified by hardware:%d]\n",
+			 rxq_stats->csum_verified );
+	}
+	netstat_latency ( netdev );
+	netstat_protocols ( netdev );
 	ifstat_errors ( &netdev->tx_stats, "TXE" );
 	ifstat_errors ( &netdev->rx_stats, "RXE" );
 }
 
+/**
+ * Print I/O buffer statistics
+ *
+ */
+void iobstat ( void ) {
+	printf ( "I/O buffers: [pool:%d hits:%ld misses:%ld failures:%ld]\n",
+		 iob_pool_stats.count, iob_pool_stats.hits,
+		 iob_pool_stats.misses, iob_pool_stats.failures );
+}
+
 /**
  * Wait for link-up, with status indication
  *